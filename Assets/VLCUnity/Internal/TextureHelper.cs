@@ -19,11 +19,78 @@ public static class TextureHelper
         [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_bit_depth_format")]
         static extern void SetBitDepthFormat(IntPtr mediaplayer, int bitDepth);
 
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_frame_queue")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool SetFrameQueue(IntPtr mediaplayer, uint slots, int mode);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_buffer_pool_limit")]
+        static extern void SetBufferPoolLimitNative(ulong bytes);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_linux_backend")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool SetLinuxBackendNative(int backend);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_get_linux_backend")]
+        static extern int GetLinuxBackendNative();
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_get_texture_ex")]
+        static extern IntPtr GetTextureEx(IntPtr mediaplayer, uint width, uint height, [MarshalAs(UnmanagedType.I1)] out bool updated, out FrameInfo info);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_poll_frames")]
+        static extern void PollFrames(IntPtr[] players, uint count, [In, Out] PlayerFrameState[] states);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_get_player_stats")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool GetPlayerStats(IntPtr mediaplayer, ref PlayerStats stats);
+
         [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_unity_texture_vulkan")]
         static extern bool SetUnityTextureVulkan(IntPtr mediaplayer, IntPtr texturePtr);
 
-        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "GetRenderEventFunc")]
-        static extern IntPtr GetRenderEventFunc();
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_orientation")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool SetOrientationNative(IntPtr mediaplayer, [MarshalAs(UnmanagedType.I1)] bool flipX, [MarshalAs(UnmanagedType.I1)] bool flipY);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_mipmaps")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool SetMipmapsNative(IntPtr mediaplayer, [MarshalAs(UnmanagedType.I1)] bool enabled);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_target_texture")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool SetTargetTextureNative(IntPtr mediaplayer, IntPtr texture, uint width, uint height);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_request_readback")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool RequestReadbackNative(IntPtr mediaplayer, uint width, uint height, ReadbackFormat format);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_poll_readback")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool PollReadbackNative(IntPtr mediaplayer, out ReadbackFrame frame);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_log_level")]
+        static extern void SetLogLevel(int category, int level);
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        delegate void NativeLogCallback(IntPtr opaque, int category, int level, IntPtr message);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_set_log_callback")]
+        static extern void SetLogCallback(NativeLogCallback callback, IntPtr opaque);
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "GetRenderEventAndDataFunc")]
+        static extern IntPtr GetRenderEventAndDataFunc();
+
+        [DllImport(UnityPlugin, CallingConvention = CallingConvention.Cdecl, EntryPoint = "libvlc_unity_render_batch_new")]
+        static extern IntPtr RenderBatchNew(IntPtr[] players, uint count);
+
+        static IntPtr renderEventAndDataFunc = IntPtr.Zero;
+        static IntPtr RenderEventAndDataFunc
+        {
+            get
+            {
+                if (renderEventAndDataFunc == IntPtr.Zero)
+                    renderEventAndDataFunc = GetRenderEventAndDataFunc();
+                return renderEventAndDataFunc;
+            }
+        }
 
 #if UNITY_ANDROID && !UNITY_EDITOR
         // Track if we're using the Vulkan approach (Unity-owned texture)
@@ -51,21 +118,20 @@ public static bool UpdateTexture(Texture2D texture, MediaPlayer player)
                 {
                     // Issue a plugin event to trigger the texture copy on the render thread
                     // This ensures AccessTexture is called at the right time
-                    IntPtr renderEventFunc = GetRenderEventFunc();
-                    GL.IssuePluginEvent(renderEventFunc, 0);
+                    GL.IssuePluginEventAndData(RenderEventAndDataFunc, (int)RenderEventOp.Player, player.NativeReference);
                     return true;
                 }
                 return false;
             }
 #endif
 
-#if UNITY_STANDALONE_LINUX || UNITY_EDITOR_LINUX
-            // Trigger render-thread work (DMA-BUF texture import on Linux/Wayland)
-            GL.IssuePluginEvent(GetRenderEventFunc(), 1);
-#endif
-
             // Standard approach for non-Vulkan
             var ptr = player.GetTexture((uint)texture.width, (uint)texture.height, out bool updatedd);
+#if UNITY_STANDALONE_LINUX || UNITY_EDITOR_LINUX
+            // Trigger this player's render-thread work (DMA-BUF texture import on Linux/Wayland),
+            // after GetTexture so that it works on the frame just acquired
+            GL.IssuePluginEventAndData(RenderEventAndDataFunc, (int)RenderEventOp.Player, player.NativeReference);
+#endif
             if (updatedd && ptr != System.IntPtr.Zero)
             {
                 texture.UpdateExternalTexture(ptr);
@@ -74,13 +140,287 @@ public static bool UpdateTexture(Texture2D texture, MediaPlayer player)
             return false;
         }
 
+        /// <summary>
+        /// Same as UpdateTexture, for a player whose frames are copied to a RenderTexture
+        /// registered with SetTargetTexture: acquires the latest frame and has the render
+        /// thread copy it
+        /// </summary>
+        /// <param name="texture">The texture holding the player's frames</param>
+        /// <param name="player">The media player</param>
+        /// <returns>true if frame was updated</returns>
+        public static bool UpdateTargetTexture(Texture2D texture, MediaPlayer player)
+        {
+            if (texture == null)
+                return false;
+
+            player.GetTexture((uint)texture.width, (uint)texture.height, out bool updated);
+            // The copy is part of the player's render-thread work
+            GL.IssuePluginEventAndData(RenderEventAndDataFunc, (int)RenderEventOp.Player, player.NativeReference);
+            return updated;
+        }
+
+        /// <summary>
+        /// Mirror the video in VLC's own render pass, so that displaying it needs no flipping copy.
+        /// Takes effect the next time the video output is set up, so call it before playing.
+        /// Only supported by the OpenGL backends for now.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="flipX">mirror horizontally</param>
+        /// <param name="flipY">mirror vertically</param>
+        /// <returns>true if the backend renders with these flips</returns>
+        public static bool SetOrientation(MediaPlayer player, bool flipX, bool flipY)
+        {
+            return SetOrientationNative(player.NativeReference, flipX, flipY);
+        }
+
+        /// <summary>
+        /// Have the plugin fill the mip levels of the player's textures, generated on the render
+        /// thread for every new frame, for video sampled minified (distant or small surfaces).
+        /// Takes effect the next time the video output is set up, so call it before playing, and
+        /// create the texture with CreateNativeTexture(mipmap: true). The render events are issued
+        /// by UpdateTexture on Linux only, issue them with IssueRenderEvents elsewhere: a frame
+        /// stays displayed until a render event generated its mip levels.
+        /// Only supported by the OpenGL backends, except Linux DMA-BUF, for now.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="enabled">true to generate mipmaps</param>
+        /// <returns>true if the backend generates mipmaps</returns>
+        public static bool SetMipmaps(MediaPlayer player, bool enabled)
+        {
+            return SetMipmapsNative(player.NativeReference, enabled);
+        }
+
+        /// <summary>
+        /// Have the player's render event copy each new frame to a RenderTexture, instead of
+        /// blitting its texture on Unity's side. The frame is still copied once per frame, by a
+        /// GPU blit that scales it to the size of the texture and needs no shader pass nor
+        /// Unity-side state changes (OpenGL ES 2 only copies frames of the texture size). Use
+        /// UpdateTargetTexture instead of UpdateTexture afterwards. Only supported by the OpenGL backends for now.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="target">created render texture, null to stop copying</param>
+        /// <returns>true if the backend copies frames to the texture</returns>
+        public static bool SetTargetTexture(MediaPlayer player, RenderTexture target)
+        {
+            if (target == null)
+                return SetTargetTextureNative(player.NativeReference, IntPtr.Zero, 0, 0);
+            return SetTargetTextureNative(player.NativeReference, target.GetNativeTexturePtr(),
+                                          (uint)target.width, (uint)target.height);
+        }
+
+        /// <summary>
+        /// Ask for the next frame VLC renders to be copied to system memory, for processing on the
+        /// CPU without stalling Unity like ReadPixels would. The frame is scaled and converted on the
+        /// GPU, then returned by PollReadback a few frames later. Up to 4 requests can be queued.
+        /// Only supported by the OpenGL backends (OpenGL 3.2 or OpenGL ES 3) for now.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="width">width of the copy, 0 for the video width</param>
+        /// <param name="height">height of the copy, 0 for the video height</param>
+        /// <param name="format">pixel layout of the copy</param>
+        /// <returns>true if the request was queued</returns>
+        public static bool RequestReadback(MediaPlayer player, uint width, uint height, ReadbackFormat format)
+        {
+            return RequestReadbackNative(player.NativeReference, width, height, format);
+        }
+
+        /// <summary>
+        /// Take the oldest completed readback of the player, see RequestReadback.
+        /// frame.Data stays valid until the next call for the same player or until the player is released.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="frame">the copy, rows from the top of the picture</param>
+        /// <returns>false if no readback is ready yet</returns>
+        public static bool PollReadback(MediaPlayer player, out ReadbackFrame frame)
+        {
+            return PollReadbackNative(player.NativeReference, out frame);
+        }
+
+        /// <summary>
+        /// Set how much the native plugin logs, per category
+        /// </summary>
+        /// <param name="category">category to change, All for every category</param>
+        /// <param name="level">messages above this level are skipped, Off to disable the category</param>
+        public static void SetNativeLogLevel(NativeLogCategory category, NativeLogLevel level)
+        {
+            SetLogLevel((int)category, (int)level);
+        }
+
+        // Kept alive here as long as the plugin may call it
+        static NativeLogCallback nativeLogCallback;
+        static Action<NativeLogCategory, NativeLogLevel, string> nativeLogHandler;
+
+        /// <summary>
+        /// Receive the native plugin's log messages instead of letting it write them to stderr,
+        /// logcat or the debugger. The handler is called from a background thread.
+        /// </summary>
+        /// <param name="handler">message handler, null to restore the default output</param>
+        public static void SetNativeLogHandler(Action<NativeLogCategory, NativeLogLevel, string> handler)
+        {
+            nativeLogHandler = handler;
+            if (handler == null)
+            {
+                SetLogCallback(null, IntPtr.Zero);
+                return;
+            }
+            if (nativeLogCallback == null)
+                nativeLogCallback = OnNativeLog;
+            SetLogCallback(nativeLogCallback, IntPtr.Zero);
+        }
+
+        [AOT.MonoPInvokeCallback(typeof(NativeLogCallback))]
+        static void OnNativeLog(IntPtr opaque, int category, int level, IntPtr message)
+        {
+            var handler = nativeLogHandler;
+            if (handler != null)
+                handler((NativeLogCategory)category, (NativeLogLevel)level, Marshal.PtrToStringAnsi(message));
+        }
+
+        /// <summary>
+        /// Run the render-thread work of several players with a single plugin event,
+        /// instead of one per UpdateTexture call
+        /// </summary>
+        /// <param name="players">mediaplayer instances, null entries are skipped</param>
+        public static void IssueRenderEvents(MediaPlayer[] players)
+        {
+            if (players == null || players.Length == 0)
+                return;
+
+            var handles = new IntPtr[players.Length];
+            uint count = 0;
+            foreach (var player in players)
+            {
+                if (player != null)
+                    handles[count++] = player.NativeReference;
+            }
+            if (count == 0)
+                return;
+
+            // The plugin copies the handles and frees the batch once the render thread ran it
+            var batch = RenderBatchNew(handles, count);
+            if (batch != IntPtr.Zero)
+                GL.IssuePluginEventAndData(RenderEventAndDataFunc, (int)RenderEventOp.Batch, batch);
+        }
+
+        /// <summary>
+        /// Same as MediaPlayer.GetTexture, also returning the timing of the frame the texture holds
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="width">requested width</param>
+        /// <param name="height">requested height</param>
+        /// <param name="updated">true if a new frame was acquired</param>
+        /// <param name="info">frame timing, FrameNumber is 0 when the backend does not track it</param>
+        /// <returns>native texture pointer, or IntPtr.Zero</returns>
+        public static IntPtr GetTexture(MediaPlayer player, uint width, uint height, out bool updated, out FrameInfo info)
+        {
+            if (player == null)
+            {
+                updated = false;
+                info = default;
+                return IntPtr.Zero;
+            }
+            return GetTextureEx(player.NativeReference, width, height, out updated, out info);
+        }
+
+        // Reused across PollFrames calls, main thread only
+        static IntPtr[] pollHandles = Array.Empty<IntPtr>();
+
+        /// <summary>
+        /// Query the video size and state of several players, and acquire their latest frame,
+        /// in a single native call. Meant to replace per-player MediaPlayer.Size and GetTexture
+        /// calls every frame; the render-thread work still needs IssueRenderEvents on Linux.
+        /// </summary>
+        /// <param name="players">mediaplayer instances, null entries report an empty state</param>
+        /// <param name="states">one per player, RequestWidth/RequestHeight set to the size of the
+        /// texture displaying it (0 to only query the state), the rest is filled in</param>
+        public static void PollFrames(MediaPlayer[] players, PlayerFrameState[] states)
+        {
+            if (players == null || states == null)
+                return;
+            int count = Math.Min(players.Length, states.Length);
+            if (count == 0)
+                return;
+
+            if (pollHandles.Length < count)
+                pollHandles = new IntPtr[count];
+            for (int i = 0; i < count; i++)
+                pollHandles[i] = players[i] != null ? players[i].NativeReference : IntPtr.Zero;
+
+            PollFrames(pollHandles, (uint)count, states);
+        }
+
+        /// <summary>
+        /// Read the native performance counters of a player
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="stats">counters, see PlayerStats</param>
+        /// <returns>false if the player is unknown to the plugin</returns>
+        public static bool GetPlayerStats(MediaPlayer player, out PlayerStats stats)
+        {
+            stats = new PlayerStats
+            {
+                Size = (uint)Marshal.SizeOf<PlayerStats>(),
+                LatencyHistogram = new ulong[PlayerStats.LatencyBuckets]
+            };
+            if (player == null)
+                return false;
+            return GetPlayerStats(player.NativeReference, ref stats);
+        }
+
+        /// <summary>
+        /// Configure the frames queued between VLC and Unity for this player.
+        /// Takes effect the next time the video output is set up, so call it before playing.
+        /// Only supported by the OpenGL backends (including Linux DMA-BUF) for now.
+        /// </summary>
+        /// <param name="player">mediaplayer instance</param>
+        /// <param name="slots">number of frame buffers, from 2 to 8 (at least 3 in mailbox mode)</param>
+        /// <param name="mode">Mailbox for lowest latency, Fifo to never drop frames when Unity runs slower than the video</param>
+        /// <returns>true if the backend accepted the configuration</returns>
+        public static bool SetFrameQueue(MediaPlayer player, uint slots, FrameQueueMode mode)
+        {
+            if (player == null)
+                return false;
+            return SetFrameQueue(player.NativeReference, slots, (int)mode);
+        }
+
+        /// <summary>
+        /// Set how much memory the frame buffers of stopped or resized players may keep,
+        /// so that switching back to a size seen recently allocates nothing.
+        /// Used by the OpenGL backends (Android and Linux) for now.
+        /// </summary>
+        /// <param name="bytes">limit in bytes, 0 to free buffers as soon as they are released</param>
+        public static void SetBufferPoolLimit(ulong bytes)
+        {
+            SetBufferPoolLimitNative(bytes);
+        }
+
+        /// <summary>
+        /// Force how video frames reach Unity on Linux, instead of the backend measured
+        /// on the first run on this machine. Applies to the players created afterwards.
+        /// </summary>
+        /// <param name="backend">backend to use, Auto to go back to the measured one</param>
+        /// <returns>false if the backend is not supported by this build or platform</returns>
+        public static bool SetLinuxBackend(LinuxBackend backend)
+        {
+            return SetLinuxBackendNative((int)backend);
+        }
+
+        /// <summary>
+        /// Backend the next players will use on Linux
+        /// </summary>
+        /// <returns>the backend, Auto on other platforms</returns>
+        public static LinuxBackend GetLinuxBackend()
+        {
+            return (LinuxBackend)GetLinuxBackendNative();
+        }
+
         /// <summary>
         /// Helper for native texture creation
         /// </summary>
         /// <param name="player">mediaplayer instance</param>
-        /// <param name="bitDepth">8 or 16 bits (16 bits is Windows-only for now)</param>
+        /// <param name="bitDepth">8, 10 or 16 bits (10 bits is Linux-only, 16 bits Windows and Linux)</param>
         /// <param name="linear">true for linear color space</param>
-        /// <param name="mipmap">default to false</param>
+        /// <param name="mipmap">whether the plugin fills mip levels, see SetMipmaps. Default to false</param>
         /// <returns>texture or null / throw if fails</returns>
         public static Texture2D CreateNativeTexture(MediaPlayer player, bool linear, BitDepth bitDepth = BitDepth.Bit8, bool mipmap = false)
         {
@@ -89,22 +429,22 @@ public static Texture2D CreateNativeTexture(MediaPlayer player, bool linear, Bit
 
             player.Size(0, ref width, ref height);
 
+#if !(UNITY_STANDALONE_LINUX || UNITY_EDITOR_LINUX)
+            if (bitDepth == BitDepth.Bit10)
+            {
+                bitDepth = BitDepth.Bit8;
+            }
+#endif
             if (bitDepth == BitDepth.Bit16)
             {
                 if (!SystemInfo.SupportsTextureFormat(TextureFormat.RGBAHalf))
                 {
                     throw new VLCException("16 bits was requested, but TextureFormat.RGBAHalf is not supported by your GPU");
                 }
-#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN || UNITY_WSA
-                SetBitDepthFormat(player.NativeReference, (int)BitDepth.Bit16);
-#endif
             }
-            else
-            {
-#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN || UNITY_WSA
-                SetBitDepthFormat(player.NativeReference, (int)BitDepth.Bit8);
+#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN || UNITY_WSA || UNITY_STANDALONE_LINUX || UNITY_EDITOR_LINUX
+            SetBitDepthFormat(player.NativeReference, (int)bitDepth);
 #endif
-            }
 
 #if UNITY_ANDROID && !UNITY_EDITOR
             // Vulkan on Android requires a different approach
@@ -136,8 +476,8 @@ public static Texture2D CreateNativeTexture(MediaPlayer player, bool linear, Bit
 #endif
 
 #if UNITY_STANDALONE_LINUX || UNITY_EDITOR_LINUX
-            // Trigger render-thread work (DMA-BUF texture import on Linux/Wayland)
-            GL.IssuePluginEvent(GetRenderEventFunc(), 1);
+            // Trigger this player's render-thread work (DMA-BUF texture import on Linux/Wayland)
+            GL.IssuePluginEventAndData(RenderEventAndDataFunc, (int)RenderEventOp.Player, player.NativeReference);
 #endif
 
             // Standard approach for non-Vulkan or non-Android
@@ -162,6 +502,168 @@ public static Texture2D CreateNativeTexture(MediaPlayer player, bool linear, Bit
     public enum BitDepth
     {
         Bit8 = 8,
+        /// <summary>RGB10_A2, Linux only. Exposed to Unity as RGBA32, the native texture keeps its precision.</summary>
+        Bit10 = 10,
         Bit16 = 16
     }
+
+    public enum NativeLogCategory
+    {
+        All = -1,
+        Core = 0,
+        GLX = 1,
+        EGL = 2,
+        DMABuf = 3
+    }
+
+    public enum NativeLogLevel
+    {
+        Off = -1,
+        Error = 0,
+        Warning = 1,
+        Info = 2,
+        Debug = 3,
+        Verbose = 4
+    }
+
+    /// <summary>
+    /// Operation codes of the plugin's data-carrying render event
+    /// </summary>
+    enum RenderEventOp
+    {
+        Player = 1,
+        Batch = 2
+    }
+
+    public enum FrameQueueMode
+    {
+        Mailbox = 0,
+        Fifo = 1
+    }
+
+    /// <summary>
+    /// Pixel layouts of TextureHelper.RequestReadback
+    /// </summary>
+    public enum ReadbackFormat
+    {
+        RGBA8 = 0,
+        RGB8 = 1,
+        /// <summary>BT.709 luma</summary>
+        GRAY8 = 2
+    }
+
+    /// <summary>
+    /// Frame copied to system memory, see TextureHelper.PollReadback
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ReadbackFrame
+    {
+        /// <summary>Rows from the top of the picture, Stride bytes apart</summary>
+        public IntPtr Data;
+        public uint Width;
+        public uint Height;
+        public uint Stride;
+        public ReadbackFormat Format;
+        /// <summary>Timing of the frame that was copied</summary>
+        public FrameInfo Info;
+    }
+
+    /// <summary>
+    /// How video frames reach Unity on Linux, see TextureHelper.SetLinuxBackend
+    /// </summary>
+    public enum LinuxBackend
+    {
+        /// <summary>Backend measured at startup</summary>
+        Auto = -1,
+        /// <summary>Textures shared with a GLX context of Unity's share group</summary>
+        GLXShareGroup = 0,
+        /// <summary>DMA-BUF buffers rendered with GLX</summary>
+        GLXDMABuf = 1,
+        /// <summary>DMA-BUF buffers rendered with EGL on the render node</summary>
+        EGLDMABuf = 2,
+        /// <summary>Frames decoded on the CPU and uploaded by Unity's render thread</summary>
+        CPU = 3
+    }
+
+    /// <summary>
+    /// Timing of a video frame, see TextureHelper.GetTexture
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FrameInfo
+    {
+        /// <summary>Increases by one for every frame rendered by VLC, gaps are dropped frames</summary>
+        public ulong FrameNumber;
+        /// <summary>libvlc clock when VLC finished rendering the frame, in microseconds</summary>
+        public long SwapTimeUs;
+        /// <summary>Playback position of the frame in milliseconds, -1 if unknown</summary>
+        public long MediaTimeMs;
+    }
+
+    /// <summary>
+    /// Per-player result of TextureHelper.PollFrames
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PlayerFrameState
+    {
+        /// <summary>In: size the texture is displayed at, 0x0 to skip acquiring a frame</summary>
+        public uint RequestWidth;
+        public uint RequestHeight;
+        /// <summary>Size VLC renders at, 0x0 until the video output is configured</summary>
+        public uint Width;
+        public uint Height;
+        /// <summary>Native texture holding the latest frame, IntPtr.Zero if none</summary>
+        public IntPtr Texture;
+        /// <summary>Number of that frame, 0 when the backend does not track it</summary>
+        public ulong FrameNumber;
+        /// <summary>Last state reported by the player</summary>
+        public VLCState State;
+        /// <summary>Whether a new frame was acquired by this call</summary>
+        [MarshalAs(UnmanagedType.I1)]
+        public bool Updated;
+    }
+
+    /// <summary>
+    /// Native per-player counters, see TextureHelper.GetPlayerStats
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PlayerStats
+    {
+        public const int LatencyBuckets = 12;
+
+        public uint Size;
+        public uint LatencyBucketCount;
+        /// <summary>Frames VLC finished rendering</summary>
+        public ulong FramesRendered;
+        /// <summary>Frames handed to Unity</summary>
+        public ulong FramesPresented;
+        /// <summary>Frames replaced by a newer one before Unity acquired them</summary>
+        public ulong FramesDropped;
+        /// <summary>Changes of the video size</summary>
+        public ulong Resizes;
+        /// <summary>Buffers imported into Unity's context (Linux DMA-BUF)</summary>
+        public ulong DmabufImports;
+        /// <summary>Sum of the swap to acquire latencies, in microseconds</summary>
+        public ulong LatencySumUs;
+        public ulong LatencyMaxUs;
+        /// <summary>Bucket i counts latencies below 250us &lt;&lt; i, the last one everything above</summary>
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = LatencyBuckets)]
+        public ulong[] LatencyHistogram;
+        /// <summary>Number of GPU time measures the GPU time statistics are computed over, at most</summary>
+        public uint GpuTimeWindow;
+        /// <summary>GPU time measures of VLC's render pass, 0 without timer queries</summary>
+        public uint VlcGpuSamples;
+        /// <summary>GPU time of VLC's render pass per frame, in microseconds</summary>
+        public ulong VlcGpuAvgUs;
+        public ulong VlcGpuP50Us;
+        public ulong VlcGpuP95Us;
+        public ulong VlcGpuP99Us;
+        /// <summary>GPU time measures of the render thread work in Unity's context, 0 without timer queries</summary>
+        public uint UnityGpuSamples;
+        public uint Reserved0;
+        /// <summary>GPU time of the imports, uploads and copies of a render event, in microseconds</summary>
+        public ulong UnityGpuAvgUs;
+        public ulong UnityGpuP50Us;
+        public ulong UnityGpuP95Us;
+        public ulong UnityGpuP99Us;
+    }
 }
\ No newline at end of file
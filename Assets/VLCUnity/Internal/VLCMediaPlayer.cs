@@ -79,6 +79,17 @@ public enum PreloadState { None, Preparing, Prepared }
         private Texture2D _vlcTexture = null;
         private VLCAudioSource _vlcAudioSource;
 
+        // Flips VLC renders the video of MediaPlayer (and of the preloading player) with
+        private bool _nativeFlipX;
+        private bool _nativeFlipY;
+        private bool _backgroundFlipX;
+        private bool _backgroundFlipY;
+
+        // Player and texture the plugin copies frames to, see TextureHelper.SetTargetTexture
+        private MediaPlayer _targetPlayer;
+        private RenderTexture _targetTexture;
+        private bool _targetRegistered;
+
         private readonly ConcurrentQueue<Action> _mainThreadActions = new();
 
         #region unity
@@ -129,9 +140,20 @@ private void Update()
 
             if (_vlcTexture != null)
             {
-                if (TextureHelper.UpdateTexture(_vlcTexture, MediaPlayer))
+                // Flips VLC could not render with, changed since the player was set up
+                bool flipX = flipTextureX != _nativeFlipX;
+                bool flipY = flipTextureY != _nativeFlipY;
+                if (flipX || flipY)
+                    UnregisterOutputTarget();
+
+                if (!flipX && !flipY && RegisterOutputTarget())
+                {
+                    // The plugin copies the frame to OutputTexture itself
+                    TextureHelper.UpdateTargetTexture(_vlcTexture, MediaPlayer);
+                }
+                else if (TextureHelper.UpdateTexture(_vlcTexture, MediaPlayer))
                 {
-                    var flip = new Vector2(flipTextureX ? -1 : 1, flipTextureY ? -1 : 1);
+                    var flip = new Vector2(flipX ? -1 : 1, flipY ? -1 : 1);
                     Graphics.Blit(_vlcTexture, OutputTexture, flip, Vector2.zero); // If you wanted to do post processing outside of VLC you could use a shader here.
                 }
             }
@@ -191,6 +213,7 @@ public async Task PreloadAsync(string path, params string[] options)
             _isBackgroundBufferFull = false;
 
             var player = new MediaPlayer(LibVLC);
+            SetNativeOrientation(player, out _backgroundFlipX, out _backgroundFlipY);
             player.Playing += OnBackgroundPlayerReady;
             player.EncounteredError += OnBackgroundPlayerError;
             player.Buffering += OnBackgroundPlayerBuffering;
@@ -260,6 +283,8 @@ public void SwapAndPlayNext()
             DestroyMediaPlayer();
 
             MediaPlayer = _backgroundNativePlayer;
+            _nativeFlipX = _backgroundFlipX;
+            _nativeFlipY = _backgroundFlipY;
 
             if (_vlcAudioSource != null)
                 _vlcAudioSource.Attach(MediaPlayer);
@@ -407,6 +432,7 @@ private void CreateMediaPlayer()
                 DestroyMediaPlayer();
 
             MediaPlayer = new MediaPlayer(LibVLC);
+            SetNativeOrientation(MediaPlayer, out _nativeFlipX, out _nativeFlipY);
 
             if (_vlcAudioSource != null)
                 _vlcAudioSource.Attach(MediaPlayer);
@@ -414,9 +440,40 @@ private void CreateMediaPlayer()
             AttachMainPlayerEvents(MediaPlayer);
         }
 
+        // Lets VLC render with the flips, when the plugin supports it, to spare a flipping blit
+        private void SetNativeOrientation(MediaPlayer player, out bool flipX, out bool flipY)
+        {
+            bool supported = TextureHelper.SetOrientation(player, flipTextureX, flipTextureY);
+            flipX = supported && flipTextureX;
+            flipY = supported && flipTextureY;
+        }
+
+        private bool RegisterOutputTarget()
+        {
+            if (_targetPlayer == MediaPlayer && _targetTexture == OutputTexture)
+                return _targetRegistered;
+
+            UnregisterOutputTarget();
+            _targetPlayer = MediaPlayer;
+            _targetTexture = OutputTexture;
+            _targetRegistered = TextureHelper.SetTargetTexture(MediaPlayer, OutputTexture);
+            Log($"VLCMediaPlayer copying frames to the output texture natively: {_targetRegistered}");
+            return _targetRegistered;
+        }
+
+        private void UnregisterOutputTarget()
+        {
+            if (_targetRegistered)
+                TextureHelper.SetTargetTexture(_targetPlayer, null);
+            _targetPlayer = null;
+            _targetTexture = null;
+            _targetRegistered = false;
+        }
+
         private void DestroyMediaPlayer()
         {
             Log("VLCMediaPlayer DestroyMediaPlayer");
+            UnregisterOutputTarget();
             MediaPlayer?.Stop();
             MediaPlayer?.Dispose();
             MediaPlayer = null;
@@ -472,6 +529,8 @@ private void DestroyTextures()
         {
             Log($"VLCMediaPlayer DestroyTextures");
 
+            UnregisterOutputTarget();
+
             if (OutputTexture != null)
             {
                 if (RenderTexture.active == OutputTexture)
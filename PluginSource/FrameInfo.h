@@ -0,0 +1,63 @@
+#ifndef FRAME_INFO_H
+#define FRAME_INFO_H
+
+#include <atomic>
+#include <cstdint>
+
+// Timing information carried by each published frame, as returned by
+// libvlc_unity_get_texture_ex. Layout is part of the plugin ABI.
+struct FrameInfo
+{
+    // Monotonically increasing per player, starting at 1. 0 means no frame
+    // was published yet. Gaps between acquired frames are dropped frames.
+    uint64_t frame_number = 0;
+    // libvlc_clock() when VLC finished rendering the frame, in microseconds.
+    int64_t swap_time_us = 0;
+    // Playback position when the frame was rendered, in milliseconds, or -1
+    // when unknown.
+    int64_t media_time_ms = -1;
+};
+
+// Playback position of a player as reported by libvlc events, readable from
+// VLC's vout thread without going through the player (and its lock). While
+// playing, the position is extrapolated at normal rate from the last report.
+class MediaClock
+{
+public:
+    // Event side: libvlc_MediaPlayerTimeChanged
+    void setTime(int64_t media_time_ms, int64_t now_us)
+    {
+        m_time_ms.store(media_time_ms, std::memory_order_relaxed);
+        m_origin_us.store(now_us - media_time_ms * 1000, std::memory_order_relaxed);
+    }
+
+    // Event side: playing, paused and stopped state changes
+    void setPlaying(bool playing)
+    {
+        m_playing.store(playing, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        m_playing.store(false, std::memory_order_relaxed);
+        m_time_ms.store(-1, std::memory_order_relaxed);
+    }
+
+    int64_t timeAt(int64_t now_us) const
+    {
+        int64_t time_ms = m_time_ms.load(std::memory_order_relaxed);
+        if (time_ms < 0 || !m_playing.load(std::memory_order_relaxed))
+            return time_ms;
+        int64_t extrapolated = (now_us - m_origin_us.load(std::memory_order_relaxed)) / 1000;
+        // Both values are not updated atomically together, never report a
+        // position older than the last one known.
+        return extrapolated > time_ms ? extrapolated : time_ms;
+    }
+
+private:
+    std::atomic<int64_t> m_time_ms{-1};
+    std::atomic<int64_t> m_origin_us{0};
+    std::atomic<bool> m_playing{false};
+};
+
+#endif /* FRAME_INFO_H */
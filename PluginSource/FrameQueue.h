@@ -0,0 +1,405 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "TripleBuffer.h"
+
+// How frames waiting in a FrameQueue are handed to Unity.
+enum class FrameQueueMode : int
+{
+    // Unity always gets the most recent frame and older unconsumed ones are
+    // dropped. Lowest latency, meant for live sources.
+    Mailbox = 0,
+    // Frames are handed out in order. When the queue is full the producer
+    // sleeps until Unity consumes one instead of dropping, up to
+    // FrameQueueIndex::kFifoTimeoutMs so that a stalled consumer cannot hold
+    // VLC's vout thread forever.
+    Fifo = 1,
+};
+
+// Lock-free single-producer/single-consumer queue of 2 to kMaxSlots frame
+// slots.
+//
+// The producer (VLC's vout thread, in swap) owns the slot being rendered into
+// and the consumer (Unity's main thread, in getVideoFrame) owns the slot being
+// displayed. Every other slot is either free or queued. Each slot has its own
+// atomic state word; queued slots also carry a sequence number so that the
+// consumer can pick the oldest (FIFO) or newest (mailbox) frame. A slot only
+// changes hands through a compare-and-swap on its state word, which resolves
+// the one real race: the producer reclaiming a queued frame while the consumer
+// takes it.
+//
+// The slot count and mode are producer-side settings, changed through
+// configure() when the slots are (re)allocated. Slots past the count are never
+// rendered into again, the consumer just releases the one it may still hold.
+//
+// Three slots in mailbox mode, the default, is what a TripleBufferIndex does
+// with a single exchange per side, without scanning the slot states. The
+// queue runs on one in that layout, and hands the slots over between the two
+// protocols on configure(): the triple buffer is open exactly while it is in
+// use, which is what the consumer checks first.
+class FrameQueueIndex
+{
+public:
+    static constexpr size_t kMinSlots = 2;
+    static constexpr size_t kMaxSlots = 8;
+    static constexpr size_t kDefaultSlots = 3;
+    // An enumerator rather than a static member, as std::chrono takes it by
+    // reference and C++14 would then need an out-of-line definition.
+    enum : int { kFifoTimeoutMs = 100 };
+
+    // Starts on the triple buffer, with its slots
+    FrameQueueIndex()
+    {
+        for (auto& state : m_state)
+            state.store(kFree, std::memory_order_relaxed);
+    }
+    FrameQueueIndex(const FrameQueueIndex&) = delete;
+    FrameQueueIndex& operator=(const FrameQueueIndex&) = delete;
+
+    // Mailbox needs a spare slot to queue into while the producer renders and
+    // the consumer displays; FIFO can run with two, at the cost of the
+    // producer waiting on every frame.
+    static size_t minSlots(FrameQueueMode mode)
+    {
+        return mode == FrameQueueMode::Mailbox ? 3 : kMinSlots;
+    }
+
+    size_t slotCount() const { return m_count.load(std::memory_order_relaxed); }
+    FrameQueueMode mode() const { return m_mode.load(std::memory_order_relaxed); }
+
+    // Producer side: slot VLC is currently rendering into.
+    size_t renderIndex() const { return m_render; }
+
+    // Consumer side: slot last handed to Unity.
+    size_t displayIndex() const { return m_display; }
+
+    // Producer side: change the slot count and mode. Pending frames are
+    // dropped, the caller is expected to (re)allocate the first `slots` slots.
+    void configure(size_t slots, FrameQueueMode mode)
+    {
+        if (slots < minSlots(mode))
+            slots = minSlots(mode);
+        if (slots > kMaxSlots)
+            slots = kMaxSlots;
+
+        const bool triple = slots == TripleBufferIndex::kSlots && mode == FrameQueueMode::Mailbox;
+        if (m_triple_open) {
+            m_triple.discard();
+            if (triple)
+                return;
+            leaveTripleBuffer();
+        } else {
+            discard();
+        }
+        m_mode.store(mode, std::memory_order_relaxed);
+        m_count.store(slots, std::memory_order_relaxed);
+        if (triple && enterTripleBuffer())
+            return;
+        if (m_render < slots)
+            return;
+        m_state[m_render].store(kFree, std::memory_order_release);
+        // Only the consumer's slot can be busy in range, unless it is in the
+        // middle of swapping it, so a free one shows up right away.
+        size_t slot = 0;
+        while (!findFree(slot))
+            std::this_thread::yield();
+        take(slot);
+    }
+
+    // Producer side: queue the render slot for the consumer and move on to
+    // another one. Returns true when a queued frame had to be dropped to make
+    // room for it.
+    bool publish()
+    {
+        if (m_triple_open) {
+            const bool overwritten = m_triple.publish();
+            m_render = m_triple.renderIndex();
+            return overwritten;
+        }
+
+        m_seq += kSeqStep;
+        m_state[m_render].store(m_seq | kQueued, std::memory_order_release);
+
+        const bool fifo = mode() == FrameQueueMode::Fifo;
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(kFifoTimeoutMs);
+        for (;;) {
+            size_t slot = 0;
+            if (findFree(slot)) {
+                take(slot);
+                return false;
+            }
+            if (fifo && std::chrono::steady_clock::now() < deadline) {
+                waitForFree(deadline);
+                continue;
+            }
+            // Recycle the oldest queued frame. This can only fail if the
+            // consumer grabbed it in the meantime, freeing its previous slot.
+            uint32_t word = 0;
+            if (findQueued(false, 0, slot, word) &&
+                m_state[slot].compare_exchange_strong(word, kRendering,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_relaxed)) {
+                m_render = slot;
+                return true;
+            }
+        }
+    }
+
+    // Consumer side: take the next frame, the newest one in mailbox mode and
+    // the oldest one in FIFO mode. Returns false and keeps the current display
+    // slot when nothing is queued. In mailbox mode the frames skipped over are
+    // released and their count is added to *dropped.
+    bool acquire(uint32_t* dropped = nullptr)
+    {
+        // Frames overwritten in the triple buffer are counted by publish()
+        if (m_triple.isOpen()) {
+            if (!m_triple.acquire())
+                return false;
+            m_display = m_triple.displayIndex();
+            return true;
+        }
+
+        const bool newest = mode() == FrameQueueMode::Mailbox;
+        uint32_t word = 0;
+        for (;;) {
+            size_t slot = 0;
+            if (!findQueued(newest, kMaxSlots, slot, word))
+                return false;
+            // An older frame may have been queued in a slot the scan had
+            // already passed. It was published before the one found, so a
+            // second pass is guaranteed to see it.
+            if (!newest)
+                findQueued(false, kMaxSlots, slot, word);
+            if (!m_state[slot].compare_exchange_strong(word, kDisplayed,
+                                                       std::memory_order_acq_rel,
+                                                       std::memory_order_relaxed))
+                continue; // recycled by the producer, look again
+            m_state[m_display].store(kFree, std::memory_order_release);
+            m_display = slot;
+            break;
+        }
+
+        if (!newest) {
+            wakeProducer();
+        } else {
+            uint32_t skipped = 0;
+            for (auto& state : m_state) {
+                uint32_t other = state.load(std::memory_order_relaxed);
+                if ((other & kStateMask) == kQueued && isOlder(other, word) &&
+                    state.compare_exchange_strong(other, kFree,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed))
+                    skipped++;
+            }
+            if (dropped)
+                *dropped += skipped;
+        }
+        return true;
+    }
+
+    // Either side: whether a published frame is waiting to be acquired.
+    bool hasFresh() const
+    {
+        if (m_triple.isOpen())
+            return m_triple.hasFresh();
+        for (auto& state : m_state)
+            if ((state.load(std::memory_order_acquire) & kStateMask) == kQueued)
+                return true;
+        return false;
+    }
+
+    // Producer side: drop every queued frame (eg. after the slots have been
+    // reallocated and the published content is meaningless). Safe to call
+    // while the consumer is running, it will at worst acquire an empty frame.
+    void discard()
+    {
+        if (m_triple_open) {
+            m_triple.discard();
+            return;
+        }
+        for (auto& state : m_state) {
+            uint32_t word = state.load(std::memory_order_relaxed);
+            if ((word & kStateMask) == kQueued)
+                state.compare_exchange_strong(word, kFree,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // Low bits of a slot state word hold its state, the rest the sequence
+    // number of the frame it holds while queued.
+    static constexpr uint32_t kFree = 0;
+    static constexpr uint32_t kRendering = 1;
+    static constexpr uint32_t kQueued = 2;
+    static constexpr uint32_t kDisplayed = 3;
+    static constexpr uint32_t kStateMask = 0x3;
+    static constexpr uint32_t kSeqStep = 0x4;
+
+    // Wrap-around safe sequence comparison
+    static bool isOlder(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>((a & ~kStateMask) - (b & ~kStateMask)) < 0;
+    }
+
+    bool findFree(size_t& slot) const
+    {
+        const size_t count = slotCount();
+        for (size_t i = 0; i < count; i++) {
+            if (m_state[i].load(std::memory_order_acquire) == kFree) {
+                slot = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Looks for the newest or oldest queued slot, among the first `limit`
+    // ones (0 meaning the configured count).
+    bool findQueued(bool newest, size_t limit, size_t& slot, uint32_t& word) const
+    {
+        const size_t count = limit ? limit : slotCount();
+        bool found = false;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t w = m_state[i].load(std::memory_order_acquire);
+            if ((w & kStateMask) != kQueued)
+                continue;
+            if (!found || (newest ? isOlder(word, w) : isOlder(w, word))) {
+                slot = i;
+                word = w;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Only the producer moves a slot out of the free state, a plain store is
+    // enough.
+    void take(size_t slot)
+    {
+        m_state[slot].store(kRendering, std::memory_order_relaxed);
+        m_render = slot;
+    }
+
+    // Producer side: moves the slots from the triple buffer to the states.
+    // Once it is closed the consumer keeps its slot and only ever scans the
+    // states, where nothing is queued until the next publish().
+    void leaveTripleBuffer()
+    {
+        const size_t display = m_triple.close();
+        m_triple_open = false;
+        for (size_t i = 0; i < kMaxSlots; i++)
+            m_state[i].store(i == display ? kDisplayed : i == m_render ? kRendering : kFree,
+                             std::memory_order_relaxed);
+    }
+
+    // Producer side, nothing queued: moves the slots from the states to the
+    // triple buffer. Fails, leaving the queue as is, while the consumer holds
+    // a slot past the first three.
+    bool enterTripleBuffer()
+    {
+        // An acquire that took a frame before the discard is about to release
+        // the slot it replaced, no other one can start
+        size_t display = 0;
+        while (!findDisplayed(display))
+            std::this_thread::yield();
+        if (display >= TripleBufferIndex::kSlots)
+            return false;
+        if (m_render >= TripleBufferIndex::kSlots || m_render == display)
+            m_render = (display + 1) % TripleBufferIndex::kSlots;
+        m_triple.open(m_render, display);
+        m_triple_open = true;
+        return true;
+    }
+
+    // Producer side, FIFO mode: sleeps until the consumer releases a slot or
+    // the deadline passes.
+    void waitForFree(std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(m_wait_lock);
+        m_producer_waiting.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in wakeProducer(): either the consumer sees
+        // the flag, or this scan sees the slot it released
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_t slot = 0;
+        m_wait_cond.wait_until(lock, deadline, [&] { return findFree(slot); });
+        m_producer_waiting.store(false, std::memory_order_relaxed);
+    }
+
+    // Consumer side, FIFO mode: wakes the producer once a slot was released.
+    void wakeProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_producer_waiting.load(std::memory_order_relaxed))
+            return;
+        // Taken so that the notification cannot fall between the producer's
+        // scan and its wait
+        std::lock_guard<std::mutex> lock(m_wait_lock);
+        m_wait_cond.notify_one();
+    }
+
+    // The slot the consumer displays, when it is the only one in that state
+    bool findDisplayed(size_t& slot) const
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < kMaxSlots; i++) {
+            if (m_state[i].load(std::memory_order_acquire) == kDisplayed) {
+                slot = i;
+                found++;
+            }
+        }
+        return found == 1;
+    }
+
+    // Shared state, written by both sides.
+    char m_pad0[64];
+    std::atomic<uint32_t> m_state[kMaxSlots];
+    std::atomic<size_t> m_count{kDefaultSlots};
+    std::atomic<FrameQueueMode> m_mode{FrameQueueMode::Mailbox};
+    // Padded on its own, in use for the default layout
+    TripleBufferIndex m_triple;
+    // Producer private
+    size_t m_render = 0;
+    uint32_t m_seq = 0;
+    bool m_triple_open = true;
+    char m_pad2[64];
+    // FIFO mode, the producer waiting for a free slot
+    std::atomic<bool> m_producer_waiting{false};
+    std::mutex m_wait_lock;
+    std::condition_variable m_wait_cond;
+    // Consumer private, the triple buffer's own display slot while it is open
+    size_t m_display = 2;
+    char m_pad3[64];
+};
+
+// Frame queue storing the per-slot resources alongside the indices. Storage
+// exists for kMaxSlots slots, only the first slotCount() are in use.
+template <typename Slot>
+class FrameQueue : public FrameQueueIndex
+{
+public:
+    Slot& renderSlot() { return m_slots[renderIndex()]; }
+    Slot& displaySlot() { return m_slots[displayIndex()]; }
+    const Slot& displaySlot() const { return m_slots[displayIndex()]; }
+
+    Slot& operator[](size_t i) { return m_slots[i]; }
+    const Slot& operator[](size_t i) const { return m_slots[i]; }
+
+    // Iterates over every slot, used or not, for releasing resources.
+    Slot* begin() { return m_slots; }
+    Slot* end() { return m_slots + kMaxSlots; }
+
+private:
+    Slot m_slots[kMaxSlots];
+};
+
+#endif /* FRAME_QUEUE_H */
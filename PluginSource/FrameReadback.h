@@ -0,0 +1,30 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include "FrameInfo.h"
+#include <cstdint>
+
+// Pixel layouts of libvlc_unity_request_readback
+enum class ReadbackFormat : int32_t
+{
+    RGBA8 = 0,
+    RGB8 = 1,
+    // BT.709 luma
+    GRAY8 = 2,
+};
+
+// Frame read back to system memory, as returned by
+// libvlc_unity_poll_readback. Layout is part of the plugin ABI.
+struct ReadbackFrame
+{
+    // Rows from the top of the picture, stride bytes apart
+    const void* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0;
+    int32_t format = 0;
+    // Timing of the frame that was read back
+    FrameInfo info;
+};
+
+#endif /* FRAME_READBACK_H */
@@ -0,0 +1,607 @@
+#define LOG_CATEGORY LogCategory::Core
+
+#include "LinuxBackendProbe.h"
+#include "LinuxCPUVideoOutput.h"
+#include "LinuxDRMDevice.h"
+#include "RenderAPI_OpenGLGLX.h"
+#if defined(SUPPORT_EGL)
+#include "RenderAPI_OpenGLLinuxEGL.h"
+#endif
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <xf86drm.h>
+
+namespace {
+
+// Size of the synthetic frames, the common case for what gets played
+enum : unsigned { kProbeWidth = 1920, kProbeHeight = 1080 };
+// Frames to settle imports and allocations, then frames measured
+enum : unsigned { kWarmupFrames = 4, kMeasuredFrames = 16 };
+// Bound on setting up a backend, and on every frame of a measure: a backend
+// that slow is not working
+enum : int { kOpenTimeoutMs = 1000, kStepTimeoutMs = 250 };
+// Bound on the whole probe, which stalls the render thread
+enum : int { kProbeBudgetMs = 1500 };
+
+const char* const kBackendNames[] = {
+    "glx-sharegroup",
+    "glx-dmabuf",
+    "egl-dmabuf",
+    "cpu",
+};
+static_assert(sizeof(kBackendNames) / sizeof(kBackendNames[0]) == static_cast<size_t>(LinuxBackend::Count),
+              "one name per backend");
+
+bool backendFromName(const std::string& name, LinuxBackend* backend)
+{
+    for (int i = 0; i < static_cast<int>(LinuxBackend::Count); i++) {
+        if (name == kBackendNames[i]) {
+            *backend = static_cast<LinuxBackend>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool backendSupported(LinuxBackend backend)
+{
+    switch (backend) {
+    case LinuxBackend::GLXShareGroup:
+    case LinuxBackend::GLXDMABuf:
+        return true;
+    case LinuxBackend::EGLDMABuf:
+#if defined(SUPPORT_EGL)
+        return true;
+#else
+        return false;
+#endif
+    case LinuxBackend::CPU:
+        // The watermark is drawn by VLC's GL context
+#if defined(SHOW_WATERMARK)
+        return false;
+#else
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+// The CPU output goes with the EGL backend when there is one: it can host it
+// next to a GLX as well as an EGL Unity context
+bool hostedByEGL(LinuxBackend backend)
+{
+#if defined(SUPPORT_EGL)
+    return backend == LinuxBackend::EGLDMABuf || backend == LinuxBackend::CPU;
+#else
+    (void)backend;
+    return false;
+#endif
+}
+
+std::string glString(GLenum name)
+{
+    const char* value = reinterpret_cast<const char*>(glGetString(name));
+    return value ? value : "?";
+}
+
+// Gray level of a synthetic frame, different from the previous one
+uint8_t frameValue(unsigned frame)
+{
+    return static_cast<uint8_t>(48 + (frame * 37) % 160);
+}
+
+bool makeCurrent(void* opaque, bool current)
+{
+    return static_cast<RenderAPI_OpenGLBase*>(opaque)->makeCurrent(current);
+}
+
+// Timeout of a wait, in ms, that must end by deadline
+int timeoutUntil(std::chrono::steady_clock::time_point deadline, int timeout_ms)
+{
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    return static_cast<int>(std::max<decltype(left)>(0, std::min<decltype(left)>(left, timeout_ms)));
+}
+
+} // namespace
+
+const char* LinuxBackendName(LinuxBackend backend)
+{
+    const int index = static_cast<int>(backend);
+    if (index < 0 || index >= static_cast<int>(LinuxBackend::Count))
+        return "?";
+    return kBackendNames[index];
+}
+
+// Frames handed between the render thread and the VLC-like one
+struct LinuxBackendProbe::Handshake
+{
+    std::mutex lock;
+    std::condition_variable cond;
+    // Set by the VLC side once the output is configured, or failed to
+    bool opened = false;
+    bool failed = false;
+    // Frames asked for by the render thread and done by the VLC side
+    unsigned requested = 0;
+    unsigned rendered = 0;
+    // The render thread is done, the VLC side closes the output
+    bool finished = false;
+
+    template <typename Predicate>
+    bool waitFor(int timeout_ms, Predicate predicate)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return cond.wait_for(guard, std::chrono::milliseconds(timeout_ms), predicate);
+    }
+};
+
+LinuxBackendProbe& LinuxBackendProbe::instance()
+{
+    static LinuxBackendProbe probe;
+    return probe;
+}
+
+void LinuxBackendProbe::load(UnityGfxRenderer renderer)
+{
+    readCache();
+    probeOnce(renderer);
+}
+
+void LinuxBackendProbe::probeOnce(UnityGfxRenderer renderer)
+{
+    if (renderer != kUnityGfxRendererOpenGLCore)
+        return;
+    if (m_probed.exchange(true))
+        return;
+
+#if defined(SUPPORT_EGL)
+    const bool unity_egl = eglGetCurrentContext() != EGL_NO_CONTEXT;
+#else
+    const bool unity_egl = false;
+#endif
+    if (!unity_egl && glXGetCurrentContext() == nullptr) {
+        // Not on the render thread, the first render event will do
+        m_probed.store(false);
+        return;
+    }
+    m_unity_egl.store(unity_egl, std::memory_order_relaxed);
+
+    // The backends keep Unity's context in statics set by whichever class
+    // the early instance has, the players may get the other one
+    {
+        RenderAPI_OpenGLGLX glx(renderer, LinuxBackend::GLXDMABuf);
+        glx.retrieveOpenGLContext();
+#if defined(SUPPORT_EGL)
+        RenderAPI_OpenGLLinuxEGL egl(renderer, LinuxBackend::EGLDMABuf);
+        egl.retrieveOpenGLContext();
+#endif
+    }
+
+    const std::string key = cacheKey();
+    {
+        std::lock_guard<std::mutex> lock(m_cache_lock);
+        auto cached = m_cache.find(key);
+        if (cached != m_cache.end() && backendSupported(cached->second)) {
+            m_selected.store(static_cast<int>(cached->second), std::memory_order_relaxed);
+            DEBUG("[BackendProbe] using cached backend %s for %s",
+                  LinuxBackendName(cached->second), key.c_str());
+            return;
+        }
+    }
+
+    DEBUG("[BackendProbe] measuring the backends for %s", key.c_str());
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(kProbeBudgetMs);
+    LinuxBackend best = LinuxBackend::Count;
+    double best_ms = 0;
+    for (int i = 0; i < static_cast<int>(LinuxBackend::Count); i++) {
+        const LinuxBackend backend = static_cast<LinuxBackend>(i);
+        if (!backendSupported(backend))
+            continue;
+        // GLX contexts cannot share anything with an EGL Unity context
+        if (unity_egl && !hostedByEGL(backend))
+            continue;
+        const double ms = measure(renderer, backend, deadline);
+        if (std::chrono::steady_clock::now() >= deadline) {
+            // Partial results would favor the backends measured first, and
+            // are not cached so that a later run may finish the probe
+            DEBUG("[BackendProbe] out of time measuring %s, keeping %s",
+                  LinuxBackendName(backend), LinuxBackendName(fallbackBackend()));
+            return;
+        }
+        if (ms < 0) {
+            DEBUG("[BackendProbe] %s: not working", LinuxBackendName(backend));
+            continue;
+        }
+        DEBUG("[BackendProbe] %s: %.3f ms per frame", LinuxBackendName(backend), ms);
+        if (best == LinuxBackend::Count || ms < best_ms) {
+            best = backend;
+            best_ms = ms;
+        }
+    }
+
+    if (best == LinuxBackend::Count) {
+        DEBUG("[BackendProbe] no backend passed, keeping %s", LinuxBackendName(fallbackBackend()));
+        return;
+    }
+    DEBUG("[BackendProbe] selected %s", LinuxBackendName(best));
+    m_selected.store(static_cast<int>(best), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_cache_lock);
+        m_cache[key] = best;
+    }
+    writeCache();
+}
+
+bool LinuxBackendProbe::setOverride(int backend)
+{
+    if (backend != -1 && (backend < 0 || backend >= static_cast<int>(LinuxBackend::Count) ||
+                          !backendSupported(static_cast<LinuxBackend>(backend)))) {
+        DEBUG("[BackendProbe] unsupported backend %d", backend);
+        return false;
+    }
+    m_override.store(backend, std::memory_order_relaxed);
+    if (backend == -1)
+        DEBUG("[BackendProbe] back to the probed backend");
+    else
+        DEBUG("[BackendProbe] backend forced to %s", LinuxBackendName(static_cast<LinuxBackend>(backend)));
+    return true;
+}
+
+LinuxBackend LinuxBackendProbe::selected() const
+{
+    int backend = m_override.load(std::memory_order_relaxed);
+    if (backend < 0)
+        backend = m_selected.load(std::memory_order_relaxed);
+    if (backend < 0)
+        return fallbackBackend();
+    return static_cast<LinuxBackend>(backend);
+}
+
+LinuxBackend LinuxBackendProbe::fallbackBackend() const
+{
+#if defined(SUPPORT_EGL)
+    if (m_unity_egl.load(std::memory_order_relaxed))
+        return LinuxBackend::EGLDMABuf;
+    const char* session_type = getenv("XDG_SESSION_TYPE");
+    const char* wayland_display = getenv("WAYLAND_DISPLAY");
+    if ((session_type && strcmp(session_type, "wayland") == 0) || wayland_display)
+        return LinuxBackend::EGLDMABuf;
+#endif
+    return LinuxBackend::GLXDMABuf;
+}
+
+RenderAPI* LinuxBackendProbe::createRenderAPI(UnityGfxRenderer renderer, LinuxBackend backend) const
+{
+    if (!backendSupported(backend))
+        backend = fallbackBackend();
+#if defined(SUPPORT_EGL)
+    if (hostedByEGL(backend))
+        return new RenderAPI_OpenGLLinuxEGL(renderer, backend);
+#endif
+    return new RenderAPI_OpenGLGLX(renderer, backend);
+}
+
+// ---------------------------------------------------------------------------
+// Cache
+// ---------------------------------------------------------------------------
+
+// Render thread, Unity's context current
+std::string LinuxBackendProbe::cacheKey() const
+{
+    std::string driver = "none";
+    if (LinuxDRMDevice* drm = LinuxDRMDevice::acquire()) {
+        if (drmVersionPtr version = drmGetVersion(drm->fd())) {
+            driver = std::string(version->name, version->name_len);
+            drmFreeVersion(version);
+        }
+        drm->release();
+    }
+
+    std::string key = "driver=" + driver +
+                      " context=" + (m_unity_egl.load(std::memory_order_relaxed) ? "egl" : "glx") +
+                      " vendor=" + glString(GL_VENDOR) +
+                      " renderer=" + glString(GL_RENDERER) +
+                      " version=" + glString(GL_VERSION);
+    // One line per entry, the backend name first
+    std::replace(key.begin(), key.end(), '\n', ' ');
+    std::replace(key.begin(), key.end(), '\t', ' ');
+    return key;
+}
+
+std::string LinuxBackendProbe::cachePath()
+{
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && cache_home[0] == '/')
+        return std::string(cache_home) + "/vlc-unity/linux-backend";
+    const char* home = getenv("HOME");
+    if (home && home[0] == '/')
+        return std::string(home) + "/.cache/vlc-unity/linux-backend";
+    return std::string();
+}
+
+void LinuxBackendProbe::readCache()
+{
+    const std::string path = cachePath();
+    if (path.empty())
+        return;
+    std::ifstream file(path);
+    if (!file)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_cache_lock);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        const size_t tab = line.find('\t');
+        LinuxBackend backend;
+        if (tab == std::string::npos || !backendFromName(line.substr(0, tab), &backend))
+            continue;
+        m_cache[line.substr(tab + 1)] = backend;
+    }
+    DEBUG("[BackendProbe] %zu cached backends in %s", m_cache.size(), path.c_str());
+}
+
+void LinuxBackendProbe::writeCache() const
+{
+    const std::string path = cachePath();
+    if (path.empty())
+        return;
+
+    // Create the missing directories, the parent of the cache home included
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+        mkdir(path.substr(0, slash).c_str(), 0755);
+
+    std::ostringstream contents;
+    contents << "# vlc-unity Linux backend per driver, delete to probe again\n";
+    {
+        std::lock_guard<std::mutex> lock(m_cache_lock);
+        for (const auto& entry : m_cache)
+            contents << LinuxBackendName(entry.second) << '\t' << entry.first << '\n';
+    }
+
+    // Replaced atomically, other processes may be reading it
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << contents.str();
+        if (!file) {
+            DEBUG("[BackendProbe] cannot write %s", temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        DEBUG("[BackendProbe] cannot replace %s", path.c_str());
+        remove(temporary.c_str());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Measures
+// ---------------------------------------------------------------------------
+
+// Render thread, Unity's context current. Stands in for Unity: render
+// events, getVideoFrame and sampling the texture, for frames produced by
+// vlcSide on its own thread.
+double LinuxBackendProbe::measure(UnityGfxRenderer renderer, LinuxBackend backend,
+                                  std::chrono::steady_clock::time_point deadline)
+{
+    using steady = std::chrono::steady_clock;
+
+    RenderAPI* api = createRenderAPI(renderer, backend);
+    Handshake handshake;
+    std::thread vlc(vlcSide, api, backend, &handshake);
+
+    bool ok = handshake.waitFor(timeoutUntil(deadline, kOpenTimeoutMs), [&] { return handshake.opened || handshake.failed; }) &&
+              !handshake.failed;
+
+    GLint read_fbo = 0;
+    GLint pack_buffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_fbo);
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pack_buffer);
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::vector<double> times;
+    for (unsigned i = 0; ok && i < kWarmupFrames + kMeasuredFrames; i++) {
+        const steady::time_point start = steady::now();
+        {
+            std::lock_guard<std::mutex> lock(handshake.lock);
+            handshake.requested = i + 1;
+        }
+        handshake.cond.notify_all();
+        ok = handshake.waitFor(timeoutUntil(deadline, kStepTimeoutMs), [&] { return handshake.rendered > i || handshake.failed; }) &&
+             !handshake.failed;
+        if (!ok)
+            break;
+
+        void* texture = nullptr;
+        bool updated = false;
+        const steady::time_point step_deadline =
+            std::min(start + std::chrono::milliseconds(kStepTimeoutMs), deadline);
+        for (;;) {
+            api->performRenderThreadWork();
+            texture = api->getVideoFrame(kProbeWidth, kProbeHeight, &updated);
+            if ((updated && texture) || steady::now() > step_deadline)
+                break;
+            std::this_thread::yield();
+        }
+        if (!updated || !texture) {
+            // Buffers may be reallocated during the first frames
+            if (i < kWarmupFrames)
+                continue;
+            DEBUG("[BackendProbe] %s: frame %u never reached Unity", LinuxBackendName(backend), i);
+            ok = false;
+            break;
+        }
+
+        // Frame fences are waited on by the render event after the acquire
+        api->performRenderThreadWork();
+        uint8_t pixel[4] = {};
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               (GLuint)(size_t)texture, 0);
+        glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        const int expected = frameValue(i);
+        if (std::abs(pixel[0] - expected) > 2) {
+            DEBUG("[BackendProbe] %s: frame %u reads %d instead of %d", LinuxBackendName(backend),
+                  i, pixel[0], expected);
+            ok = false;
+            break;
+        }
+        if (i >= kWarmupFrames)
+            times.push_back(std::chrono::duration<double, std::milli>(steady::now() - start).count());
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)read_fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)pack_buffer);
+    glDeleteFramebuffers(1, &fbo);
+
+    {
+        std::lock_guard<std::mutex> lock(handshake.lock);
+        handshake.finished = true;
+    }
+    handshake.cond.notify_all();
+    vlc.join();
+    // Objects of the CPU output, released with the backend
+    LinuxCPUVideoOutput::collectGarbage();
+
+    if (!ok || times.empty())
+        return -1;
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void LinuxBackendProbe::vlcSide(RenderAPI* api, LinuxBackend backend, Handshake* handshake)
+{
+    // Only what the backend chose itself counts, not a fallback
+    api->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, nullptr);
+
+    libvlc_video_output_setup_cb setup = nullptr;
+    libvlc_video_output_cleanup_cb cleanup = nullptr;
+    libvlc_video_update_output_cb resize = nullptr;
+    libvlc_video_swap_cb swap = nullptr;
+    LinuxCPUVideoOutput* cpu = nullptr;
+#if defined(SUPPORT_EGL)
+    if (hostedByEGL(backend)) {
+        auto* egl = static_cast<RenderAPI_OpenGLLinuxEGL*>(api);
+        if (backend == LinuxBackend::CPU && egl->m_cpu_fallback) {
+            cpu = &egl->m_cpu_output;
+        } else if (backend == LinuxBackend::EGLDMABuf && !egl->m_cpu_fallback &&
+                   egl->m_context != EGL_NO_CONTEXT) {
+            setup = RenderAPI_OpenGLLinuxEGL::dmabuf_setup;
+            cleanup = RenderAPI_OpenGLLinuxEGL::dmabuf_cleanup;
+            resize = RenderAPI_OpenGLLinuxEGL::dmabuf_resize;
+            swap = RenderAPI_OpenGLLinuxEGL::dmabuf_swap;
+        }
+    } else
+#endif
+    {
+        auto* glx = static_cast<RenderAPI_OpenGLGLX*>(api);
+        if (backend == LinuxBackend::CPU && glx->m_cpu_fallback) {
+            cpu = &glx->m_cpu_output;
+        } else if (backend == LinuxBackend::GLXShareGroup && glx->m_share_group) {
+            setup = RenderAPI_OpenGLBase::setup;
+            cleanup = RenderAPI_OpenGLBase::cleanup;
+            resize = RenderAPI_OpenGLBase::resize;
+            swap = RenderAPI_OpenGLBase::swap;
+        } else if (backend == LinuxBackend::GLXDMABuf && !glx->m_cpu_fallback &&
+                   glx->m_dmabuf_initialized) {
+            setup = RenderAPI_OpenGLGLX::dmabuf_setup;
+            cleanup = RenderAPI_OpenGLGLX::dmabuf_cleanup;
+            resize = RenderAPI_OpenGLGLX::dmabuf_resize;
+            swap = RenderAPI_OpenGLGLX::dmabuf_swap;
+        }
+    }
+
+    // Same calls, in the same order, as VLC makes
+    void* opaque = cpu ? static_cast<void*>(cpu) : static_cast<void*>(api);
+    unsigned pitches[5] = {};
+    unsigned lines[5] = {};
+    bool opened = false;
+    if (cpu) {
+        char chroma[5] = "RV32";
+        unsigned width = kProbeWidth;
+        unsigned height = kProbeHeight;
+        opened = LinuxCPUVideoOutput::format_cb(&opaque, chroma, &width, &height, pitches, lines) != 0;
+    } else if (setup) {
+        libvlc_video_setup_device_cfg_t setup_cfg = {};
+        libvlc_video_setup_device_info_t setup_info = {};
+        libvlc_video_render_cfg_t render_cfg = {};
+        render_cfg.width = kProbeWidth;
+        render_cfg.height = kProbeHeight;
+        render_cfg.bitdepth = 8;
+        libvlc_video_output_cfg_t output_cfg = {};
+        if (setup(&opaque, &setup_cfg, &setup_info)) {
+            opened = makeCurrent(opaque, true) && resize(opaque, &render_cfg, &output_cfg);
+            makeCurrent(opaque, false);
+            if (!opened)
+                cleanup(opaque);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(handshake->lock);
+        handshake->opened = opened;
+        handshake->failed = !opened;
+    }
+    handshake->cond.notify_all();
+
+    for (unsigned i = 0; opened; i++) {
+        {
+            std::unique_lock<std::mutex> lock(handshake->lock);
+            handshake->cond.wait(lock, [&] { return handshake->requested > i || handshake->finished; });
+            if (handshake->requested <= i)
+                break;
+        }
+        const uint8_t value = frameValue(i);
+        if (cpu) {
+            void* planes[5] = {};
+            LinuxCPUVideoOutput::lock_cb(opaque, planes);
+            memset(planes[0], value, (size_t)pitches[0] * lines[0]);
+            LinuxCPUVideoOutput::display_cb(opaque, nullptr);
+        } else {
+            if (!makeCurrent(opaque, true)) {
+                std::lock_guard<std::mutex> lock(handshake->lock);
+                handshake->failed = true;
+                handshake->cond.notify_all();
+                break;
+            }
+            glClearColor(value / 255.f, value / 255.f, value / 255.f, 1.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            swap(opaque);
+            makeCurrent(opaque, false);
+        }
+        {
+            std::lock_guard<std::mutex> lock(handshake->lock);
+            handshake->rendered = i + 1;
+        }
+        handshake->cond.notify_all();
+    }
+
+    // Wait for the render thread to be done with the frames before closing
+    {
+        std::unique_lock<std::mutex> lock(handshake->lock);
+        handshake->cond.wait(lock, [&] { return handshake->finished; });
+    }
+    if (opened) {
+        if (cpu)
+            LinuxCPUVideoOutput::cleanup_cb(opaque);
+        else
+            cleanup(opaque);
+    }
+    delete api;
+}
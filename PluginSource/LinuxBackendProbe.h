@@ -0,0 +1,91 @@
+#ifndef LINUX_BACKEND_PROBE_H
+#define LINUX_BACKEND_PROBE_H
+
+#include "Unity/IUnityGraphics.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+class RenderAPI;
+
+// How the Linux OpenGL backends hand VLC's frames over to Unity. The values
+// are those of libvlc_unity_set_linux_backend and mirrored in C#.
+enum class LinuxBackend : int
+{
+    // Textures of a GLX context in Unity's share group
+    GLXShareGroup = 0,
+    // GBM buffers shared through GL_EXT_memory_object_fd, GLX on VLC's side
+    GLXDMABuf = 1,
+    // GBM buffers shared with an EGL context on the render node
+    EGLDMABuf = 2,
+    // Frames decoded on the CPU and uploaded in Unity's context
+    CPU = 3,
+    Count,
+};
+
+const char* LinuxBackendName(LinuxBackend backend);
+
+// Picks the backend of the players created from now on.
+//
+// Every backend that can work on this machine is measured once: a short
+// synthetic round-trip of frames rendered (or written, for the CPU one) on a
+// VLC-like thread, imported and read back in Unity's context, and the one
+// with the lowest median frame time wins. Only Unity's render thread has
+// its context current, so the probe runs at the first render event, unless
+// the plugin is loaded with the context current. The winner is cached on
+// disk per driver and GL renderer, later runs only read it. Until then, or
+// when nothing works, the backend is chosen from the session type like
+// before. The probe runs on the render thread within a time budget: when it
+// runs out, nothing is cached and the session type decides.
+class LinuxBackendProbe
+{
+public:
+    static LinuxBackendProbe& instance();
+
+    // Plugin load: reads the cache, and probes right away when Unity's
+    // context is current on this thread
+    void load(UnityGfxRenderer renderer);
+    // Render thread, Unity's context current. Returns at once after the
+    // first call.
+    void probeOnce(UnityGfxRenderer renderer);
+
+    // Forces the backend of the next players, -1 to go back to the probed
+    // one. Returns false for an unknown or unsupported backend.
+    bool setOverride(int backend);
+    // Backend the next players get
+    LinuxBackend selected() const;
+
+    RenderAPI* createRenderAPI(UnityGfxRenderer renderer, LinuxBackend backend) const;
+
+private:
+    LinuxBackendProbe() = default;
+
+    std::string cacheKey() const;
+    static std::string cachePath();
+    void readCache();
+    void writeCache() const;
+
+    // Median frame time in ms, negative when the backend does not work or
+    // the measure did not end by deadline
+    double measure(UnityGfxRenderer renderer, LinuxBackend backend,
+                   std::chrono::steady_clock::time_point deadline);
+    // VLC's side of a measure, on a thread of its own like a vout thread
+    struct Handshake;
+    static void vlcSide(RenderAPI* api, LinuxBackend backend, Handshake* handshake);
+    LinuxBackend fallbackBackend() const;
+
+    std::atomic<bool> m_probed{false};
+    std::atomic<int> m_override{-1};
+    std::atomic<int> m_selected{-1};
+    // Whether Unity's context is an EGL one, set by the probe
+    std::atomic<bool> m_unity_egl{false};
+
+    // Cache file contents, key to backend
+    mutable std::mutex m_cache_lock;
+    std::map<std::string, LinuxBackend> m_cache;
+};
+
+#endif /* LINUX_BACKEND_PROBE_H */
@@ -0,0 +1,506 @@
+#define LOG_CATEGORY LogCategory::DMABuf
+
+#include "LinuxCPUVideoOutput.h"
+#include "Log.h"
+
+#include <cstring>
+
+namespace {
+
+// Output textures replaced by a resize stay alive this many render events
+// after the main thread stopped handing them out: commands recorded on the
+// main thread before that still sample them.
+enum : unsigned { kRetireEvents = 2 };
+
+// Objects of released outputs, waiting for a render event to delete them in
+// Unity's context
+struct Garbage
+{
+    std::mutex lock;
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> textures;
+    std::vector<GLuint> framebuffers;
+    std::vector<GLsync> fences;
+    std::atomic<bool> pending{false};
+};
+
+Garbage& garbage()
+{
+    // Never destroyed, like the buffer pool: outputs may still be released
+    // during static destruction
+    static Garbage* garbage = new Garbage;
+    return *garbage;
+}
+
+// Unity caches its GL state, what the uploads bind is put back afterwards
+class UnityStateGuard
+{
+public:
+    UnityStateGuard()
+    {
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_texture);
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &m_unpack_buffer);
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &m_unpack_alignment);
+        glGetIntegerv(GL_UNPACK_ROW_LENGTH, &m_unpack_row_length);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &m_read_fbo);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_draw_fbo);
+    }
+    ~UnityStateGuard()
+    {
+        glBindTexture(GL_TEXTURE_2D, (GLuint)m_texture);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (GLuint)m_unpack_buffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, m_unpack_alignment);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, m_unpack_row_length);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)m_read_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_draw_fbo);
+    }
+
+private:
+    GLint m_texture = 0;
+    GLint m_unpack_buffer = 0;
+    GLint m_unpack_alignment = 4;
+    GLint m_unpack_row_length = 0;
+    GLint m_read_fbo = 0;
+    GLint m_draw_fbo = 0;
+};
+
+GLuint createTexture(unsigned width, unsigned height, GLenum filter, unsigned levels = 1)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // allocates the other levels, regenerated for each presented frame
+    if (levels > 1)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    return texture;
+}
+
+} // namespace
+
+LinuxCPUVideoOutput::LinuxCPUVideoOutput(RenderAPI_OpenGLBase& host, const char* logPrefix,
+                                         LinuxGLProcLoader loadProc) :
+    m_host(host),
+    m_log_prefix(logPrefix),
+    m_load_proc(loadProc)
+{
+}
+
+LinuxCPUVideoOutput::~LinuxCPUVideoOutput()
+{
+    releaseUnityObjects(true);
+}
+
+void LinuxCPUVideoOutput::attach(libvlc_media_player_t* mp)
+{
+    DEBUG("[%s] subscribing to CPU video callbacks %p", m_log_prefix, this);
+    libvlc_video_set_format_callbacks(mp, format_cb, cleanup_cb);
+    libvlc_video_set_callbacks(mp, lock_cb, nullptr, display_cb, this);
+}
+
+// ---------------------------------------------------------------------------
+// VLC callbacks
+// ---------------------------------------------------------------------------
+
+unsigned LinuxCPUVideoOutput::format_cb(void** opaque, char* chroma, unsigned* width,
+                                        unsigned* height, unsigned* pitches, unsigned* lines)
+{
+    auto* that = static_cast<LinuxCPUVideoOutput*>(*opaque);
+    const unsigned w = *width;
+    const unsigned h = *height;
+    DEBUG("[%s] CPU output format %4.4s %ux%u", that->m_log_prefix, chroma, w, h);
+
+    // Decoded as is, the mirroring the GPU outputs get from VLC is done by
+    // the upload blit
+    memcpy(chroma, "RGBA", 4);
+    pitches[0] = w * 4;
+    lines[0] = h;
+
+    std::unique_lock<std::mutex> lock(that->m_lock);
+    that->m_frames.configure(that->m_host.m_frame_queue_slots.load(std::memory_order_relaxed),
+                             that->m_host.m_frame_queue_mode.load(std::memory_order_relaxed));
+    // The buffers of the previous size are deleted by the render thread,
+    // frames go through plain memory until it mapped new ones
+    for (auto& frame : that->m_frames) {
+        frame.mapped = nullptr;
+        frame.data = nullptr;
+    }
+    that->m_width = w;
+    that->m_height = h;
+    that->m_frame_size = (size_t)pitches[0] * lines[0];
+    that->m_generation++;
+
+    that->m_host.setVideoSize(w, h);
+    that->m_host.m_stats.resized();
+    lock.unlock();
+
+    that->m_host.vlcOutputOpened();
+    return 1;
+}
+
+void LinuxCPUVideoOutput::cleanup_cb(void* opaque)
+{
+    auto* that = static_cast<LinuxCPUVideoOutput*>(opaque);
+    DEBUG("[%s] CPU output cleanup", that->m_log_prefix);
+
+    // The last uploaded frame stays displayed, its texture is kept
+    std::unique_lock<std::mutex> lock(that->m_lock);
+    that->m_frames.discard();
+    for (auto& frame : that->m_frames) {
+        frame.mapped = nullptr;
+        frame.data = nullptr;
+        std::vector<uint8_t>().swap(frame.staging);
+    }
+    that->m_width = 0;
+    that->m_height = 0;
+    that->m_frame_size = 0;
+    that->m_generation++;
+    that->m_host.setVideoSize(0, 0);
+    lock.unlock();
+
+    that->m_host.vlcOutputClosed();
+}
+
+void* LinuxCPUVideoOutput::lock_cb(void* opaque, void** planes)
+{
+    auto* that = static_cast<LinuxCPUVideoOutput*>(opaque);
+
+    // The render slot belongs to this thread, only its mapping may change
+    // under the lock
+    std::lock_guard<std::mutex> lock(that->m_lock);
+    CPUFrame& frame = that->m_frames.renderSlot();
+    if (frame.mapped) {
+        frame.data = frame.mapped;
+        std::vector<uint8_t>().swap(frame.staging);
+    } else {
+        frame.staging.resize(that->m_frame_size);
+        frame.data = frame.staging.data();
+    }
+    planes[0] = frame.data;
+    return nullptr;
+}
+
+void LinuxCPUVideoOutput::display_cb(void* opaque, void* /*picture*/)
+{
+    auto* that = static_cast<LinuxCPUVideoOutput*>(opaque);
+    that->m_host.stampFrame(that->m_frames.renderSlot().info);
+    if (that->m_frames.publish())
+        that->m_host.m_stats.framesDropped(1);
+}
+
+// ---------------------------------------------------------------------------
+// Render thread
+// ---------------------------------------------------------------------------
+
+void LinuxCPUVideoOutput::renderThreadWork()
+{
+    collectRetired();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_width == 0 || m_height == 0)
+        return;
+    if (m_objects_generation != m_generation && !createUnityObjects())
+        return;
+
+    // The previous frame is released to VLC by the next acquire, not before
+    // the GPU read it. Never waited for, the frame is picked up by a later
+    // event instead.
+    if (m_upload_fence) {
+        GLenum status = glClientWaitSync(m_upload_fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        glDeleteSync(m_upload_fence);
+        m_upload_fence = nullptr;
+    }
+
+    uint32_t skipped = 0;
+    if (!m_frames.acquire(&skipped))
+        return;
+    const size_t slot = m_frames.displayIndex();
+    const CPUFrame& frame = m_frames.displaySlot();
+    if (!frame.data)
+        return; // Dropped by a format change
+    m_host.unityGpuWorkBegin();
+    upload(frame, slot < m_pbos.size() && frame.data == frame.mapped ? m_pbos[slot] : 0);
+
+    m_upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    if (!m_upload_fence) {
+        // Nothing to wait on, the slot cannot be written before the upload
+        // completed
+        glFinish();
+    }
+
+    {
+        std::lock_guard<std::mutex> info_lock(m_info_lock);
+        m_uploaded_info = frame.info;
+        m_uploaded_width = m_objects_width;
+        m_uploaded_height = m_objects_height;
+        m_uploaded_levels = m_objects_levels;
+    }
+    m_skipped.fetch_add(skipped, std::memory_order_relaxed);
+    m_output_published = true;
+    m_texture.store(m_output_tex, std::memory_order_relaxed);
+    m_uploads.fetch_add(1, std::memory_order_release);
+}
+
+// m_lock held
+bool LinuxCPUVideoOutput::createUnityObjects()
+{
+    deleteUnityObjects();
+    m_objects_generation = m_generation;
+    m_objects_width = m_width;
+    m_objects_height = m_height;
+    m_objects_levels = m_host.m_mipmaps.load(std::memory_order_relaxed) ?
+                       GLTexturePool::mipLevels(m_width, m_height) : 1;
+
+    if (m_buffer_storage == BufferStorage::Unknown) {
+        static const char* requiredExtensions[] = { "GL_ARB_buffer_storage" };
+        m_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(
+            m_load_proc("glBufferStorage", nullptr));
+        const bool supported = m_glBufferStorage &&
+            LinuxGLHasExtensions(m_log_prefix, m_load_proc, nullptr, requiredExtensions, 1);
+        m_buffer_storage = supported ? BufferStorage::Supported : BufferStorage::Unsupported;
+        DEBUG("[%s] CPU frames are %s", m_log_prefix,
+              supported ? "decoded into persistently mapped buffers"
+                        : "uploaded from client memory (no GL_ARB_buffer_storage)");
+    }
+
+    UnityStateGuard state;
+    clearGlErrors();
+
+    m_upload_tex = createTexture(m_width, m_height, GL_NEAREST);
+    m_output_tex = createTexture(m_width, m_height, GL_LINEAR, m_objects_levels);
+
+    glGenFramebuffers(2, m_fbos);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[0]);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_upload_tex, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[1]);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_output_tex, 0);
+    if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+        glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        DEBUG("[%s] incomplete CPU upload framebuffers %ux%u", m_log_prefix, m_width, m_height);
+        deleteUnityObjects();
+        return false;
+    }
+
+    if (m_buffer_storage == BufferStorage::Supported) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const size_t count = m_frames.slotCount();
+        for (size_t i = 0; i < count; i++) {
+            GLuint pbo = 0;
+            glGenBuffers(1, &pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            m_glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)m_frame_size, nullptr, flags);
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)m_frame_size, flags);
+            if (!mapped) {
+                DEBUG("[%s] cannot map a %zu bytes unpack buffer (0x%x), slot %zu uploads from client memory",
+                      m_log_prefix, m_frame_size, glGetError(), i);
+                glDeleteBuffers(1, &pbo);
+                pbo = 0;
+            }
+            // Picked up by the next lock of the slot
+            m_frames[i].mapped = static_cast<uint8_t*>(mapped);
+            m_pbos.push_back(pbo);
+        }
+    }
+
+    DEBUG("[%s] CPU upload objects %ux%u: output_tex=%u, %zu mapped buffers",
+          m_log_prefix, m_width, m_height, m_output_tex, m_pbos.size());
+    return true;
+}
+
+// m_lock held, Unity's context current
+void LinuxCPUVideoOutput::deleteUnityObjects()
+{
+    for (auto& frame : m_frames)
+        frame.mapped = nullptr;
+    for (GLuint pbo : m_pbos) {
+        // Implicitly unmapped
+        if (pbo)
+            glDeleteBuffers(1, &pbo);
+    }
+    m_pbos.clear();
+    if (m_upload_fence) {
+        glDeleteSync(m_upload_fence);
+        m_upload_fence = nullptr;
+    }
+    if (m_fbos[0] || m_fbos[1])
+        glDeleteFramebuffers(2, m_fbos);
+    m_fbos[0] = m_fbos[1] = 0;
+    if (m_upload_tex)
+        glDeleteTextures(1, &m_upload_tex);
+    m_upload_tex = 0;
+
+    // Unity keeps being handed the last frame until the new size has one
+    if (m_output_tex) {
+        if (m_output_published)
+            m_retired.push_back(Retired{ m_output_tex, 0 });
+        else
+            glDeleteTextures(1, &m_output_tex);
+    }
+    m_output_tex = 0;
+    m_output_published = false;
+}
+
+void LinuxCPUVideoOutput::upload(const CPUFrame& frame, GLuint pbo)
+{
+    UnityStateGuard state;
+
+    glBindTexture(GL_TEXTURE_2D, m_upload_tex);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_objects_width, m_objects_height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, pbo ? nullptr : frame.data);
+
+    // Rows come top first, which already is the vertical flip of VLC's
+    // bottom_right orientation in GL, only the horizontal mirror is left.
+    // The player's own flips undo either.
+    const bool mirror = !m_host.m_flip_x.load(std::memory_order_relaxed);
+    const bool flip = m_host.m_flip_y.load(std::memory_order_relaxed);
+    const GLint width = m_objects_width, height = m_objects_height;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[0]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[1]);
+    glBlitFramebuffer(0, 0, width, height,
+                      mirror ? width : 0, flip ? height : 0,
+                      mirror ? 0 : width, flip ? 0 : height,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void LinuxCPUVideoOutput::collectRetired()
+{
+    if (m_retired.empty())
+        return;
+    const GLuint presented = m_presented_tex.load(std::memory_order_relaxed);
+    const GLuint current = m_texture.load(std::memory_order_relaxed);
+    for (auto it = m_retired.begin(); it != m_retired.end();) {
+        if (it->texture == presented || it->texture == current || ++it->events < kRetireEvents) {
+            ++it;
+            continue;
+        }
+        glDeleteTextures(1, &it->texture);
+        it = m_retired.erase(it);
+    }
+}
+
+void LinuxCPUVideoOutput::releaseUnityObjects(bool context_alive)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto& frame : m_frames)
+        frame.mapped = nullptr;
+    // Recreated by the next render event if the output is still in use
+    m_generation++;
+    m_buffer_storage = BufferStorage::Unknown;
+
+    if (context_alive) {
+        Garbage& g = garbage();
+        std::lock_guard<std::mutex> garbage_lock(g.lock);
+        for (GLuint pbo : m_pbos)
+            if (pbo)
+                g.buffers.push_back(pbo);
+        for (GLuint fbo : m_fbos)
+            if (fbo)
+                g.framebuffers.push_back(fbo);
+        if (m_upload_tex)
+            g.textures.push_back(m_upload_tex);
+        if (m_output_tex)
+            g.textures.push_back(m_output_tex);
+        for (const Retired& retired : m_retired)
+            g.textures.push_back(retired.texture);
+        if (m_upload_fence)
+            g.fences.push_back(m_upload_fence);
+        g.pending.store(true, std::memory_order_relaxed);
+    }
+
+    m_pbos.clear();
+    m_fbos[0] = m_fbos[1] = 0;
+    m_upload_tex = 0;
+    m_output_tex = 0;
+    m_output_published = false;
+    m_upload_fence = nullptr;
+    m_retired.clear();
+    m_texture.store(0, std::memory_order_relaxed);
+    m_presented_tex.store(0, std::memory_order_relaxed);
+}
+
+void LinuxCPUVideoOutput::collectGarbage()
+{
+    Garbage& g = garbage();
+    if (!g.pending.load(std::memory_order_relaxed))
+        return;
+    std::lock_guard<std::mutex> lock(g.lock);
+    if (!g.buffers.empty())
+        glDeleteBuffers((GLsizei)g.buffers.size(), g.buffers.data());
+    if (!g.framebuffers.empty())
+        glDeleteFramebuffers((GLsizei)g.framebuffers.size(), g.framebuffers.data());
+    if (!g.textures.empty())
+        glDeleteTextures((GLsizei)g.textures.size(), g.textures.data());
+    for (GLsync fence : g.fences)
+        glDeleteSync(fence);
+    g.buffers.clear();
+    g.framebuffers.clear();
+    g.textures.clear();
+    g.fences.clear();
+    g.pending.store(false, std::memory_order_relaxed);
+}
+
+void LinuxCPUVideoOutput::forgetGarbage()
+{
+    Garbage& g = garbage();
+    std::lock_guard<std::mutex> lock(g.lock);
+    g.buffers.clear();
+    g.framebuffers.clear();
+    g.textures.clear();
+    g.fences.clear();
+    g.pending.store(false, std::memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// Main thread
+// ---------------------------------------------------------------------------
+
+void* LinuxCPUVideoOutput::videoFrame(unsigned /*width*/, unsigned /*height*/, bool* out_updated)
+{
+    if (out_updated)
+        *out_updated = false;
+
+    // Texture of the latest upload or a newer one, never an older one
+    const uint64_t uploads = m_uploads.load(std::memory_order_acquire);
+    const GLuint texture = m_texture.load(std::memory_order_relaxed);
+    const bool updated = uploads != m_presented_uploads;
+    unsigned width = 0, height = 0, levels = 1;
+    if (updated) {
+        // Uploads between two calls were never shown either
+        const uint32_t skipped = m_skipped.exchange(0, std::memory_order_relaxed) +
+                                 (uint32_t)(uploads - m_presented_uploads - 1);
+        m_presented_uploads = uploads;
+        {
+            std::lock_guard<std::mutex> lock(m_info_lock);
+            m_presented_info = m_uploaded_info;
+            width = m_uploaded_width;
+            height = m_uploaded_height;
+            levels = m_uploaded_levels;
+        }
+        m_host.countPresented(m_presented_info, skipped);
+        if (out_updated)
+            *out_updated = true;
+    }
+    m_presented_tex.store(texture, std::memory_order_relaxed);
+    if (updated)
+        m_host.presentFrame(texture, width, height, levels, true);
+    return texture ? (void*)(size_t)texture : nullptr;
+}
+
+bool LinuxCPUVideoOutput::frameInfo(FrameInfo* info) const
+{
+    if (m_presented_info.frame_number == 0)
+        return false;
+    *info = m_presented_info;
+    return true;
+}
@@ -0,0 +1,130 @@
+#ifndef LINUX_CPU_VIDEO_OUTPUT_H
+#define LINUX_CPU_VIDEO_OUTPUT_H
+
+#include "RenderAPI_OpenGLBase.h"
+#include "RenderAPI_OpenGLLinuxDMABuf.h"
+#include "FrameQueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Video output of the Linux backends when frames cannot be shared with
+// Unity's context on the GPU: no DRM render node, or no
+// GL_EXT_memory_object_fd (software rasterizers, most virtual machines).
+//
+// VLC decodes through the libvlc CPU callbacks straight into pixel unpack
+// buffers persistently mapped in Unity's context (GL_ARB_buffer_storage),
+// one per frame queue slot. The render thread uploads the newest frame into
+// the texture handed to Unity. Uploads are asynchronous: the render thread
+// only takes the next frame once the fence following the previous upload
+// signaled, so the buffer goes back to VLC after the GPU read it and neither
+// thread ever waits for the GPU. Without buffer storage, frames go through
+// plain memory and are uploaded from there.
+//
+// Owned by the backend, which routes its callbacks here once it fell back.
+class LinuxCPUVideoOutput
+{
+public:
+    LinuxCPUVideoOutput(RenderAPI_OpenGLBase& host, const char* logPrefix,
+                        LinuxGLProcLoader loadProc);
+    ~LinuxCPUVideoOutput();
+
+    void attach(libvlc_media_player_t* mp);
+
+    // Render thread, Unity's context current
+    void renderThreadWork();
+    // Hands the GL objects over to collectGarbage, from any thread. Their
+    // context may be gone already (device shutdown), then they are forgotten.
+    void releaseUnityObjects(bool context_alive);
+
+    // Unity main thread
+    void* videoFrame(unsigned width, unsigned height, bool* out_updated);
+    bool frameInfo(FrameInfo* info) const;
+
+    // Deletes the objects of released outputs, render thread with Unity's
+    // context current
+    static void collectGarbage();
+    // Unity's context is gone along with the objects
+    static void forgetGarbage();
+
+private:
+    // Drives the callbacks directly while measuring this output
+    friend class LinuxBackendProbe;
+
+    struct CPUFrame {
+        // Where VLC decodes the frame: the mapping of the slot's unpack
+        // buffer once the render thread created it, plain memory until then
+        uint8_t* mapped = nullptr;
+        std::vector<uint8_t> staging;
+        // What the lock callback handed to VLC
+        uint8_t* data = nullptr;
+        FrameInfo info;
+    };
+
+    static unsigned format_cb(void** opaque, char* chroma, unsigned* width,
+                              unsigned* height, unsigned* pitches, unsigned* lines);
+    static void cleanup_cb(void* opaque);
+    static void* lock_cb(void* opaque, void** planes);
+    static void display_cb(void* opaque, void* picture);
+
+    bool createUnityObjects();
+    void deleteUnityObjects();
+    void upload(const CPUFrame& frame, GLuint pbo);
+    void collectRetired();
+
+    RenderAPI_OpenGLBase& m_host;
+    const char* m_log_prefix;
+    LinuxGLProcLoader m_load_proc;
+
+    // Serializes the slot memory and size between VLC's thread and the
+    // render thread, never held while waiting on the frame queue
+    std::mutex m_lock;
+    FrameQueue<CPUFrame> m_frames;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    size_t m_frame_size = 0;
+    // Bumped by every format change, the render thread recreates its
+    // objects when it does not match theirs
+    uint32_t m_generation = 0;
+
+    // Render thread only
+    enum class BufferStorage { Unknown, Supported, Unsupported };
+    BufferStorage m_buffer_storage = BufferStorage::Unknown;
+    PFNGLBUFFERSTORAGEPROC m_glBufferStorage = nullptr;
+    uint32_t m_objects_generation = 0;
+    unsigned m_objects_width = 0;
+    unsigned m_objects_height = 0;
+    unsigned m_objects_levels = 1;
+    std::vector<GLuint> m_pbos;
+    GLuint m_upload_tex = 0;
+    GLuint m_output_tex = 0;
+    GLuint m_fbos[2] = {};
+    GLsync m_upload_fence = nullptr;
+    bool m_output_published = false;
+    // Output textures replaced by a resize, deleted once the main thread
+    // stopped handing them out and Unity's commands using them ran
+    struct Retired {
+        GLuint texture;
+        unsigned events;
+    };
+    std::vector<Retired> m_retired;
+
+    // Handed over to the main thread by each upload
+    std::atomic<GLuint> m_texture{0};
+    std::atomic<uint64_t> m_uploads{0};
+    std::atomic<uint32_t> m_skipped{0};
+    mutable std::mutex m_info_lock;
+    FrameInfo m_uploaded_info;
+    unsigned m_uploaded_width = 0;
+    unsigned m_uploaded_height = 0;
+    unsigned m_uploaded_levels = 1;
+
+    // Main thread only, but read by the render thread
+    std::atomic<GLuint> m_presented_tex{0};
+    uint64_t m_presented_uploads = 0;
+    FrameInfo m_presented_info;
+};
+
+#endif /* LINUX_CPU_VIDEO_OUTPUT_H */
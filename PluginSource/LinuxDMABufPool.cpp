@@ -0,0 +1,317 @@
+#define LOG_CATEGORY LogCategory::DMABuf
+
+#include "LinuxDMABufPool.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <unistd.h>
+
+constexpr uint64_t LinuxDMABufPool::kDefaultIdleLimit;
+
+LinuxDMABufPool& LinuxDMABufPool::instance()
+{
+    // Never destroyed: buffers may still be released during static
+    // destruction, and their GL objects cannot be freed from there anyway.
+    static LinuxDMABufPool* pool = new LinuxDMABufPool;
+    return *pool;
+}
+
+static bool modifierAllowed(uint64_t modifier, const std::vector<uint64_t>& modifiers)
+{
+    if (modifiers.empty())
+        return modifier == DRM_FORMAT_MOD_LINEAR;
+    return std::find(modifiers.begin(), modifiers.end(), modifier) != modifiers.end();
+}
+
+LinuxDMABuf* LinuxDMABufPool::acquire(const void* owner, uint32_t width, uint32_t height,
+                                      uint32_t format, const std::vector<uint64_t>& modifiers)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto best = m_idle.end();
+    for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+        LinuxDMABuf* buf = *it;
+        if (buf->width != width || buf->height != height || buf->format != format ||
+            !modifierAllowed(buf->modifier, modifiers))
+            continue;
+        // Objects of another live context cannot be used nor deleted here
+        if (buf->owner != owner && buf->owner != nullptr)
+            continue;
+        // Prefer a buffer already imported on both sides
+        if (best == m_idle.end() || (buf->owner == owner && (*best)->owner != owner) ||
+            (buf->unity_tex && !(*best)->unity_tex))
+            best = it;
+    }
+    if (best == m_idle.end())
+        return nullptr;
+
+    LinuxDMABuf* buf = *best;
+    m_idle.erase(best);
+    m_idle_bytes -= buf->size;
+    buf->in_use = true;
+    DEBUG_VERBOSE("[DMABufPool] reusing %ux%u buffer fd=%d (unity_tex=%u, vlc_tex=%u)",
+                  width, height, buf->fd, buf->unity_tex, buf->owner == owner ? buf->vlc_tex : 0);
+    return buf;
+}
+
+LinuxDMABuf* LinuxDMABufPool::allocate(LinuxDRMDevice* drm, const void* owner, uint32_t width,
+                                       uint32_t height, uint32_t format, uint32_t flags,
+                                       const std::vector<uint64_t>& modifiers)
+{
+    struct gbm_bo* bo = nullptr;
+    bool with_modifiers = false;
+    if (!modifiers.empty()) {
+        bo = drm->createBoWithModifiers(width, height, format, modifiers.data(), (unsigned)modifiers.size());
+        if (bo)
+            with_modifiers = true;
+        else
+            DEBUG("[DMABufPool] gbm_bo_create_with_modifiers failed %ux%u, falling back to linear",
+                  width, height);
+    }
+    if (!bo)
+        bo = drm->createBo(width, height, format, flags | GBM_BO_USE_LINEAR);
+    if (!bo) {
+        DEBUG("[DMABufPool] gbm_bo_create failed %ux%u", width, height);
+        return nullptr;
+    }
+
+    int fd = gbm_bo_get_fd(bo);
+    if (fd < 0) {
+        DEBUG("[DMABufPool] gbm_bo_get_fd failed");
+        drm->destroyBo(bo);
+        return nullptr;
+    }
+
+    LinuxDMABuf* buf = new LinuxDMABuf;
+    buf->width = width;
+    buf->height = height;
+    buf->format = format;
+    buf->modifier = with_modifiers ? gbm_bo_get_modifier(bo) : DRM_FORMAT_MOD_LINEAR;
+    // Released with the buffer, keeps the device around for destroyBo
+    buf->drm = LinuxDRMDevice::acquire();
+    buf->bo = bo;
+    buf->fd = fd;
+    buf->stride = gbm_bo_get_stride(bo);
+    if (with_modifiers) {
+        int planes = gbm_bo_get_plane_count(bo);
+        buf->plane_count = planes > 0 && planes <= 4 ? (unsigned)planes : 1;
+        for (unsigned i = 0; i < buf->plane_count; i++) {
+            buf->offsets[i] = gbm_bo_get_offset(bo, (int)i);
+            buf->strides[i] = gbm_bo_get_stride_for_plane(bo, (int)i);
+        }
+    } else {
+        buf->plane_count = 1;
+        buf->strides[0] = buf->stride;
+    }
+    buf->owner = owner;
+    buf->in_use = true;
+
+    // Get true DMA-BUF allocation size via lseek (stride*height may be too small)
+    off_t real_size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    if (real_size <= 0) {
+        buf->size = (uint64_t)buf->stride * height;
+        DEBUG("[DMABufPool] lseek failed, using stride*height=%lu", (unsigned long)buf->size);
+    } else {
+        buf->size = (uint64_t)real_size;
+    }
+
+    DEBUG("[DMABufPool] DMA-BUF: fd=%d stride=%u size=%lu %ux%u modifier=0x%016llx planes=%u",
+          fd, buf->stride, (unsigned long)buf->size, width, height,
+          (unsigned long long)buf->modifier, buf->plane_count);
+    return buf;
+}
+
+void LinuxDMABufPool::release(LinuxDMABuf* buf)
+{
+    if (!buf)
+        return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    buf->in_use = false;
+    buf->last_used = ++m_clock;
+    m_idle.push_back(buf);
+    m_idle_bytes += buf->size;
+    evictLocked();
+}
+
+void LinuxDMABufPool::setIdleLimit(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_idle_limit = bytes;
+    evictLocked();
+}
+
+void LinuxDMABufPool::evictLocked()
+{
+    while (m_idle_bytes > m_idle_limit && !m_idle.empty()) {
+        auto oldest = std::min_element(m_idle.begin(), m_idle.end(),
+            [](const LinuxDMABuf* a, const LinuxDMABuf* b) { return a->last_used < b->last_used; });
+        LinuxDMABuf* buf = *oldest;
+        m_idle.erase(oldest);
+        m_idle_bytes -= buf->size;
+        DEBUG_VERBOSE("[DMABufPool] evicting %ux%u buffer fd=%d", buf->width, buf->height, buf->fd);
+        m_evicted.push_back(buf);
+        if (buf->unity_tex || buf->unity_mem_obj)
+            m_unity_garbage.store(true, std::memory_order_relaxed);
+    }
+    freeUnreferencedLocked();
+}
+
+void LinuxDMABufPool::freeUnreferencedLocked()
+{
+    auto alive = std::remove_if(m_evicted.begin(), m_evicted.end(), [](LinuxDMABuf* buf) {
+        if (buf->unity_tex || buf->unity_mem_obj || buf->owner)
+            return false;
+        destroy(buf);
+        return true;
+    });
+    m_evicted.erase(alive, m_evicted.end());
+}
+
+void LinuxDMABufPool::collectUnity(const GLDeleters& unity)
+{
+    if (!m_unity_garbage.load(std::memory_order_relaxed))
+        return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (LinuxDMABuf* buf : m_evicted)
+        deleteUnityObjects(*buf, unity);
+    m_unity_garbage.store(false, std::memory_order_relaxed);
+    freeUnreferencedLocked();
+}
+
+void LinuxDMABufPool::collectOwner(const void* owner, const GLDeleters& vlc)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    bool dropped = false;
+    for (LinuxDMABuf* buf : m_evicted) {
+        if (buf->owner == owner) {
+            deleteVlcObjects(*buf, vlc);
+            dropped = true;
+        }
+    }
+    if (dropped)
+        freeUnreferencedLocked();
+}
+
+void LinuxDMABufPool::dropOwner(const void* owner, const GLDeleters& vlc)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (LinuxDMABuf* buf : m_idle) {
+        if (buf->owner == owner)
+            deleteVlcObjects(*buf, vlc);
+    }
+    for (LinuxDMABuf* buf : m_evicted) {
+        if (buf->owner == owner)
+            deleteVlcObjects(*buf, vlc);
+    }
+    freeUnreferencedLocked();
+}
+
+void LinuxDMABufPool::forgetUnityObjects()
+{
+    const GLDeleters none = { nullptr, nullptr };
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (LinuxDMABuf* buf : m_idle)
+        deleteUnityObjects(*buf, none);
+    for (LinuxDMABuf* buf : m_evicted)
+        deleteUnityObjects(*buf, none);
+    m_unity_garbage.store(false, std::memory_order_relaxed);
+    freeUnreferencedLocked();
+}
+
+void LinuxDMABufPool::deleteUnityObjects(LinuxDMABuf& buf, const GLDeleters& unity)
+{
+    if (buf.unity_tex && unity.deleteTextures)
+        unity.deleteTextures(1, &buf.unity_tex);
+    if (buf.unity_mem_obj && unity.deleteMemoryObjects)
+        unity.deleteMemoryObjects(1, &buf.unity_mem_obj);
+    buf.unity_tex = 0;
+    buf.unity_mem_obj = 0;
+}
+
+void LinuxDMABufPool::deleteVlcObjects(LinuxDMABuf& buf, const GLDeleters& vlc)
+{
+    if (buf.vlc_fbo && vlc.deleteTextures)
+        glDeleteFramebuffers(1, &buf.vlc_fbo);
+    if (buf.vlc_tex && vlc.deleteTextures)
+        vlc.deleteTextures(1, &buf.vlc_tex);
+    if (buf.vlc_mem_obj && vlc.deleteMemoryObjects)
+        vlc.deleteMemoryObjects(1, &buf.vlc_mem_obj);
+    buf.vlc_fbo = 0;
+    buf.vlc_tex = 0;
+    buf.vlc_mem_obj = 0;
+    buf.owner = nullptr;
+}
+
+void LinuxDMABufPool::destroy(LinuxDMABuf* buf)
+{
+    if (buf->fd >= 0)
+        close(buf->fd);
+    if (buf->bo)
+        buf->drm->destroyBo(buf->bo);
+    if (buf->drm)
+        buf->drm->release();
+    delete buf;
+}
+
+void LinuxDMABufRetireList::retire(std::vector<LinuxDMABuf*> buffers, uint32_t generation)
+{
+    if (buffers.empty())
+        return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_retired.push_back(Retired{ generation, std::move(buffers), 0, nullptr });
+    m_pending.store(true, std::memory_order_relaxed);
+}
+
+void LinuxDMABufRetireList::collect()
+{
+    if (!m_pending.load(std::memory_order_relaxed))
+        return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    const uint32_t presented = m_presented.load(std::memory_order_acquire);
+    for (auto it = m_retired.begin(); it != m_retired.end();) {
+        if (it->generation >= presented) {
+            ++it;
+            continue;
+        }
+        if (!it->fence) {
+            // The main thread runs ahead of the render thread: commands
+            // before this event may be from a frame that still sampled the
+            // old texture. The fence goes after the next event instead.
+            if (it->events++ == 0) {
+                ++it;
+                continue;
+            }
+            it->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            if (it->fence) {
+                ++it;
+                continue;
+            }
+            // Nothing to wait on, the event delay has to do
+        } else {
+            GLenum status = glClientWaitSync(it->fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                ++it;
+                continue;
+            }
+            glDeleteSync(it->fence);
+        }
+        DEBUG_VERBOSE("[DMABufPool] releasing %zu buffers of generation %u",
+                      it->buffers.size(), it->generation);
+        for (LinuxDMABuf* buf : it->buffers)
+            LinuxDMABufPool::instance().release(buf);
+        it = m_retired.erase(it);
+    }
+    m_pending.store(!m_retired.empty(), std::memory_order_relaxed);
+}
+
+void LinuxDMABufRetireList::releaseAll()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (Retired& retired : m_retired) {
+        for (LinuxDMABuf* buf : retired.buffers)
+            LinuxDMABufPool::instance().release(buf);
+    }
+    m_retired.clear();
+    m_pending.store(false, std::memory_order_relaxed);
+}
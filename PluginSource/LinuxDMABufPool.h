@@ -0,0 +1,167 @@
+#ifndef LINUX_DMABUF_POOL_H
+#define LINUX_DMABUF_POOL_H
+
+#include "RenderAPI_OpenGLLinuxDMABuf.h"
+#include "LinuxDRMDevice.h"
+
+#include <drm_fourcc.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// A GBM buffer exported as DMA-BUF, with the GL objects importing it on both
+// sides: in Unity's context (shared by every player) and in the VLC context
+// of the player that last rendered into it.
+struct LinuxDMABuf
+{
+    // Pool key
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t format = 0;
+    uint64_t modifier = 0;
+
+    LinuxDRMDevice* drm = nullptr;
+    struct gbm_bo* bo = nullptr;
+    int fd = -1;
+    uint32_t stride = 0;
+    uint64_t size = 0;
+    // Layout of the planes for EGL imports, tiled layouts may have auxiliary
+    // (compression) planes in the same buffer object
+    unsigned plane_count = 1;
+    uint32_t offsets[4] = {};
+    uint32_t strides[4] = {};
+
+    // Unity's context, render thread only
+    GLuint unity_mem_obj = 0;
+    GLuint unity_tex = 0;
+
+    // Context of `owner`, the backend instance that created them
+    const void* owner = nullptr;
+    GLuint vlc_mem_obj = 0;
+    GLuint vlc_tex = 0;
+    GLuint vlc_fbo = 0;
+
+    // Pool bookkeeping, under the pool lock
+    bool in_use = false;
+    uint64_t last_used = 0;
+};
+
+// Process-wide cache of DMA-BUF buffers, so that resizing a player back to a
+// size it (or another player) used recently costs neither a GBM allocation
+// nor a new import into Unity's context. Adaptive streams switch between a
+// handful of sizes all the time.
+//
+// Players take buffers with acquire() or allocate() and give them back with
+// release() when they resize or stop. Idle buffers are kept up to a memory
+// cap, least recently used ones are evicted first. GL objects can only be
+// deleted in their own context, so an evicted buffer is only freed once the
+// render thread dropped its Unity-side objects (collectUnity) and its owner
+// dropped its VLC-side ones (collectOwner, or dropOwner when it goes away).
+class LinuxDMABufPool
+{
+public:
+    static constexpr uint64_t kDefaultIdleLimit = 256ull << 20;
+
+    // Functions to delete GL objects in one context. Without them objects
+    // are only forgotten, for a context that is already gone.
+    struct GLDeleters
+    {
+        PFNGLDELETEMEMORYOBJECTSEXTPROC deleteMemoryObjects;
+        PFNGLDELETETEXTURESPROC_RAW deleteTextures;
+    };
+
+    static LinuxDMABufPool& instance();
+
+    // VLC thread. An idle buffer of that size and format with one of
+    // modifiers (linear when empty), free or already imported in owner's
+    // context, or nullptr.
+    LinuxDMABuf* acquire(const void* owner, uint32_t width, uint32_t height,
+                         uint32_t format, const std::vector<uint64_t>& modifiers);
+    // VLC thread. A new buffer, or nullptr when GBM fails. GBM picks one of
+    // modifiers, the buffer is linear when the list is empty or the driver
+    // cannot allocate with any of them. Its GL objects are left to the caller.
+    LinuxDMABuf* allocate(LinuxDRMDevice* drm, const void* owner, uint32_t width,
+                          uint32_t height, uint32_t format, uint32_t flags,
+                          const std::vector<uint64_t>& modifiers);
+    // Returns a buffer taken with acquire() or allocate(), with its GL
+    // objects, to the idle list.
+    void release(LinuxDMABuf* buf);
+
+    // Render thread, Unity's context current.
+    void collectUnity(const GLDeleters& unity);
+    // VLC thread, owner's context current: drops owner's objects of evicted
+    // buffers.
+    void collectOwner(const void* owner, const GLDeleters& vlc);
+    // VLC thread, owner's context current, when it is going away: drops all
+    // of owner's objects, idle buffers stay in the pool for other players.
+    void dropOwner(const void* owner, const GLDeleters& vlc);
+
+    // Unity's context was destroyed along with every object imported in it.
+    void forgetUnityObjects();
+
+    // Bytes of idle buffers kept at most, 0 disables pooling.
+    void setIdleLimit(uint64_t bytes);
+
+    static void deleteUnityObjects(LinuxDMABuf& buf, const GLDeleters& unity);
+    static void deleteVlcObjects(LinuxDMABuf& buf, const GLDeleters& vlc);
+
+private:
+    LinuxDMABufPool() = default;
+
+    void evictLocked();
+    void freeUnreferencedLocked();
+    static void destroy(LinuxDMABuf* buf);
+
+    std::mutex m_lock;
+    std::vector<LinuxDMABuf*> m_idle;
+    std::vector<LinuxDMABuf*> m_evicted;
+    uint64_t m_idle_bytes = 0;
+    uint64_t m_idle_limit = kDefaultIdleLimit;
+    uint64_t m_clock = 0;
+    // Set while evicted buffers still hold Unity-side objects, checked by
+    // every render event without locking.
+    std::atomic<bool> m_unity_garbage{false};
+};
+
+// Buffers of a player's previous generations, kept until Unity stopped
+// sampling them. Each reallocation of a player's buffers starts a new
+// generation, but Unity keeps being handed the last texture of the previous
+// one until the new buffers are imported and have a frame. Once Unity got a
+// texture of a newer generation, the render thread fences its context and the
+// older buffers go back to the pool when that fence signals.
+class LinuxDMABufRetireList
+{
+public:
+    LinuxDMABufRetireList() = default;
+    LinuxDMABufRetireList(const LinuxDMABufRetireList&) = delete;
+    LinuxDMABufRetireList& operator=(const LinuxDMABufRetireList&) = delete;
+    ~LinuxDMABufRetireList() { releaseAll(); }
+
+    // VLC thread, when the buffers of that generation are replaced.
+    void retire(std::vector<LinuxDMABuf*> buffers, uint32_t generation);
+    // Main thread, Unity was handed a texture of that generation.
+    void presented(uint32_t generation) { m_presented.store(generation, std::memory_order_release); }
+    // Render thread, Unity's context current.
+    void collect();
+    // Gives everything back to the pool right away, when the player goes
+    // away. Pending fences are dropped, they belong to Unity's context.
+    void releaseAll();
+
+private:
+    struct Retired
+    {
+        uint32_t generation;
+        std::vector<LinuxDMABuf*> buffers;
+        unsigned events;
+        GLsync fence;
+    };
+
+    std::mutex m_lock;
+    std::vector<Retired> m_retired;
+    std::atomic<uint32_t> m_presented{0};
+    std::atomic<bool> m_pending{false};
+};
+
+#endif /* LINUX_DMABUF_POOL_H */
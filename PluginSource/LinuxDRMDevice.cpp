@@ -0,0 +1,272 @@
+#define LOG_CATEGORY LogCategory::DMABuf
+
+#include "LinuxDRMDevice.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef SUPPORT_EGL
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_GBM_KHR
+#define EGL_PLATFORM_GBM_KHR 0x31D7
+#endif
+#endif
+
+std::mutex LinuxDRMDevice::s_lock;
+LinuxDRMDevice* LinuxDRMDevice::s_device = nullptr;
+#ifdef SUPPORT_EGL
+constexpr unsigned LinuxDRMDevice::kEGLContextPoolSize;
+#endif
+
+LinuxDRMDevice* LinuxDRMDevice::acquire()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (!s_device) {
+        LinuxDRMDevice* device = new LinuxDRMDevice;
+        if (!device->open()) {
+            delete device;
+            return nullptr;
+        }
+        s_device = device;
+    }
+    s_device->m_refs++;
+    return s_device;
+}
+
+void LinuxDRMDevice::release()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (--m_refs > 0)
+        return;
+    DEBUG("[DRM] closing shared device %s", m_path);
+    s_device = nullptr;
+    delete this;
+}
+
+bool LinuxDRMDevice::open()
+{
+    DIR* dir = opendir("/dev/dri");
+    if (!dir) {
+        DEBUG("[DRM] cannot open /dev/dri");
+        return false;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strncmp(entry->d_name, "renderD", 7) == 0) {
+            snprintf(m_path, sizeof(m_path), "/dev/dri/%.255s", entry->d_name);
+            m_fd = ::open(m_path, O_RDWR | O_CLOEXEC);
+            if (m_fd >= 0) {
+                DEBUG("[DRM] opened DRM render node %s (fd=%d)", m_path, m_fd);
+                break;
+            }
+        }
+    }
+    closedir(dir);
+
+    if (m_fd < 0) {
+        DEBUG("[DRM] no DRM render node found");
+        return false;
+    }
+
+    m_gbm = gbm_create_device(m_fd);
+    if (!m_gbm) {
+        DEBUG("[DRM] gbm_create_device failed");
+        return false;
+    }
+    DEBUG("[DRM] GBM device created");
+    return true;
+}
+
+LinuxDRMDevice::~LinuxDRMDevice()
+{
+#ifdef SUPPORT_EGL
+    for (EGLContext context : m_egl_contexts)
+        eglDestroyContext(m_egl_display, context);
+    if (m_egl_display != EGL_NO_DISPLAY)
+        eglTerminate(m_egl_display);
+#endif
+    if (m_gbm)
+        gbm_device_destroy(m_gbm);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+struct gbm_bo* LinuxDRMDevice::createBo(uint32_t width, uint32_t height, uint32_t format, uint32_t flags)
+{
+    std::lock_guard<std::mutex> lock(m_gbm_lock);
+    return gbm_bo_create(m_gbm, width, height, format, flags);
+}
+
+struct gbm_bo* LinuxDRMDevice::createBoWithModifiers(uint32_t width, uint32_t height, uint32_t format,
+                                                     const uint64_t* modifiers, unsigned count)
+{
+    std::lock_guard<std::mutex> lock(m_gbm_lock);
+    return gbm_bo_create_with_modifiers(m_gbm, width, height, format, modifiers, count);
+}
+
+void LinuxDRMDevice::destroyBo(struct gbm_bo* bo)
+{
+    std::lock_guard<std::mutex> lock(m_gbm_lock);
+    gbm_bo_destroy(bo);
+}
+
+#ifdef SUPPORT_EGL
+EGLDisplay LinuxDRMDevice::eglDisplay()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (m_egl_display != EGL_NO_DISPLAY || m_egl_failed)
+        return m_egl_display;
+
+    typedef EGLDisplay (*PFNEGLGETPLATFORMDISPLAYEXTPROC_)(EGLenum, void*, const EGLint*);
+    auto eglGetPlatformDisplayEXT_ =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC_>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (eglGetPlatformDisplayEXT_)
+        display = eglGetPlatformDisplayEXT_(EGL_PLATFORM_GBM_KHR, m_gbm, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(reinterpret_cast<EGLNativeDisplayType>(m_gbm));
+    if (display == EGL_NO_DISPLAY) {
+        DEBUG("[DRM] eglGetDisplay failed: 0x%x", eglGetError());
+        m_egl_failed = true;
+        return EGL_NO_DISPLAY;
+    }
+    if (!eglInitialize(display, nullptr, nullptr)) {
+        DEBUG("[DRM] eglInitialize failed: 0x%x", eglGetError());
+        m_egl_failed = true;
+        return EGL_NO_DISPLAY;
+    }
+    m_egl_display = display;
+
+    const char* vendor = eglQueryString(display, EGL_VENDOR);
+    const char* version = eglQueryString(display, EGL_VERSION);
+    const char* apis = eglQueryString(display, EGL_CLIENT_APIS);
+    DEBUG("[DRM] EGL vendor=%s version=%s apis=%s",
+          vendor ? vendor : "?", version ? version : "?", apis ? apis : "?");
+    return m_egl_display;
+}
+
+bool LinuxDRMDevice::chooseEGLConfigLocked(EGLDisplay display)
+{
+    if (m_egl_config_chosen)
+        return true;
+    if (m_egl_config_failed)
+        return false;
+
+    // Surfaceless, players only render to FBOs backed by DMA-BUF. GBM
+    // displays typically don't support pbuffers.
+    static const EGLint rgba8[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE,    0,
+        EGL_RED_SIZE,   8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE,  8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    static const EGLint minimal[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    for (const EGLint* attribs : { rgba8, minimal }) {
+        EGLint count = 0;
+        if (eglChooseConfig(display, attribs, &m_egl_config, 1, &count) && count > 0) {
+            DEBUG("[DRM] EGL config found (%s)", attribs == rgba8 ? "surfaceless RGBA8" : "minimal GL");
+            m_egl_config_chosen = true;
+            return true;
+        }
+    }
+
+    EGLint total = 0;
+    eglGetConfigs(display, nullptr, 0, &total);
+    DEBUG("[DRM] no desktop GL EGL config among %d, cannot create contexts", total);
+    m_egl_config_failed = true;
+    return false;
+}
+
+EGLContext LinuxDRMDevice::createEGLContextLocked(EGLDisplay display)
+{
+    if (!chooseEGLConfigLocked(display))
+        return EGL_NO_CONTEXT;
+
+    // The bound API is per thread, and this may run on Unity's render thread
+    const EGLenum api = eglQueryAPI();
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        DEBUG("[DRM] eglBindAPI(EGL_OPENGL_API) failed: 0x%x", eglGetError());
+        return EGL_NO_CONTEXT;
+    }
+
+    // No sharing, players exchange frames through DMA-BUF
+    EGLContext context = EGL_NO_CONTEXT;
+    static const int gl_versions[][2] = { {4, 5}, {3, 3} };
+    for (auto& ver : gl_versions) {
+        const EGLint attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, ver[0],
+            EGL_CONTEXT_MINOR_VERSION, ver[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, m_egl_config, EGL_NO_CONTEXT, attribs);
+        if (context != EGL_NO_CONTEXT) {
+            DEBUG("[DRM] created GL %d.%d core context %p", ver[0], ver[1], context);
+            break;
+        }
+    }
+    if (context == EGL_NO_CONTEXT)
+        DEBUG("[DRM] all eglCreateContext attempts failed: 0x%x", eglGetError());
+
+    eglBindAPI(api);
+    return context;
+}
+
+EGLContext LinuxDRMDevice::acquireEGLContext()
+{
+    EGLDisplay display = eglDisplay();
+    if (display == EGL_NO_DISPLAY)
+        return EGL_NO_CONTEXT;
+
+    std::lock_guard<std::mutex> lock(m_egl_lock);
+    if (!m_egl_contexts.empty()) {
+        EGLContext context = m_egl_contexts.back();
+        m_egl_contexts.pop_back();
+        return context;
+    }
+    return createEGLContextLocked(display);
+}
+
+void LinuxDRMDevice::releaseEGLContext(EGLContext context, bool reusable)
+{
+    if (context == EGL_NO_CONTEXT)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_egl_lock);
+    if (reusable && m_egl_contexts.size() < kEGLContextPoolSize) {
+        m_egl_contexts.push_back(context);
+        return;
+    }
+    eglDestroyContext(m_egl_display, context);
+}
+
+void LinuxDRMDevice::prewarmEGLContexts(unsigned count)
+{
+    EGLDisplay display = eglDisplay();
+    if (display == EGL_NO_DISPLAY)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_egl_lock);
+    if (count > kEGLContextPoolSize)
+        count = kEGLContextPoolSize;
+    while (m_egl_contexts.size() < count) {
+        EGLContext context = createEGLContextLocked(display);
+        if (context == EGL_NO_CONTEXT)
+            break;
+        m_egl_contexts.push_back(context);
+    }
+}
+#endif
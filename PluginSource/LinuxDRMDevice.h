@@ -0,0 +1,93 @@
+#ifndef LINUX_DRM_DEVICE_H
+#define LINUX_DRM_DEVICE_H
+
+#include <gbm.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#ifdef SUPPORT_EGL
+#include <EGL/egl.h>
+#endif
+
+// DRM render node and GBM device shared by every player of the Linux
+// backends. Opening a render node and creating a GBM device loads and
+// initializes the driver, so it is done once for the whole process instead of
+// once per player.
+//
+// The device is reference counted: acquire() opens it on first use and every
+// successful call must be balanced by a release(), the last one closes it.
+// All methods are thread-safe.
+class LinuxDRMDevice
+{
+public:
+    // Returns the shared device with a new reference, or nullptr when no
+    // usable render node was found.
+    static LinuxDRMDevice* acquire();
+    void release();
+
+    int fd() const { return m_fd; }
+    struct gbm_device* gbm() const { return m_gbm; }
+    const char* path() const { return m_path; }
+
+    // Buffer allocation goes through the device, which serializes it:
+    // players allocate from their own VLC threads and not every GBM
+    // implementation supports concurrent use of a device.
+    struct gbm_bo* createBo(uint32_t width, uint32_t height, uint32_t format, uint32_t flags);
+    // With one of modifiers chosen by the driver, nullptr when it cannot.
+    struct gbm_bo* createBoWithModifiers(uint32_t width, uint32_t height, uint32_t format,
+                                         const uint64_t* modifiers, unsigned count);
+    void destroyBo(struct gbm_bo* bo);
+
+#ifdef SUPPORT_EGL
+    // EGL display of the GBM device, initialized on first call. As EGL hands
+    // out the same display for the same native device, it is owned here and
+    // only terminated with the device, never by the players using it.
+    EGLDisplay eglDisplay();
+
+    // Desktop GL core contexts on that display for the players' VLC side,
+    // created with one cached config. Players borrow a context for their
+    // lifetime and give it back, so that creating a player does not pay for
+    // choosing a config and creating a context. A context is returned
+    // reusable only when it is current nowhere and holds none of its
+    // player's objects anymore, otherwise it is destroyed.
+    static constexpr unsigned kEGLContextPoolSize = 4;
+    EGLContext acquireEGLContext();
+    void releaseEGLContext(EGLContext context, bool reusable);
+    // Creates idle contexts until count are available, ahead of the players.
+    void prewarmEGLContexts(unsigned count);
+#endif
+
+private:
+    LinuxDRMDevice() = default;
+    ~LinuxDRMDevice();
+    LinuxDRMDevice(const LinuxDRMDevice&) = delete;
+    LinuxDRMDevice& operator=(const LinuxDRMDevice&) = delete;
+
+    bool open();
+
+    static std::mutex s_lock;
+    static LinuxDRMDevice* s_device;
+    unsigned m_refs = 0;
+
+    int m_fd = -1;
+    struct gbm_device* m_gbm = nullptr;
+    char m_path[280] = {};
+
+    std::mutex m_gbm_lock;
+#ifdef SUPPORT_EGL
+    EGLDisplay m_egl_display = EGL_NO_DISPLAY;
+    bool m_egl_failed = false;
+
+    bool chooseEGLConfigLocked(EGLDisplay display);
+    EGLContext createEGLContextLocked(EGLDisplay display);
+
+    std::mutex m_egl_lock;
+    EGLConfig m_egl_config = nullptr;
+    bool m_egl_config_chosen = false;
+    bool m_egl_config_failed = false;
+    std::vector<EGLContext> m_egl_contexts; // idle
+#endif
+};
+
+#endif /* LINUX_DRM_DEVICE_H */
@@ -1,6 +1,13 @@
 #include "PlatformBase.h"
 #include "Log.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #if defined(UNITY_WIN)
 #include <windows.h>
 #elif defined(UNITY_ANDROID)
@@ -15,6 +22,284 @@ extern "C"
 #include <stdio.h>
 }
 
+std::atomic<int> g_log_levels[static_cast<int>(LogCategory::Count)] = {
+    {static_cast<int>(LogLevel::Info)},
+    {static_cast<int>(LogLevel::Info)},
+    {static_cast<int>(LogLevel::Info)},
+    {static_cast<int>(LogLevel::Info)},
+};
+
+namespace {
+
+// Single-producer/single-consumer ring of formatted messages, one per thread
+// that logs. The producer only touches m_head, the consumer m_tail, so
+// logging never takes a lock nor makes a system call. Messages are dropped,
+// and counted, when the ring is full.
+class LogRing
+{
+public:
+    enum : int { kSlots = 128, kMessageSize = 240 };
+
+    struct Slot
+    {
+        int8_t category;
+        int8_t level;
+        char text[kMessageSize];
+    };
+
+    Slot* reserve()
+    {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= kSlots) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &m_slots[head % kSlots];
+    }
+
+    // Returns true once the ring is half full, time to wake the consumer up.
+    bool commit()
+    {
+        const uint32_t head = m_head.fetch_add(1, std::memory_order_release) + 1;
+        return head - m_tail.load(std::memory_order_relaxed) >= kSlots / 2;
+    }
+
+    template <typename F>
+    void drain(F&& output)
+    {
+        uint32_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+            char text[64];
+            snprintf(text, sizeof(text), "[VLC-Unity] %u log messages dropped", dropped);
+            output(static_cast<int>(LogCategory::Core), static_cast<int>(LogLevel::Warning), text);
+        }
+
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        const uint32_t head = m_head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            const Slot& slot = m_slots[tail % kSlots];
+            output(slot.category, slot.level, slot.text);
+            m_tail.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+    }
+
+    // Set by the owning thread when it exits, the ring is freed once drained.
+    std::atomic<bool> orphaned{false};
+
+private:
+    std::atomic<uint32_t> m_head{0};
+    std::atomic<uint32_t> m_dropped{0};
+    char m_pad0[64];
+    std::atomic<uint32_t> m_tail{0};
+    char m_pad1[64];
+    Slot m_slots[kSlots];
+};
+
+// Owns the rings and the thread writing them out. Never destroyed: threads
+// may still log while the plugin's static objects are being torn down.
+class Logger
+{
+public:
+    static Logger& instance()
+    {
+        static Logger* logger = new Logger;
+        return *logger;
+    }
+
+    LogRing* registerThread()
+    {
+        LogRing* ring = new LogRing;
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_rings.push_back(ring);
+        return ring;
+    }
+
+    void ensureRunning()
+    {
+        if (m_running.load(std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> control(m_control_lock);
+        if (m_running.load(std::memory_order_relaxed))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = false;
+        }
+        m_thread = std::thread([this] { run(); });
+        m_running.store(true, std::memory_order_release);
+    }
+
+    // Errors, warnings and bursts are written out without waiting for the
+    // next periodic wakeup. Notifying without the lock may occasionally miss the
+    // thread, which then picks them up at most kPeriodMs later.
+    void wake() { m_wakeup.notify_one(); }
+
+    // Messages logged while the thread stops stay in their ring until it
+    // starts again.
+    void shutdown()
+    {
+        std::lock_guard<std::mutex> control(m_control_lock);
+        if (!m_running.load(std::memory_order_relaxed))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+        m_running.store(false, std::memory_order_release);
+    }
+
+    void setSink(log_sink_cb cb, void* opaque)
+    {
+        std::lock_guard<std::mutex> lock(m_sink_lock);
+        m_sink = cb;
+        m_sink_opaque = opaque;
+    }
+
+private:
+    enum : int { kPeriodMs = 10 };
+
+    void run()
+    {
+        std::vector<LogRing*> rings;
+        std::vector<LogRing*> freed;
+        std::unique_lock<std::mutex> lock(m_lock);
+        for (;;) {
+            const bool stop = m_stop;
+            rings = m_rings;
+            // Output without the lock, so that a sink logging from a thread
+            // that has no ring yet does not deadlock.
+            lock.unlock();
+            drain(rings, freed);
+            lock.lock();
+            // Other threads only ever append
+            for (LogRing* ring : freed)
+                m_rings.erase(std::find(m_rings.begin(), m_rings.end(), ring));
+            for (LogRing* ring : freed)
+                delete ring;
+            freed.clear();
+            if (stop)
+                break;
+            m_wakeup.wait_for(lock, std::chrono::milliseconds(kPeriodMs));
+        }
+    }
+
+    // Rings are drained one after the other: messages of a thread keep their
+    // order, messages of different threads may interleave differently than
+    // they were logged.
+    void drain(const std::vector<LogRing*>& rings, std::vector<LogRing*>& freed)
+    {
+        // Called without the lock, so that the sink may replace itself
+        log_sink_cb sink;
+        void* sink_opaque;
+        {
+            std::lock_guard<std::mutex> sink_lock(m_sink_lock);
+            sink = m_sink;
+            sink_opaque = m_sink_opaque;
+        }
+        auto output = [sink, sink_opaque](int category, int level, const char* text) {
+            if (sink)
+                sink(sink_opaque, category, level, text);
+            else
+                debugmsg("%s", text);
+        };
+
+        for (LogRing* ring : rings) {
+            // Checked first, the thread may log once more on its way out
+            const bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+            ring->drain(output);
+            if (orphaned && ring->empty())
+                freed.push_back(ring);
+        }
+    }
+
+    // Serializes starting and stopping the thread
+    std::mutex m_control_lock;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    // Protects the ring list and the stop request
+    std::mutex m_lock;
+    std::condition_variable m_wakeup;
+    std::vector<LogRing*> m_rings;
+    bool m_stop = false;
+
+    std::mutex m_sink_lock;
+    log_sink_cb m_sink = nullptr;
+    void* m_sink_opaque = nullptr;
+};
+
+// Registers the thread's ring on first use, orphans it on thread exit.
+struct ThreadRing
+{
+    LogRing* ring = nullptr;
+
+    ~ThreadRing()
+    {
+        if (ring)
+            ring->orphaned.store(true, std::memory_order_release);
+        // The logging thread may free it from now on
+        ring = nullptr;
+    }
+};
+
+thread_local ThreadRing t_ring;
+
+} // namespace
+
+void log_write(LogCategory category, LogLevel level, const char* fmt, ...)
+{
+    Logger& logger = Logger::instance();
+    if (!t_ring.ring)
+        t_ring.ring = logger.registerThread();
+    logger.ensureRunning();
+
+    LogRing::Slot* slot = t_ring.ring->reserve();
+    if (!slot)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    const int length = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    va_end(args);
+    // Marks the messages that did not fit
+    static const char kTruncated[] = "...";
+    if (length >= static_cast<int>(sizeof(slot->text)))
+        memcpy(slot->text + sizeof(slot->text) - sizeof(kTruncated), kTruncated, sizeof(kTruncated));
+    slot->category = static_cast<int8_t>(category);
+    slot->level = static_cast<int8_t>(level);
+    if (t_ring.ring->commit() || level <= LogLevel::Warning)
+        logger.wake();
+}
+
+void log_set_level(LogCategory category, LogLevel level)
+{
+    if (category == LogCategory::Count) {
+        for (auto& category_level : g_log_levels)
+            category_level.store(static_cast<int>(level), std::memory_order_relaxed);
+        return;
+    }
+    if (category < LogCategory::Core || category >= LogCategory::Count)
+        return;
+    g_log_levels[static_cast<int>(category)].store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void log_set_sink(log_sink_cb cb, void* opaque)
+{
+    Logger::instance().setSink(cb, opaque);
+}
+
+void log_shutdown()
+{
+    Logger::instance().shutdown();
+}
+
 void debugmsg( const char* fmt, ...)
 {
     va_list args;
@@ -26,7 +311,7 @@ void debugmsg( const char* fmt, ...)
     __android_log_vprint(ANDROID_LOG_INFO, "VLCUnity", fmt, args);
 #else
     vfprintf(stderr, fmt, args);
-    vfprintf(stderr, "\n", args);
+    fputc('\n', stderr);
 #endif
 
     va_end(args);
@@ -35,7 +320,10 @@ void debugmsg( const char* fmt, ...)
 #if defined(UNITY_WIN)
 void windows_print(const char* fmt, va_list args)
 {
-    int msgsize = _vsnprintf(NULL, 0, fmt, args);
+    va_list copy;
+    va_copy(copy, args);
+    int msgsize = _vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
     char* buff = (char*)malloc(msgsize + 1);
     _vsnprintf(buff, msgsize + 1, fmt, args);
     buff[msgsize] = '\0';
@@ -3,16 +3,79 @@
 #ifndef LOG_H_
 #define LOG_H_
 
-// DEBUG - always enabled, use for errors, warnings, and important state changes
-#define DEBUG(fmt, ...) debugmsg( "[VLC-Unity] " fmt, ## __VA_ARGS__ )
+#include <atomic>
 
-// DEBUG_VERBOSE - disabled in release builds (NDEBUG), use for per-frame/high-frequency logs
+// Subsystem a message comes from, each with its own runtime level. A source
+// file picks the category of its DEBUG/DEBUG_VERBOSE messages by defining
+// LOG_CATEGORY before including anything.
+enum class LogCategory : int
+{
+    Core = 0,
+    GLX,
+    EGL,
+    DMABuf,
+    Count,
+};
+
+// A message is emitted when its level is at or below the category's level.
+enum class LogLevel : int
+{
+    Off = -1,
+    Error = 0,
+    Warning,
+    Info,
+    Debug,
+    Verbose,
+};
+
+#ifndef LOG_CATEGORY
+#define LOG_CATEGORY LogCategory::Core
+#endif
+
+extern std::atomic<int> g_log_levels[static_cast<int>(LogCategory::Count)];
+
+inline bool log_enabled(LogCategory category, LogLevel level)
+{
+    return static_cast<int>(level) <=
+           g_log_levels[static_cast<int>(category)].load(std::memory_order_relaxed);
+}
+
+// Formats the message into the calling thread's ring buffer, the background
+// thread writes it out (or hands it to the sink set with log_set_sink).
+// Messages longer than the ring's slots end with "..." where they were cut.
+void log_write(LogCategory category, LogLevel level, const char* fmt, ...);
+
+// Messages below the level are disabled at the cost of a single relaxed load.
+#define LOG(category, level, fmt, ...) \
+    do { \
+        if (log_enabled(category, level)) \
+            log_write(category, level, "[VLC-Unity] " fmt, ## __VA_ARGS__); \
+    } while (0)
+
+// DEBUG - enabled by default, use for errors, warnings, and important state changes
+#define DEBUG(fmt, ...) LOG(LOG_CATEGORY, LogLevel::Info, fmt, ## __VA_ARGS__)
+
+// DEBUG_VERBOSE - compiled out in release builds (NDEBUG), and otherwise off
+// by default, use for per-frame/high-frequency logs
 #ifdef NDEBUG
 #define DEBUG_VERBOSE(fmt, ...) ((void)0)
 #else
-#define DEBUG_VERBOSE(fmt, ...) debugmsg( "[VLC-Unity] " fmt, ## __VA_ARGS__ )
+#define DEBUG_VERBOSE(fmt, ...) LOG(LOG_CATEGORY, LogLevel::Verbose, fmt, ## __VA_ARGS__)
 #endif
 
+typedef void (*log_sink_cb)(void* opaque, int category, int level, const char* message);
+
+// Sets the level of one category, or of all of them with LogCategory::Count.
+void log_set_level(LogCategory category, LogLevel level);
+// Replaces the default output (stderr, logcat or OutputDebugString) with cb,
+// called from the logging thread. nullptr restores the default. The sink being
+// replaced may still get the messages that were being written out.
+void log_set_sink(log_sink_cb cb, void* opaque);
+// Writes out everything logged so far and stops the logging thread, which
+// starts again with the next message.
+void log_shutdown();
+
+// Synchronous output to the platform's default destination.
 void debugmsg( const char* fmt, ...);
 #if defined(UNITY_WIN)
 void windows_print(const char* fmt, va_list args);
@@ -0,0 +1,122 @@
+#ifndef OUTPUT_SIZE_REPORTER_H
+#define OUTPUT_SIZE_REPORTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+
+extern "C" {
+#include <vlc/vlc.h>
+}
+
+// Forwards the size Unity asks for in getVideoFrame to VLC, through the
+// report_size_change callback given by set_window, so that VLC renders at the
+// size the texture is displayed at rather than at the source size.
+//
+// Every resize reallocates the frame buffers (and re-imports them into Unity
+// on the DMA-BUF paths), so requests go through some hysteresis: sizes within
+// kTolerancePercent of the last reported one are ignored, a new size must be
+// asked for steadily during kSettleMs before being reported, and reports are
+// at least kMinIntervalMs apart.
+class OutputSizeReporter
+{
+public:
+    enum : int {
+        kTolerancePercent = 10,
+        kSettleMs = 200,
+        kMinIntervalMs = 500,
+    };
+
+    // VLC thread, from the set_window callback (and with nullptr from the
+    // cleanup callback). A size already reported to a previous output is
+    // reported again so that the new one starts at the right size.
+    void setCallback(libvlc_video_output_resize_cb report_size_change, void* report_opaque)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_report_size_change = report_size_change;
+        m_report_opaque = report_opaque;
+        if (m_report_size_change && m_reported_width && m_reported_height)
+            m_report_size_change(m_report_opaque, m_reported_width, m_reported_height);
+    }
+
+    // VLC thread, from the resize callback: size VLC now renders at.
+    void setOutputSize(unsigned width, unsigned height)
+    {
+        m_output_width.store(width, std::memory_order_relaxed);
+        m_output_height.store(height, std::memory_order_relaxed);
+    }
+
+    // Unity main thread, with the size passed to getVideoFrame.
+    void request(unsigned width, unsigned height)
+    {
+        if (width == 0 || height == 0)
+            return;
+
+        // Compare against the size already asked for, if any: VLC may pick a
+        // slightly different one (aspect ratio, alignment) and we must not
+        // keep asking again.
+        unsigned ref_width = m_reported_width;
+        unsigned ref_height = m_reported_height;
+        if (ref_width == 0 || ref_height == 0) {
+            ref_width = m_output_width.load(std::memory_order_relaxed);
+            ref_height = m_output_height.load(std::memory_order_relaxed);
+        }
+        if (isNear(width, height, ref_width, ref_height)) {
+            m_has_candidate = false;
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!m_has_candidate || !isNear(width, height, m_candidate_width, m_candidate_height)) {
+            m_has_candidate = true;
+            m_candidate_width = width;
+            m_candidate_height = height;
+            m_candidate_since = now;
+            return;
+        }
+        if (now - m_candidate_since < std::chrono::milliseconds(kSettleMs) ||
+            now - m_last_report < std::chrono::milliseconds(kMinIntervalMs))
+            return;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_reported_width = width;
+        m_reported_height = height;
+        if (m_report_size_change)
+            m_report_size_change(m_report_opaque, width, height);
+        m_last_report = now;
+        m_has_candidate = false;
+    }
+
+private:
+    static bool isNear(unsigned width, unsigned height, unsigned ref_width, unsigned ref_height)
+    {
+        if (ref_width == 0 || ref_height == 0)
+            return false;
+        return std::abs(static_cast<long>(width) - static_cast<long>(ref_width)) * 100 <=
+                   static_cast<long>(ref_width) * kTolerancePercent &&
+               std::abs(static_cast<long>(height) - static_cast<long>(ref_height)) * 100 <=
+                   static_cast<long>(ref_height) * kTolerancePercent;
+    }
+
+    // Protects the callback, which VLC may clear while Unity reports a size,
+    // and the size to report to the next output. The reported size is only
+    // written by Unity's main thread, which can read it without locking.
+    std::mutex m_lock;
+    libvlc_video_output_resize_cb m_report_size_change = nullptr;
+    void* m_report_opaque = nullptr;
+    unsigned m_reported_width = 0;
+    unsigned m_reported_height = 0;
+
+    std::atomic<unsigned> m_output_width{0};
+    std::atomic<unsigned> m_output_height{0};
+
+    // Unity main thread only
+    std::chrono::steady_clock::time_point m_last_report;
+    bool m_has_candidate = false;
+    unsigned m_candidate_width = 0;
+    unsigned m_candidate_height = 0;
+    std::chrono::steady_clock::time_point m_candidate_since;
+};
+
+#endif /* OUTPUT_SIZE_REPORTER_H */
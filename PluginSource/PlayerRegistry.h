@@ -0,0 +1,275 @@
+#ifndef PLAYER_REGISTRY_H
+#define PLAYER_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "RenderAPI.h"
+
+// Maps media players to their RenderAPI, shared between Unity's main thread
+// (which creates and releases players) and its render thread (which walks all
+// of them on every render event).
+//
+// The table is an immutable snapshot published through an atomic pointer.
+// Writers copy it, apply their change and swap the pointer in, serialized by a
+// mutex. Readers never lock: they enter the current epoch through a ReadGuard,
+// load the snapshot and may then use it, and the RenderAPIs it points to,
+// until the guard goes away.
+//
+// Replaced snapshots and released RenderAPIs are not deleted right away but
+// retired with the epoch they were unlinked in. The epoch only moves forward
+// once every reader of the epoch before it has left, so anything retired in
+// epoch e can no longer be reached by a reader once the epoch reaches e + 2.
+// Reclamation only ever runs on the writer side, never on the render thread,
+// as RenderAPI destructors release their own GL contexts. A released RenderAPI
+// also waits for VLC's video output to have called its cleanup callback, as
+// the output thread may still render with it after the player is released.
+class PlayerRegistry
+{
+    struct Entry
+    {
+        libvlc_media_player_t* mp;
+        RenderAPI* api;
+    };
+
+    // Open-addressed index into a dense array of entries, so that lookups are
+    // O(1) and iteration does not visit empty buckets.
+    struct Snapshot
+    {
+        std::vector<Entry> entries;
+        std::vector<int32_t> buckets; // index into entries, -1 when empty
+
+        static size_t hash(const libvlc_media_player_t* mp)
+        {
+            // Heap pointers: drop the alignment bits and mix the rest
+            uint64_t h = reinterpret_cast<uintptr_t>(mp) >> 4;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        const Entry* find(const libvlc_media_player_t* mp) const
+        {
+            if (buckets.empty())
+                return nullptr;
+            const size_t mask = buckets.size() - 1;
+            for (size_t i = hash(mp) & mask;; i = (i + 1) & mask) {
+                int32_t index = buckets[i];
+                if (index < 0)
+                    return nullptr;
+                if (entries[index].mp == mp)
+                    return &entries[index];
+            }
+        }
+
+        // Rebuilds the index after entries changed, keeping the load factor
+        // at or below one half.
+        void reindex()
+        {
+            size_t capacity = 8;
+            while (capacity < entries.size() * 2)
+                capacity *= 2;
+            buckets.assign(capacity, -1);
+            const size_t mask = capacity - 1;
+            for (size_t e = 0; e < entries.size(); e++) {
+                size_t i = hash(entries[e].mp) & mask;
+                while (buckets[i] >= 0)
+                    i = (i + 1) & mask;
+                buckets[i] = static_cast<int32_t>(e);
+            }
+        }
+    };
+
+public:
+    // Keeps the current snapshot, and every RenderAPI in it, alive while in
+    // scope. Guards can be nested and used from any thread.
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const PlayerRegistry& registry)
+            : m_registry(registry)
+        {
+            for (;;) {
+                uint64_t epoch = m_registry.m_epoch.load(std::memory_order_seq_cst);
+                m_parity = epoch & 1;
+                m_registry.m_readers[m_parity].fetch_add(1, std::memory_order_seq_cst);
+                // The writer may have advanced the epoch between the two
+                // steps, without seeing us, register again.
+                if (m_registry.m_epoch.load(std::memory_order_seq_cst) == epoch)
+                    break;
+                m_registry.m_readers[m_parity].fetch_sub(1, std::memory_order_release);
+            }
+            m_snapshot = m_registry.m_current.load(std::memory_order_acquire);
+        }
+        ~ReadGuard()
+        {
+            m_registry.m_readers[m_parity].fetch_sub(1, std::memory_order_release);
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        RenderAPI* find(const libvlc_media_player_t* mp) const
+        {
+            const Entry* entry = m_snapshot->find(mp);
+            return entry ? entry->api : nullptr;
+        }
+
+        size_t size() const { return m_snapshot->entries.size(); }
+        const Entry* begin() const { return m_snapshot->entries.data(); }
+        const Entry* end() const { return m_snapshot->entries.data() + m_snapshot->entries.size(); }
+
+    private:
+        const PlayerRegistry& m_registry;
+        const Snapshot* m_snapshot;
+        uint64_t m_parity;
+    };
+
+    PlayerRegistry()
+    {
+        Snapshot* empty = new Snapshot;
+        empty->reindex();
+        m_current.store(empty, std::memory_order_relaxed);
+    }
+    ~PlayerRegistry()
+    {
+        // Static storage, the process is going away. RenderAPIs that are
+        // still pending are leaked on purpose: their GL/EGL displays may
+        // already be gone at this point.
+        delete m_current.load(std::memory_order_relaxed);
+        for (auto& retired : m_retired)
+            delete retired.snapshot;
+    }
+    PlayerRegistry(const PlayerRegistry&) = delete;
+    PlayerRegistry& operator=(const PlayerRegistry&) = delete;
+
+    // Main thread. Replaces any previous entry for mp.
+    void add(libvlc_media_player_t* mp, RenderAPI* api)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        const Snapshot* current = m_current.load(std::memory_order_relaxed);
+        Snapshot* next = new Snapshot(*current);
+        bool replaced = false;
+        for (auto& entry : next->entries) {
+            if (entry.mp == mp) {
+                entry.api = api;
+                replaced = true;
+            }
+        }
+        if (!replaced)
+            next->entries.push_back({mp, api});
+        next->reindex();
+        publish(next);
+        collectLocked();
+    }
+
+    // Main thread. Unlinks mp and returns its RenderAPI, or nullptr if there
+    // was none. The RenderAPI is still owned by the caller, which hands it to
+    // retire() once VLC is done with it.
+    RenderAPI* remove(libvlc_media_player_t* mp)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        const Snapshot* current = m_current.load(std::memory_order_relaxed);
+        const Entry* found = current->find(mp);
+        if (!found)
+            return nullptr;
+        RenderAPI* api = found->api;
+
+        Snapshot* next = new Snapshot;
+        next->entries.reserve(current->entries.size() - 1);
+        for (const auto& entry : current->entries)
+            if (entry.mp != mp)
+                next->entries.push_back(entry);
+        next->reindex();
+        publish(next);
+        collectLocked();
+        return api;
+    }
+
+    // Main thread. Deletes api once no render-thread reader can still see it
+    // and VLC's video output is done with it. Outputs that never get cleaned
+    // up leak their RenderAPI rather than have it deleted under them.
+    void retire(RenderAPI* api)
+    {
+        if (!api)
+            return;
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_retired.push_back({m_epoch.load(std::memory_order_relaxed), nullptr, api});
+        m_has_retired.store(true, std::memory_order_relaxed);
+        collectLocked();
+    }
+
+    // Main thread. Frees what retired objects became unreachable since the
+    // last call. Cheap when there is nothing to do, and never waits for
+    // readers: if one is still around it is left for a later call.
+    void collect()
+    {
+        if (!m_has_retired.load(std::memory_order_relaxed))
+            return;
+        std::unique_lock<std::mutex> lock(m_lock, std::try_to_lock);
+        if (lock.owns_lock())
+            collectLocked();
+    }
+
+private:
+    struct Retired
+    {
+        uint64_t epoch;
+        const Snapshot* snapshot;
+        RenderAPI* api;
+    };
+
+    void publish(Snapshot* next)
+    {
+        const Snapshot* previous = m_current.exchange(next, std::memory_order_seq_cst);
+        m_retired.push_back({m_epoch.load(std::memory_order_relaxed), previous, nullptr});
+        m_has_retired.store(true, std::memory_order_relaxed);
+    }
+
+    // Moves the epoch forward as far as readers allow, at most twice, which
+    // is all it takes for the latest retired objects to become unreachable.
+    void advance()
+    {
+        for (int i = 0; i < 2; i++) {
+            uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+            // Readers of the previous epoch share the parity of the next one
+            if (m_readers[(epoch + 1) & 1].load(std::memory_order_seq_cst) != 0)
+                return;
+            m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+        }
+    }
+
+    void collectLocked()
+    {
+        advance();
+        const uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+        size_t kept = 0;
+        for (size_t i = 0; i < m_retired.size(); i++) {
+            Retired& retired = m_retired[i];
+            if (epoch >= retired.epoch + 2 &&
+                (!retired.api || !retired.api->hasVlcOutput())) {
+                delete retired.snapshot;
+                delete retired.api;
+            } else {
+                m_retired[kept++] = retired;
+            }
+        }
+        m_retired.resize(kept);
+        m_has_retired.store(kept != 0, std::memory_order_relaxed);
+    }
+
+    // Read side, touched by every guard.
+    std::atomic<const Snapshot*> m_current{nullptr};
+    mutable std::atomic<uint64_t> m_readers[2] = {};
+    std::atomic<uint64_t> m_epoch{0};
+    char m_pad0[64];
+    // Write side, under m_lock.
+    std::mutex m_lock;
+    std::vector<Retired> m_retired;
+    std::atomic<bool> m_has_retired{false};
+};
+
+#endif /* PLAYER_REGISTRY_H */
@@ -0,0 +1,199 @@
+#ifndef PLAYER_STATS_H
+#define PLAYER_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Snapshot of a player's counters, as returned by
+// libvlc_unity_get_player_stats. Layout is part of the plugin ABI: new fields
+// are only ever appended, and callers set `size` to sizeof the struct they
+// know about so that older callers keep working.
+struct PlayerStatsSnapshot
+{
+    // In: size of the caller's struct. Out: number of bytes filled in.
+    uint32_t size;
+    uint32_t latency_bucket_count;
+
+    // Frames VLC finished rendering (swap calls).
+    uint64_t frames_rendered;
+    // Frames handed to Unity by getVideoFrame.
+    uint64_t frames_presented;
+    // Frames replaced by a newer one before Unity ever acquired them.
+    uint64_t frames_dropped;
+    // Changes of the video size seen by the resize callback.
+    uint64_t resizes;
+    // Buffers imported into Unity's context (Linux DMA-BUF backends).
+    uint64_t dmabuf_imports;
+
+    // Time between VLC's swap and Unity acquiring the frame, in
+    // microseconds. Bucket i counts latencies below 250us << i, the last one
+    // everything above.
+    uint64_t latency_sum_us;
+    uint64_t latency_max_us;
+    uint64_t latency_histogram[12];
+
+    // GPU time per frame of VLC's render pass (make current to swap) and of
+    // the render thread work in Unity's context (imports, uploads, copies),
+    // in microseconds, over the last gpu_time_window measures of each. The
+    // sample counts stay 0 when the driver has no timer queries.
+    uint32_t gpu_time_window;
+    uint32_t vlc_gpu_samples;
+    uint64_t vlc_gpu_avg_us;
+    uint64_t vlc_gpu_p50_us;
+    uint64_t vlc_gpu_p95_us;
+    uint64_t vlc_gpu_p99_us;
+    uint32_t unity_gpu_samples;
+    uint32_t reserved0;
+    uint64_t unity_gpu_avg_us;
+    uint64_t unity_gpu_p50_us;
+    uint64_t unity_gpu_p95_us;
+    uint64_t unity_gpu_p99_us;
+};
+
+static_assert(sizeof(PlayerStatsSnapshot::latency_histogram) == 12 * sizeof(uint64_t),
+              "latency_histogram must match PlayerStats::kLatencyBuckets");
+
+// Per-player counters, cheap enough to stay enabled in release builds: every
+// update is a single relaxed atomic operation. Counters written by the VLC
+// thread and by Unity's threads live on separate cache lines.
+class PlayerStats
+{
+public:
+    static constexpr size_t kLatencyBuckets = 12;
+    static constexpr int64_t kFirstLatencyBucketUs = 250;
+    static constexpr size_t kGpuTimeWindow = 128;
+
+    PlayerStats() = default;
+    PlayerStats(const PlayerStats&) = delete;
+    PlayerStats& operator=(const PlayerStats&) = delete;
+
+    // VLC thread
+    void vlcGpuTime(uint64_t us) { m_vlc_gpu.add(us); }
+    void frameRendered() { m_rendered.fetch_add(1, std::memory_order_relaxed); }
+    void resized() { m_resizes.fetch_add(1, std::memory_order_relaxed); }
+    void framesDropped(uint64_t count)
+    {
+        if (count)
+            m_dropped.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Unity main thread. Latency is only recorded by the backends that
+    // timestamp their frames.
+    void framePresented() { m_presented.fetch_add(1, std::memory_order_relaxed); }
+    void framePresented(int64_t latency_us)
+    {
+        if (latency_us < 0)
+            latency_us = 0;
+        framePresented();
+        m_latency_sum_us.fetch_add(static_cast<uint64_t>(latency_us), std::memory_order_relaxed);
+        m_latency[latencyBucket(latency_us)].fetch_add(1, std::memory_order_relaxed);
+        // Single writer, no need for a CAS loop
+        if (static_cast<uint64_t>(latency_us) > m_latency_max_us.load(std::memory_order_relaxed))
+            m_latency_max_us.store(static_cast<uint64_t>(latency_us), std::memory_order_relaxed);
+    }
+    void presentedFramesDropped(uint64_t count)
+    {
+        if (count)
+            m_presented_dropped.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Unity render thread
+    void dmabufImported() { m_dmabuf_imports.fetch_add(1, std::memory_order_relaxed); }
+    void unityGpuTime(uint64_t us) { m_unity_gpu.add(us); }
+
+    static size_t latencyBucket(int64_t latency_us)
+    {
+        size_t bucket = 0;
+        int64_t limit = kFirstLatencyBucketUs;
+        while (bucket < kLatencyBuckets - 1 && latency_us >= limit) {
+            bucket++;
+            limit <<= 1;
+        }
+        return bucket;
+    }
+
+    // Any thread. Counters are read one by one, so they may be very slightly
+    // out of sync with each other.
+    void snapshot(PlayerStatsSnapshot& out) const
+    {
+        std::memset(&out, 0, sizeof(out));
+        out.size = sizeof(out);
+        out.latency_bucket_count = kLatencyBuckets;
+        out.frames_rendered = m_rendered.load(std::memory_order_relaxed);
+        out.frames_presented = m_presented.load(std::memory_order_relaxed);
+        out.frames_dropped = m_dropped.load(std::memory_order_relaxed) +
+                             m_presented_dropped.load(std::memory_order_relaxed);
+        out.resizes = m_resizes.load(std::memory_order_relaxed);
+        out.dmabuf_imports = m_dmabuf_imports.load(std::memory_order_relaxed);
+        out.latency_sum_us = m_latency_sum_us.load(std::memory_order_relaxed);
+        out.latency_max_us = m_latency_max_us.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kLatencyBuckets; i++)
+            out.latency_histogram[i] = m_latency[i].load(std::memory_order_relaxed);
+        out.gpu_time_window = kGpuTimeWindow;
+        m_vlc_gpu.summarize(out.vlc_gpu_samples, out.vlc_gpu_avg_us, out.vlc_gpu_p50_us,
+                            out.vlc_gpu_p95_us, out.vlc_gpu_p99_us);
+        m_unity_gpu.summarize(out.unity_gpu_samples, out.unity_gpu_avg_us, out.unity_gpu_p50_us,
+                              out.unity_gpu_p95_us, out.unity_gpu_p99_us);
+    }
+
+private:
+    // Last kGpuTimeWindow measures of a single writer thread. Readers copy the
+    // window and sort it, so percentiles cost nothing to the writer.
+    class GpuTimeWindow
+    {
+    public:
+        void add(uint64_t us)
+        {
+            uint64_t count = m_count.load(std::memory_order_relaxed);
+            m_samples[count % kGpuTimeWindow].store(us, std::memory_order_relaxed);
+            m_count.store(count + 1, std::memory_order_release);
+        }
+
+        void summarize(uint32_t& samples, uint64_t& avg, uint64_t& p50,
+                       uint64_t& p95, uint64_t& p99) const
+        {
+            uint64_t values[kGpuTimeWindow];
+            size_t n = static_cast<size_t>(
+                std::min<uint64_t>(m_count.load(std::memory_order_acquire), kGpuTimeWindow));
+            if (n == 0)
+                return;
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; i++) {
+                values[i] = m_samples[i].load(std::memory_order_relaxed);
+                sum += values[i];
+            }
+            std::sort(values, values + n);
+            samples = static_cast<uint32_t>(n);
+            avg = sum / n;
+            p50 = values[(n - 1) * 50 / 100];
+            p95 = values[(n - 1) * 95 / 100];
+            p99 = values[(n - 1) * 99 / 100];
+        }
+
+    private:
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<uint64_t> m_samples[kGpuTimeWindow] = {};
+    };
+
+    // VLC thread
+    std::atomic<uint64_t> m_rendered{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_resizes{0};
+    GpuTimeWindow m_vlc_gpu;
+    char m_pad0[64];
+    // Unity main thread
+    std::atomic<uint64_t> m_presented{0};
+    std::atomic<uint64_t> m_presented_dropped{0};
+    std::atomic<uint64_t> m_latency_sum_us{0};
+    std::atomic<uint64_t> m_latency_max_us{0};
+    std::atomic<uint64_t> m_latency[kLatencyBuckets] = {};
+    char m_pad1[64];
+    // Unity render thread
+    std::atomic<uint64_t> m_dmabuf_imports{0};
+    GpuTimeWindow m_unity_gpu;
+};
+
+#endif /* PLAYER_STATS_H */
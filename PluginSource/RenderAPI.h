@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Unity/IUnityGraphics.h"
+#include "FrameInfo.h"
+#include "FrameReadback.h"
+#include "PlayerStats.h"
+#include <atomic>
+#include <cstdint>
 extern "C"
 {
 #include <vlc/vlc.h>
@@ -41,6 +46,89 @@ public:
     virtual void setbitDepthFormat(int bit_depth) {
         (void)bit_depth;
     }
+    // Number of frame slots and presentation mode (see FrameQueueMode), for
+    // the backends that support it. Applies from the next output resize.
+    virtual bool setFrameQueue(unsigned slots, int mode) {
+        (void)slots; (void)mode;
+        return false;
+    }
+    // Mirrors the picture in VLC's own render pass, for the backends that
+    // support it. Applies from the next output resize.
+    virtual bool setOrientation(bool flip_x, bool flip_y) {
+        (void)flip_x; (void)flip_y;
+        return false;
+    }
+    // Texture of Unity's graphics API (of the given size) each new frame is
+    // copied to by the render thread work, nullptr to stop. For the backends
+    // that support it.
+    virtual bool setTargetTexture(void* texture, unsigned width, unsigned height) {
+        (void)texture; (void)width; (void)height;
+        return false;
+    }
+    // Mip-complete textures whose chain is generated by the render thread
+    // work for each frame getVideoFrame acquires, for the backends that
+    // support it. Applies from the next output resize.
+    virtual bool setMipmaps(bool enabled) {
+        (void)enabled;
+        return false;
+    }
+    // Reads the next frame VLC renders back to system memory, scaled to
+    // width x height (0x0 for the video size) and converted to format (see
+    // ReadbackFormat), for the backends that support it. Completed reads are
+    // handed over by pollReadback, a few frames later.
+    virtual bool requestReadback(unsigned width, unsigned height, int format) {
+        (void)width; (void)height; (void)format;
+        return false;
+    }
+    // Oldest completed readback. Its data stays valid until the next call or
+    // until the backend is deleted. Any thread.
+    virtual bool pollReadback(ReadbackFrame* frame) {
+        (void)frame;
+        return false;
+    }
+    // Timing of the frame last returned by getVideoFrame, for the backends
+    // that track it. Must be called from the thread calling getVideoFrame.
+    virtual bool getFrameInfo(FrameInfo* info) const {
+        (void)info;
+        return false;
+    }
+
+    // Fed from the media player events, read when stamping frames
+    MediaClock& mediaClock() { return m_media_clock; }
+
+    const PlayerStats& stats() const { return m_stats; }
+
+    // Size VLC renders at, 0x0 while no video output is configured. Readable
+    // from any thread without going through the player.
+    void videoSize(unsigned* width, unsigned* height) const {
+        uint64_t size = m_video_size.load(std::memory_order_relaxed);
+        *width = static_cast<unsigned>(size >> 32);
+        *height = static_cast<unsigned>(size & 0xffffffff);
+    }
+
+    // Last libvlc_state_t reported by the player events
+    void setPlayerState(int state) { m_player_state.store(state, std::memory_order_relaxed); }
+    int playerState() const { return m_player_state.load(std::memory_order_relaxed); }
+
+    // Video outputs of VLC between their setup and cleanup callbacks, which
+    // may still call into this instance even once its player is released.
+    // Counted by the setup callbacks when they succeed, and uncounted as the
+    // very last thing the cleanup callbacks do.
+    void vlcOutputOpened() { m_vlc_outputs.fetch_add(1, std::memory_order_relaxed); }
+    void vlcOutputClosed() { m_vlc_outputs.fetch_sub(1, std::memory_order_release); }
+    bool hasVlcOutput() const { return m_vlc_outputs.load(std::memory_order_acquire) != 0; }
+
+protected:
+    // VLC thread, from the output callbacks
+    void setVideoSize(unsigned width, unsigned height) {
+        m_video_size.store(static_cast<uint64_t>(width) << 32 | height, std::memory_order_relaxed);
+    }
+
+    MediaClock m_media_clock;
+    PlayerStats m_stats;
+    std::atomic<uint64_t> m_video_size{0};
+    std::atomic<int> m_player_state{libvlc_NothingSpecial};
+    std::atomic<unsigned> m_vlc_outputs{0};
 };
 
 
@@ -209,7 +209,10 @@ bool SelectPlane_cb(void *opaque, size_t plane, void *output)
 bool Setup_cb(void **opaque, const libvlc_video_setup_device_cfg_t *cfg, libvlc_video_setup_device_info_t *out)
 {
     RenderAPI_D3D11 *me = reinterpret_cast<RenderAPI_D3D11*>(*opaque);
-    return me->Setup(cfg, out);
+    if (!me->Setup(cfg, out))
+        return false;
+    me->vlcOutputOpened();
+    return true;
 }
 
 void Cleanup_cb(void *opaque)
@@ -217,6 +220,7 @@ void Cleanup_cb(void *opaque)
     RenderAPI_D3D11 *me = reinterpret_cast<RenderAPI_D3D11*>(opaque);
     me->read_write[0]->Cleanup();
     me->read_write[1]->Cleanup();
+    me->vlcOutputClosed();
 }
 
 void Report_cb(void *opaque,
@@ -358,6 +362,7 @@ void RenderAPI_D3D11::Update(UINT width, UINT height)
 
     m_width = width;
     m_height = height;
+    setVideoSize(width, height);
 
 #if defined(SHOW_WATERMARK)
     read_write[0]->Update(m_width, m_height, m_d3deviceUnity, m_d3deviceVLC, m_useNTHandle, d2dFactory, dwriteFactory, textFormat);
@@ -1254,6 +1259,9 @@ void RenderAPI_D3D11::Swap()
         m_d3dctxVLC->Flush();
 
     m_textureForUnity = textureJustWrittenByVLC;
+    m_stats.frameRendered();
+    if (m_updated)
+        m_stats.framesDropped(1);
     m_updated = true;
     DEBUG_VERBOSE("[D3D11] Swap: m_textureForUnity set, m_updated=true");
 
@@ -1356,6 +1364,8 @@ void* RenderAPI_D3D11::getVideoFrame(unsigned width, unsigned height, bool* out_
     }
     local_updated_status = m_updated;
     m_updated = false;
+    if (local_updated_status)
+        m_stats.framePresented();
 
 #if defined(SHOW_WATERMARK)
     bool isStopped = libvlc_unity_trial_is_stopped();
@@ -1,6 +1,53 @@
 #include "RenderAPI_OpenGLBase.h"
+#include "RenderAPI_OpenGLReadback.h"
 #include "Log.h"
 #include <vlc/vlc.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+#ifndef GL_RGBA8
+#  define GL_RGBA8 0x8058
+#endif
+#ifndef GL_RGBA16F
+#  define GL_RGBA16F 0x881A
+#endif
+#ifndef GL_RGBA32F
+#  define GL_RGBA32F 0x8814
+#endif
+// Separate read and draw bindings of OpenGL ES 3 contexts, missing from the
+// OpenGL ES 2 headers
+#ifndef GL_READ_FRAMEBUFFER
+#  define GL_READ_FRAMEBUFFER 0x8CA8
+#  define GL_DRAW_FRAMEBUFFER 0x8CA9
+#  define GL_READ_FRAMEBUFFER_BINDING 0x8CAA
+#  define GL_DRAW_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+// Timer queries, from OpenGL 3.3 and GL_EXT_disjoint_timer_query
+#ifndef GL_TIME_ELAPSED
+#  define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_TIMESTAMP
+#  define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_COUNTER_BITS
+#  define GL_QUERY_COUNTER_BITS 0x8864
+#endif
+#ifndef GL_QUERY_RESULT
+#  define GL_QUERY_RESULT 0x8866
+#  define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#  define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+// Sync objects of OpenGL 3.2 and OpenGL ES 3
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#  define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#  define GL_TIMEOUT_IGNORED 0xFFFFFFFFFFFFFFFFull
+#endif
 
 #if defined(SHOW_WATERMARK)
 extern "C" bool libvlc_unity_trial_tick();
@@ -8,7 +55,384 @@ extern "C" bool libvlc_unity_trial_is_paused();
 extern "C" bool libvlc_unity_trial_is_stopped();
 #endif
 
-RenderAPI_OpenGLBase::RenderAPI_OpenGLBase(UnityGfxRenderer apiType)
+std::atomic<uint64_t> GLTexturePool::s_idle_limit{GLTexturePool::kDefaultIdleLimit};
+
+void GLTexturePool::setIdleLimit(uint64_t bytes)
+{
+    s_idle_limit.store(bytes, std::memory_order_relaxed);
+}
+
+bool glHasExtension(const char* name)
+{
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (!extensions) {
+        // core profiles only list them through glGetStringi
+        clearGlErrors();
+        return false;
+    }
+    const size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p; p = strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+bool glVersion(bool* es, int* major, int* minor)
+{
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (!version)
+        return false;
+    *es = strncmp(version, "OpenGL ES", 9) == 0;
+    if (*es)
+        version += 9;
+    return sscanf(version, "%*[^0-9]%d.%d", major, minor) == 2 ||
+           sscanf(version, "%d.%d", major, minor) == 2;
+}
+
+void GLTexturePool::detectTextureStorage()
+{
+    m_texture_storage = TextureStorage::Unsupported;
+
+    bool es = false;
+    int major = 0, minor = 0;
+    if (!glVersion(&es, &major, &minor))
+        return;
+
+    const char* entry_point = nullptr;
+    if (es ? major >= 3 : (major > 4 || (major == 4 && minor >= 2)))
+        entry_point = "glTexStorage2D";
+    else if (!es && glHasExtension("GL_ARB_texture_storage"))
+        entry_point = "glTexStorage2D";
+    else if (glHasExtension("GL_EXT_texture_storage"))
+        entry_point = "glTexStorage2DEXT";
+
+    if (entry_point && m_load_proc)
+        m_glTexStorage2D = reinterpret_cast<TexStorage2DProc>(m_load_proc(nullptr, entry_point));
+    if (m_glTexStorage2D)
+        m_texture_storage = TextureStorage::Supported;
+    DEBUG("[GLPool] GL %s%d.%d, immutable texture storage %s", es ? "ES " : "", major, minor,
+          m_glTexStorage2D ? "supported" : "unsupported");
+}
+
+unsigned GLTexturePool::mipLevels(unsigned width, unsigned height)
+{
+    unsigned levels = 1;
+    for (unsigned size = std::max(width, height); size > 1; size >>= 1)
+        levels++;
+    return levels;
+}
+
+uint64_t GLTexturePool::byteSize(const GLRenderTarget& target)
+{
+    uint64_t pixel_size;
+    switch (target.internal_format) {
+    case GL_RGBA32F:
+        pixel_size = 16;
+        break;
+    case GL_RGBA16F:
+        pixel_size = 8;
+        break;
+    default:
+        // GL_RGBA8 and GL_RGB10_A2
+        pixel_size = 4;
+        break;
+    }
+    // a mip chain adds a third
+    const uint64_t size = uint64_t(target.width) * target.height * pixel_size;
+    return target.levels > 1 ? size + size / 3 : size;
+}
+
+void GLTexturePool::destroy(GLRenderTarget& target)
+{
+    glDeleteFramebuffers(1, &target.fbo);
+    glDeleteTextures(1, &target.tex);
+    target = GLRenderTarget();
+}
+
+bool GLTexturePool::create(unsigned width, unsigned height, GLenum internal_format,
+                           GLenum format, GLenum type, unsigned levels, GLRenderTarget* out)
+{
+    if (m_texture_storage == TextureStorage::Unknown)
+        detectTextureStorage();
+
+    GLRenderTarget target;
+    target.width = width;
+    target.height = height;
+    target.internal_format = internal_format;
+    target.levels = levels;
+
+    glGenTextures(1, &target.tex);
+    glGenFramebuffers(1, &target.fbo);
+
+    glBindTexture(GL_TEXTURE_2D, target.tex);
+    if (m_texture_storage == TextureStorage::Supported) {
+        m_glTexStorage2D(GL_TEXTURE_2D, levels, internal_format, width, height);
+    } else {
+        // unsized formats for OpenGL ES 2, where the internal format has to
+        // match the format
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format == GL_RGBA8 ? GL_RGBA : internal_format,
+                     width, height, 0, format, type, NULL);
+        // allocates the other levels
+        if (levels > 1)
+            glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.tex, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        DEBUG("[GLPool] failed to create the FBO of a %ux%u texture, status 0x%x",
+              width, height, status);
+        destroy(target);
+        return false;
+    }
+
+    DEBUG_VERBOSE("[GLPool] created a %ux%u texture %u with %u levels, FBO %u", width, height,
+                  target.tex, levels, target.fbo);
+    *out = target;
+    return true;
+}
+
+bool GLTexturePool::acquire(unsigned width, unsigned height, GLenum internal_format,
+                            GLenum format, GLenum type, unsigned levels, GLRenderTarget* out)
+{
+    for (auto it = m_idle.rbegin(); it != m_idle.rend(); ++it) {
+        if (it->width != width || it->height != height ||
+            it->internal_format != internal_format || it->levels != levels)
+            continue;
+        *out = *it;
+        m_idle_bytes -= byteSize(*it);
+        m_idle.erase(std::next(it).base());
+        DEBUG_VERBOSE("[GLPool] reusing the %ux%u texture %u", width, height, out->tex);
+        return true;
+    }
+    return create(width, height, internal_format, format, type, levels, out);
+}
+
+void GLTexturePool::release(GLRenderTarget& target)
+{
+    if (target.tex == 0)
+        return;
+    m_idle_bytes += byteSize(target);
+    m_idle.push_back(target);
+    target = GLRenderTarget();
+    evict(s_idle_limit.load(std::memory_order_relaxed));
+}
+
+void GLTexturePool::evict(uint64_t limit)
+{
+    size_t evicted = 0;
+    while (evicted < m_idle.size() && m_idle_bytes > limit) {
+        m_idle_bytes -= byteSize(m_idle[evicted]);
+        destroy(m_idle[evicted]);
+        evicted++;
+    }
+    m_idle.erase(m_idle.begin(), m_idle.begin() + evicted);
+}
+
+void GLTexturePool::clear()
+{
+    evict(0);
+}
+
+namespace {
+
+// Objects of Unity's context of players deleted from the main thread, deleted
+// by the next render event in Unity's context
+std::mutex s_abandoned_lock;
+std::vector<GLuint> s_abandoned_queries;
+void (*s_abandoned_delete)(GLsizei n, const GLuint* ids) = nullptr;
+std::vector<GLuint> s_abandoned_framebuffers;
+
+}
+
+void GLTimerQueries::detect()
+{
+    m_support = Support::Unsupported;
+
+    bool es = false;
+    int major = 0, minor = 0;
+    if (!glVersion(&es, &major, &minor) || !m_load_proc)
+        return;
+
+    const char* suffix;
+    if (es && glHasExtension("GL_EXT_disjoint_timer_query"))
+        suffix = "EXT";
+    else if (!es && (major > 3 || (major == 3 && minor >= 3) || glHasExtension("GL_ARB_timer_query")))
+        suffix = "";
+    else {
+        DEBUG("[GLTimer] GL %s%d.%d has no timer queries", es ? "ES " : "", major, minor);
+        return;
+    }
+
+    auto load = [this, suffix](const char* name) {
+        char full_name[64];
+        snprintf(full_name, sizeof(full_name), "%s%s", name, suffix);
+        return m_load_proc(nullptr, full_name);
+    };
+    m_glGenQueries = reinterpret_cast<GenQueriesProc>(load("glGenQueries"));
+    m_glDeleteQueries = reinterpret_cast<DeleteQueriesProc>(load("glDeleteQueries"));
+    m_glBeginQuery = reinterpret_cast<BeginQueryProc>(load("glBeginQuery"));
+    m_glEndQuery = reinterpret_cast<EndQueryProc>(load("glEndQuery"));
+    m_glQueryCounter = reinterpret_cast<QueryCounterProc>(load("glQueryCounter"));
+    m_glGetQueryiv = reinterpret_cast<GetQueryivProc>(load("glGetQueryiv"));
+    m_glGetQueryObjectiv = reinterpret_cast<GetQueryObjectivProc>(load("glGetQueryObjectiv"));
+    m_glGetQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vProc>(load("glGetQueryObjectui64v"));
+    if (!m_glGenQueries || !m_glDeleteQueries || !m_glBeginQuery || !m_glEndQuery ||
+        !m_glQueryCounter || !m_glGetQueryiv || !m_glGetQueryObjectiv || !m_glGetQueryObjectui64v) {
+        DEBUG("[GLTimer] missing timer query entry points");
+        return;
+    }
+
+    // OpenGL ES implementations may expose the extension with a counter of
+    // 0 bits for either target, meaning it is not supported
+    const GLenum target = m_mode == Mode::Elapsed ? GL_TIME_ELAPSED : GL_TIMESTAMP;
+    GLint bits = 0;
+    m_glGetQueryiv(target, GL_QUERY_COUNTER_BITS, &bits);
+    if (bits == 0) {
+        clearGlErrors();
+        DEBUG("[GLTimer] no %s queries", m_mode == Mode::Elapsed ? "elapsed time" : "timestamp");
+        return;
+    }
+
+    m_glGenQueries(2 * kMeasures, &m_queries[0][0]);
+    m_check_disjoint = es;
+    m_support = Support::Supported;
+    DEBUG("[GLTimer] %s queries with %d bits", m_mode == Mode::Elapsed ? "elapsed time" : "timestamp",
+          bits);
+}
+
+void GLTimerQueries::begin()
+{
+    if (m_support == Support::Unknown)
+        detect();
+    if (m_support != Support::Supported || m_active || m_pending == kMeasures)
+        return;
+
+    const size_t measure = (m_first + m_pending) % kMeasures;
+    if (m_mode == Mode::Elapsed)
+        m_glBeginQuery(GL_TIME_ELAPSED, m_queries[measure][0]);
+    else
+        m_glQueryCounter(m_queries[measure][0], GL_TIMESTAMP);
+    m_active = true;
+}
+
+void GLTimerQueries::end()
+{
+    if (!m_active)
+        return;
+
+    const size_t measure = (m_first + m_pending) % kMeasures;
+    if (m_mode == Mode::Elapsed)
+        m_glEndQuery(GL_TIME_ELAPSED);
+    else
+        m_glQueryCounter(m_queries[measure][1], GL_TIMESTAMP);
+    m_active = false;
+    m_pending++;
+}
+
+bool GLTimerQueries::poll(uint64_t* us)
+{
+    if (m_pending == 0)
+        return false;
+
+    if (m_check_disjoint) {
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            // Frequency change, power saving... none of the pending
+            // measures can be trusted
+            m_first = (m_first + m_pending) % kMeasures;
+            m_pending = 0;
+            return false;
+        }
+    }
+
+    // Results complete in order, the last query of the measure is enough
+    const GLuint* queries = m_queries[m_first];
+    GLint available = 0;
+    m_glGetQueryObjectiv(queries[m_mode == Mode::Elapsed ? 0 : 1], GL_QUERY_RESULT_AVAILABLE,
+                         &available);
+    if (!available)
+        return false;
+
+    uint64_t ns = 0;
+    if (m_mode == Mode::Elapsed) {
+        m_glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &ns);
+    } else {
+        uint64_t start = 0, end = 0;
+        m_glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+        m_glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+        ns = end > start ? end - start : 0;
+    }
+    m_first = (m_first + 1) % kMeasures;
+    m_pending--;
+    *us = ns / 1000;
+    return true;
+}
+
+void GLTimerQueries::reset()
+{
+    m_support = Support::Unknown;
+    m_first = 0;
+    m_pending = 0;
+    m_active = false;
+}
+
+void GLTimerQueries::release()
+{
+    if (m_support == Support::Supported) {
+        if (m_active && m_mode == Mode::Elapsed)
+            m_glEndQuery(GL_TIME_ELAPSED);
+        m_glDeleteQueries(2 * kMeasures, &m_queries[0][0]);
+    }
+    reset();
+}
+
+void GLTimerQueries::forget()
+{
+    reset();
+}
+
+void GLTimerQueries::abandon()
+{
+    if (m_support == Support::Supported) {
+        std::lock_guard<std::mutex> lock(s_abandoned_lock);
+        s_abandoned_queries.insert(s_abandoned_queries.end(), &m_queries[0][0],
+                                   &m_queries[0][0] + 2 * kMeasures);
+        s_abandoned_delete = m_glDeleteQueries;
+    }
+    reset();
+}
+
+void GLTimerQueries::collectAbandoned()
+{
+    std::lock_guard<std::mutex> lock(s_abandoned_lock);
+    if (s_abandoned_queries.empty())
+        return;
+    s_abandoned_delete(static_cast<GLsizei>(s_abandoned_queries.size()), s_abandoned_queries.data());
+    s_abandoned_queries.clear();
+}
+
+void GLTimerQueries::forgetAbandoned()
+{
+    std::lock_guard<std::mutex> lock(s_abandoned_lock);
+    s_abandoned_queries.clear();
+}
+
+RenderAPI_OpenGLBase::RenderAPI_OpenGLBase(UnityGfxRenderer apiType, GLProcLoader loadProc) :
+    m_texture_pool(loadProc),
+    m_vlc_timer(loadProc, GLTimerQueries::Mode::Elapsed),
+    m_unity_timer(loadProc, GLTimerQueries::Mode::Timestamps),
+    m_readback(new OpenGLReadback(loadProc, m_texture_pool)),
+    m_load_proc(loadProc)
 {
     (void)apiType; // TODO
     DEBUG("Entering RenderAPI_OpenGLBase ctor");
@@ -24,6 +448,18 @@ RenderAPI_OpenGLBase::RenderAPI_OpenGLBase(UnityGfxRenderer apiType)
     DEBUG("Exiting RenderAPI_OpenGLBase ctor");
 }
 
+RenderAPI_OpenGLBase::~RenderAPI_OpenGLBase()
+{
+    // Deleted on the main thread, Unity's context is current on the render
+    // thread only
+    m_unity_timer.abandon();
+    std::lock_guard<std::mutex> lock(s_abandoned_lock);
+    if (m_copy_fbo)
+        s_abandoned_framebuffers.push_back(m_copy_fbo);
+    if (m_target_fbo)
+        s_abandoned_framebuffers.push_back(m_target_fbo);
+}
+
 
 bool RenderAPI_OpenGLBase::setup(void **opaque,
                                       const libvlc_video_setup_device_cfg_t *cfg,
@@ -34,6 +470,7 @@ bool RenderAPI_OpenGLBase::setup(void **opaque,
     RenderAPI_OpenGLBase* that = static_cast<RenderAPI_OpenGLBase*>(*opaque);
     that->width = 0;
     that->height = 0;
+    that->setVideoSize(0, 0);
 
     bool ret = true;
 
@@ -46,6 +483,8 @@ bool RenderAPI_OpenGLBase::setup(void **opaque,
     that->makeCurrent(false);
 #endif
 
+    if (ret)
+        that->vlcOutputOpened();
     return ret;
 }
 
@@ -54,8 +493,8 @@ void RenderAPI_OpenGLBase::releaseFrameBufferResources()
     if (width == 0 && height == 0)
         return;
 
-    glDeleteTextures(3, tex);
-    glDeleteFramebuffers(3, fbo);
+    for (auto& frame : frames)
+        m_texture_pool.release(frame.target);
 }
 
 void RenderAPI_OpenGLBase::cleanup(void* opaque)
@@ -64,42 +503,54 @@ void RenderAPI_OpenGLBase::cleanup(void* opaque)
     DEBUG("output callback cleanup");
     DEBUG("destroy_fbo");
 
+    that->m_size_reporter.setCallback(nullptr, nullptr);
     that->ensureCurrentContext();
+    that->releasePresentedFrame();
     that->releaseFrameBufferResources();
+    that->m_texture_pool.clear();
+    that->m_vlc_timer.release();
+    that->m_readback->release();
 
 #if defined(SHOW_WATERMARK)
     that->watermark.cleanup();
 #endif
     that->makeCurrent(false);
+    that->vlcOutputClosed();
 }
 
 bool RenderAPI_OpenGLBase::resize(void* opaque, const libvlc_video_render_cfg_t *cfg, libvlc_video_output_cfg_t *output)
 {
     RenderAPI_OpenGLBase* that = reinterpret_cast<RenderAPI_OpenGLBase*>(opaque);
-    if (cfg->width != that->width || cfg->height != that->height)
+    const size_t slots = that->m_frame_queue_slots.load(std::memory_order_relaxed);
+    const unsigned levels = that->m_mipmaps.load(std::memory_order_relaxed) ?
+                            GLTexturePool::mipLevels(cfg->width, cfg->height) : 1;
+    const bool reallocate = cfg->width != that->width || cfg->height != that->height ||
+                            slots != that->frames.slotCount() ||
+                            levels != that->frames[0].target.levels;
+    // Waits for the render thread work on the presented frame, which may be
+    // handed back to VLC or freed below
+    that->releasePresentedFrame();
+    if (reallocate) {
         that->releaseFrameBufferResources();
+        // Not when only the slot count or the mip levels changed
+        if (cfg->width != that->width || cfg->height != that->height)
+            that->m_stats.resized();
+    }
 
-    glGenTextures(3, that->tex);
-    glGenFramebuffers(3, that->fbo);
-
-    for (int i = 0; i < 3; i++) {
-        glBindTexture(GL_TEXTURE_2D, that->tex[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, cfg->width, cfg->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        DEBUG("bind FBO");
-        glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[i]);
-
-        DEBUG("FB Texture 2D");
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, that->tex[i], 0);
-
-        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    // Frames rendered at the previous size are stale now
+    that->frames.configure(slots, that->m_frame_queue_mode.load(std::memory_order_relaxed));
 
-        if (status != GL_FRAMEBUFFER_COMPLETE) {
+    for (size_t i = 0; reallocate && i < that->frames.slotCount(); i++) {
+        FrameBuffer& frame = that->frames[i];
+        if (!that->m_texture_pool.acquire(cfg->width, cfg->height, GL_RGBA8, GL_RGBA,
+                                          GL_UNSIGNED_BYTE, levels, &frame.target)) {
             DEBUG("failed to create the FBO");
+            // No frame buffer is left allocated, at any size
+            for (size_t j = 0; j < i; j++)
+                that->m_texture_pool.release(that->frames[j].target);
+            that->width = 0;
+            that->height = 0;
+            that->setVideoSize(0, 0);
             return false;
         }
     }
@@ -108,23 +559,36 @@ bool RenderAPI_OpenGLBase::resize(void* opaque, const libvlc_video_render_cfg_t
 
     that->width = cfg->width;
     that->height = cfg->height;
+    that->setVideoSize(cfg->width, cfg->height);
+    that->m_size_reporter.setOutputSize(cfg->width, cfg->height);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->idx_render]);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->frames.renderSlot().target.fbo);
 
     output->opengl_format = GL_RGBA;
     output->full_range = true;
     output->colorspace = libvlc_video_colorspace_BT709;
     output->primaries  = libvlc_video_primaries_BT709;
     output->transfer   = libvlc_video_transfer_func_SRGB;
-    output->orientation = libvlc_video_orient_bottom_right;
+    that->m_output_orientation = that->outputOrientation();
+    output->orientation = that->m_output_orientation;
 
     return true;
 }
 
+void RenderAPI_OpenGLBase::set_window(void* opaque, libvlc_video_output_resize_cb report_size_change,
+                                      libvlc_video_output_mouse_move_cb report_mouse_move,
+                                      libvlc_video_output_mouse_press_cb report_mouse_press,
+                                      libvlc_video_output_mouse_release_cb report_mouse_release,
+                                      void* report_opaque)
+{
+    (void)report_mouse_move; (void)report_mouse_press; (void)report_mouse_release;
+    RenderAPI_OpenGLBase* that = reinterpret_cast<RenderAPI_OpenGLBase*>(opaque);
+    that->m_size_reporter.setCallback(report_size_change, report_opaque);
+}
+
 void RenderAPI_OpenGLBase::swap(void* opaque)
 {
     RenderAPI_OpenGLBase* that = reinterpret_cast<RenderAPI_OpenGLBase*>(opaque);
-    std::lock_guard<std::mutex> lock(that->text_lock);
 
 #if defined(SHOW_WATERMARK)
     bool isPaused = libvlc_unity_trial_is_paused();
@@ -137,26 +601,380 @@ void RenderAPI_OpenGLBase::swap(void* opaque)
         libvlc_media_player_stop_async(that->m_mp);
         return;
     }
-    that->watermark.draw(that->fbo[that->idx_render], that->width, that->height);
+    that->watermark.draw(that->frames.renderSlot().target.fbo, that->width, that->height);
 #endif
 
-    that->updated = true;
-    std::swap(that->idx_swap, that->idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->idx_render]);
+    that->frameComplete();
+    that->vlcGpuFrameEnd();
+    FrameBuffer& rendered = that->frames.renderSlot();
+    that->fenceRendered(rendered);
+    that->stampFrame(rendered.info);
+    that->m_readback->frameRendered(rendered.target.tex, that->width, that->height,
+                                    that->m_output_orientation, rendered.info);
+    if (that->frames.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->frames.renderSlot().target.fbo);
+}
+
+void RenderAPI_OpenGLBase::vlcGpuFrameEnd()
+{
+    m_vlc_timer.end();
+    uint64_t us;
+    while (m_vlc_timer.poll(&us))
+        m_stats.vlcGpuTime(us);
+}
+
+void RenderAPI_OpenGLBase::unityGpuWorkEnd()
+{
+    m_unity_timer.end();
+    uint64_t us;
+    while (m_unity_timer.poll(&us))
+        m_stats.unityGpuTime(us);
+    GLTimerQueries::collectAbandoned();
+
+    std::lock_guard<std::mutex> lock(s_abandoned_lock);
+    if (!s_abandoned_framebuffers.empty()) {
+        glDeleteFramebuffers(static_cast<GLsizei>(s_abandoned_framebuffers.size()),
+                             s_abandoned_framebuffers.data());
+        s_abandoned_framebuffers.clear();
+    }
+}
+
+void RenderAPI_OpenGLBase::forgetUnityObjects()
+{
+    m_unity_timer.forget();
+    m_copy_fbo = 0;
+    m_target_fbo = 0;
+    // Detected again in the next context
+    m_blit_detected = false;
+    m_glBlitFramebuffer = nullptr;
+    GLTimerQueries::forgetAbandoned();
+    std::lock_guard<std::mutex> lock(s_abandoned_lock);
+    s_abandoned_framebuffers.clear();
+}
+
+void RenderAPI_OpenGLBase::stampFrame(FrameInfo& info)
+{
+    info.frame_number = ++m_frame_number;
+    info.swap_time_us = libvlc_clock();
+    info.media_time_ms = m_media_clock.timeAt(info.swap_time_us);
+    m_stats.frameRendered();
+}
+
+void RenderAPI_OpenGLBase::countPresented(const FrameInfo& info, uint32_t skipped)
+{
+    m_stats.presentedFramesDropped(skipped);
+    m_stats.framePresented(libvlc_clock() - info.swap_time_us);
 }
 
 
 void* RenderAPI_OpenGLBase::getVideoFrame(unsigned width, unsigned height, bool* out_updated)
 {
-    (void)width; (void)height;
-    std::lock_guard<std::mutex> lock(text_lock);
+    m_size_reporter.request(width, height);
+    uint32_t skipped = 0;
+    // The render thread work still reads the frame presented last, it stays
+    // displayed rather than go back to VLC until then
+    bool updated = !m_present_pending.load(std::memory_order_acquire) && frames.acquire(&skipped);
+    if (updated)
+        countPresented(frames.displaySlot().info, skipped);
     if (out_updated)
         *out_updated = updated;
-    if (updated)
-    {
-        std::swap(idx_swap, idx_display);
-        updated = false;
+    FrameBuffer& shown = frames.displaySlot();
+    const GLRenderTarget& displayed = shown.target;
+    presentFrame(displayed.tex, displayed.width, displayed.height, displayed.levels, updated,
+                 updated ? &shown.fence : nullptr);
+    // DEBUG("get Video Frame %u", displayed.tex);
+    return (void*)(size_t)displayed.tex;
+}
+
+bool RenderAPI_OpenGLBase::getFrameInfo(FrameInfo* info) const
+{
+    const FrameInfo& displayed = frames.displaySlot().info;
+    if (displayed.frame_number == 0)
+        return false;
+    *info = displayed;
+    return true;
+}
+
+bool RenderAPI_OpenGLBase::setFrameQueue(unsigned slots, int mode)
+{
+    if (mode != static_cast<int>(FrameQueueMode::Mailbox) &&
+        mode != static_cast<int>(FrameQueueMode::Fifo)) {
+        DEBUG("invalid frame queue mode %d", mode);
+        return false;
+    }
+    if (slots < FrameQueueIndex::kMinSlots || slots > FrameQueueIndex::kMaxSlots) {
+        DEBUG("invalid frame queue size %u, must be within [%zu, %zu]", slots,
+              FrameQueueIndex::kMinSlots, FrameQueueIndex::kMaxSlots);
+        return false;
+    }
+
+    FrameQueueMode queue_mode = static_cast<FrameQueueMode>(mode);
+    if (slots < FrameQueueIndex::minSlots(queue_mode)) {
+        DEBUG("mailbox frame queue needs a spare slot, using %zu slots instead of %u",
+              FrameQueueIndex::minSlots(queue_mode), slots);
+        slots = FrameQueueIndex::minSlots(queue_mode);
+    }
+
+    DEBUG("frame queue set to %u slots, %s mode", slots,
+          queue_mode == FrameQueueMode::Fifo ? "FIFO" : "mailbox");
+    m_frame_queue_slots.store(slots, std::memory_order_relaxed);
+    m_frame_queue_mode.store(queue_mode, std::memory_order_relaxed);
+    return true;
+}
+
+bool RenderAPI_OpenGLBase::setOrientation(bool flip_x, bool flip_y)
+{
+    DEBUG("orientation set to flip_x=%d flip_y=%d", flip_x, flip_y);
+    m_flip_x.store(flip_x, std::memory_order_relaxed);
+    m_flip_y.store(flip_y, std::memory_order_relaxed);
+    return true;
+}
+
+libvlc_video_orient_t RenderAPI_OpenGLBase::outputOrientation() const
+{
+    // Unflipped, the picture is rotated by 180 degrees: upside down for the
+    // bottom-up GL textures, and mirrored for Unity's texture coordinates
+    const bool mirror = !m_flip_x.load(std::memory_order_relaxed);
+    const bool upside_down = !m_flip_y.load(std::memory_order_relaxed);
+    if (mirror)
+        return upside_down ? libvlc_video_orient_bottom_right : libvlc_video_orient_top_right;
+    return upside_down ? libvlc_video_orient_bottom_left : libvlc_video_orient_top_left;
+}
+
+bool RenderAPI_OpenGLBase::setTargetTexture(void* texture, unsigned width, unsigned height)
+{
+    if (texture && (width == 0 || height == 0)) {
+        DEBUG("invalid %ux%u target texture", width, height);
+        return false;
     }
-    // DEBUG("get Video Frame %u", tex[idx_display]);
-    return (void*)(size_t)tex[idx_display];
+
+    DEBUG("target texture set to %u (%ux%u)", (unsigned)(size_t)texture, width, height);
+    std::lock_guard<std::mutex> lock(m_present_lock);
+    m_target_tex = (GLuint)(size_t)texture;
+    m_target_width = texture ? width : 0;
+    m_target_height = texture ? height : 0;
+    // The new target gets the frame already presented, nothing reads it
+    // anymore without a target nor mips
+    if (texture && m_presented_source)
+        m_present_pending.store(true, std::memory_order_relaxed);
+    else if (!texture && m_presented_levels <= 1)
+        m_present_pending.store(false, std::memory_order_relaxed);
+    m_presented_serial++;
+    m_has_target.store(texture != nullptr, std::memory_order_relaxed);
+    return true;
+}
+
+bool RenderAPI_OpenGLBase::setMipmaps(bool enabled)
+{
+    DEBUG("mipmaps %s", enabled ? "enabled" : "disabled");
+    m_mipmaps.store(enabled, std::memory_order_relaxed);
+    return true;
+}
+
+bool RenderAPI_OpenGLBase::requestReadback(unsigned width, unsigned height, int format)
+{
+    if ((width == 0) != (height == 0)) {
+        DEBUG("invalid %ux%u readback size", width, height);
+        return false;
+    }
+    if (format != static_cast<int>(ReadbackFormat::RGBA8) &&
+        format != static_cast<int>(ReadbackFormat::RGB8) &&
+        format != static_cast<int>(ReadbackFormat::GRAY8)) {
+        DEBUG("invalid readback format %d", format);
+        return false;
+    }
+    return m_readback->request(width, height, static_cast<ReadbackFormat>(format));
+}
+
+bool RenderAPI_OpenGLBase::pollReadback(ReadbackFrame* frame)
+{
+    return m_readback->poll(frame);
+}
+
+void RenderAPI_OpenGLBase::presentFrame(GLuint texture, unsigned width, unsigned height,
+                                        unsigned levels, bool updated, void** fence)
+{
+    if (!m_has_target.load(std::memory_order_relaxed) && levels <= 1)
+        return;
+    std::lock_guard<std::mutex> lock(m_present_lock);
+    if (!updated && texture == m_presented_source)
+        return;
+    // Left to VLC when the previous one is still pending
+    if (fence && !m_presented_fence) {
+        m_presented_fence = *fence;
+        *fence = nullptr;
+    }
+    m_present_pending.store(true, std::memory_order_relaxed);
+    m_presented_source = texture;
+    m_presented_width = width;
+    m_presented_height = height;
+    m_presented_levels = levels;
+    m_presented_serial++;
+}
+
+void RenderAPI_OpenGLBase::performRenderThreadWork()
+{
+    UnityGpuWork gpu_work(*this, true);
+    processPresentedFrame();
+}
+
+void RenderAPI_OpenGLBase::processPresentedFrame()
+{
+    // Fast path: nothing presented since the last call, don't contend with
+    // the main thread
+    if (m_presented_serial.load(std::memory_order_relaxed) == m_processed_serial)
+        return;
+
+    // Held until the commands are submitted, so that resizes do not free the
+    // presented frame meanwhile
+    std::lock_guard<std::mutex> lock(m_present_lock);
+    m_processed_serial = m_presented_serial.load(std::memory_order_relaxed);
+    if (!m_presented_source) {
+        m_present_pending.store(false, std::memory_order_release);
+        return;
+    }
+    const GLuint target = m_target_tex;
+    const GLuint source = m_presented_source;
+    const unsigned levels = m_presented_levels;
+    unityGpuWorkBegin();
+
+    if (m_presented_fence) {
+        // VLC's context rendered the frame, Unity's waits for it on the GPU
+        m_glWaitSync(m_presented_fence, 0, GL_TIMEOUT_IGNORED);
+        m_glDeleteSync(m_presented_fence);
+        m_presented_fence = nullptr;
+    }
+
+    if (levels > 1) {
+        // Once per acquired frame, VLC only rendered the base level
+        GLint previous_tex = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_tex);
+        glBindTexture(GL_TEXTURE_2D, source);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, previous_tex);
+        DEBUG_VERBOSE("generated %u mip levels of texture %u", levels, source);
+    }
+    if (target) {
+        copyToTarget(source, m_presented_width, m_presented_height, target, m_target_width,
+                     m_target_height);
+    } else if (m_copy_fbo || m_target_fbo) {
+        GLuint fbos[] = { m_copy_fbo, m_target_fbo };
+        glDeleteFramebuffers(2, fbos);
+        m_copy_fbo = 0;
+        m_target_fbo = 0;
+    }
+
+    // Submitted before the frame can go back to VLC
+    glFlush();
+    m_present_pending.store(false, std::memory_order_release);
+}
+
+void RenderAPI_OpenGLBase::releasePresentedFrame()
+{
+    std::lock_guard<std::mutex> lock(m_present_lock);
+    if (m_presented_fence)
+        m_glDeleteSync(m_presented_fence);
+    m_presented_fence = nullptr;
+    for (size_t i = 0; i < frames.slotCount(); i++) {
+        if (frames[i].fence)
+            m_glDeleteSync(frames[i].fence);
+        frames[i].fence = nullptr;
+    }
+    m_presented_source = 0;
+    m_presented_levels = 1;
+    m_present_pending.store(false, std::memory_order_relaxed);
+}
+
+void RenderAPI_OpenGLBase::fenceRendered(FrameBuffer& frame)
+{
+    // Rendered before but never presented
+    if (frame.fence) {
+        m_glDeleteSync(frame.fence);
+        frame.fence = nullptr;
+    }
+    if (frame.target.levels <= 1 && !m_has_target.load(std::memory_order_relaxed))
+        return;
+
+    if (!m_sync_detected) {
+        m_sync_detected = true;
+        bool es = false;
+        int major = 0, minor = 0;
+        if (m_load_proc && glVersion(&es, &major, &minor) &&
+            (es ? major >= 3 : (major > 3 || (major == 3 && minor >= 2) ||
+                                glHasExtension("GL_ARB_sync")))) {
+            m_glFenceSync = reinterpret_cast<FenceSyncProc>(m_load_proc(nullptr, "glFenceSync"));
+            m_glWaitSync = reinterpret_cast<WaitSyncProc>(m_load_proc(nullptr, "glWaitSync"));
+            m_glDeleteSync = reinterpret_cast<DeleteSyncProc>(m_load_proc(nullptr, "glDeleteSync"));
+        }
+        if (!m_glFenceSync || !m_glWaitSync || !m_glDeleteSync) {
+            DEBUG("no sync objects, the render thread work does not wait for VLC's frames");
+            m_glFenceSync = nullptr;
+        }
+    }
+    if (!m_glFenceSync)
+        return;
+    frame.fence = m_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Waited on from Unity's context, where it only shows once flushed
+    glFlush();
+}
+
+void RenderAPI_OpenGLBase::copyToTarget(GLuint source, unsigned width, unsigned height,
+                                        GLuint target, unsigned target_width,
+                                        unsigned target_height)
+{
+    if (!m_blit_detected) {
+        m_blit_detected = true;
+        bool es = false;
+        int major = 0, minor = 0;
+        if (m_load_proc && glVersion(&es, &major, &minor) &&
+            (major >= 3 || (!es && glHasExtension("GL_ARB_framebuffer_object"))))
+            m_glBlitFramebuffer = reinterpret_cast<BlitFramebufferProc>(
+                m_load_proc(nullptr, "glBlitFramebuffer"));
+        if (!m_glBlitFramebuffer)
+            DEBUG("no glBlitFramebuffer, frames are only copied to targets of their size");
+    }
+    if (!m_glBlitFramebuffer && (width != target_width || height != target_height)) {
+        DEBUG_VERBOSE("cannot scale the %ux%u frame to the %ux%u target texture", width, height,
+                      target_width, target_height);
+        return;
+    }
+
+    GLint previous_fbo = 0, previous_read_fbo = 0, previous_tex = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_fbo);
+    if (m_glBlitFramebuffer)
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_fbo);
+
+    if (!m_copy_fbo)
+        glGenFramebuffers(1, &m_copy_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_copy_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+    // VLC already oriented the picture, only its size may differ
+    if (m_glBlitFramebuffer) {
+        if (!m_target_fbo)
+            glGenFramebuffers(1, &m_target_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_target_fbo);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+        const GLboolean previous_scissor = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        m_glBlitFramebuffer(0, 0, width, height, 0, 0, target_width, target_height,
+                            GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        if (previous_scissor)
+            glEnable(GL_SCISSOR_TEST);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_copy_fbo);
+    } else {
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_tex);
+        glBindTexture(GL_TEXTURE_2D, target);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+        glBindTexture(GL_TEXTURE_2D, previous_tex);
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+    // OpenGL ES 2 has a single framebuffer binding
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo);
+    if (m_glBlitFramebuffer)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_fbo);
+    DEBUG_VERBOSE("copied %ux%u from texture %u to %ux%u target texture %u", width, height,
+                  source, target_width, target_height, target);
 }
@@ -34,11 +34,186 @@ inline void clearGlErrors()
 #  include "RenderAPI_OpenGLWatermark.h"
 #endif
 
+#include "FrameQueue.h"
+#include "OutputSizeReporter.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(UNITY_LINUX)
+class LinuxCPUVideoOutput;
+#endif
+class OpenGLReadback;
+
+// Version and extensions of the current context
+bool glVersion(bool* es, int* major, int* minor);
+bool glHasExtension(const char* name);
+
+// libvlc_video_getProcAddress_cb signature, every backend already has one
+typedef void* (*GLProcLoader)(void* data, const char* name);
+
+// A texture VLC renders into, with the framebuffer object it is attached to
+struct GLRenderTarget
+{
+    GLuint tex = 0;
+    GLuint fbo = 0;
+
+    // Pool key
+    unsigned width = 0;
+    unsigned height = 0;
+    GLenum internal_format = 0;
+    unsigned levels = 1;
+};
+
+// Render targets of one GL context, so that resizing back to a size seen
+// recently (adaptive streams switch between a handful of them) allocates
+// nothing and needs no framebuffer validation.
+//
+// Textures get immutable storage (glTexStorage2D) when the context has it,
+// sparing the driver a revalidation of their storage. Their framebuffer is
+// attached and checked once, when created. Idle targets are kept up to a
+// memory cap, least recently released ones are deleted first.
+//
+// Only used from the thread where its context is current.
+class GLTexturePool
+{
+public:
+    static constexpr uint64_t kDefaultIdleLimit = 128ull << 20;
+
+    explicit GLTexturePool(GLProcLoader loadProc) : m_load_proc(loadProc) {}
+    GLTexturePool(const GLTexturePool&) = delete;
+    GLTexturePool& operator=(const GLTexturePool&) = delete;
+
+    // An idle target of that size, format and number of mip levels, or a
+    // new one. format and type describe the texture for contexts without
+    // immutable storage. Returns false when its framebuffer is incomplete.
+    bool acquire(unsigned width, unsigned height, GLenum internal_format,
+                 GLenum format, GLenum type, unsigned levels, GLRenderTarget* out);
+    // Gives a target back and resets it, empty targets are ignored
+    void release(GLRenderTarget& target);
+    // Deletes the idle targets, before the context goes away
+    void clear();
+
+    // Bytes of idle targets each pool keeps at most, 0 disables pooling
+    static void setIdleLimit(uint64_t bytes);
+
+    // Levels of a full mip chain
+    static unsigned mipLevels(unsigned width, unsigned height);
+
+private:
+    typedef void (*TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internal_format,
+                                     GLsizei width, GLsizei height);
+
+    void detectTextureStorage();
+    bool create(unsigned width, unsigned height, GLenum internal_format,
+                GLenum format, GLenum type, unsigned levels, GLRenderTarget* out);
+    void evict(uint64_t limit);
+    static void destroy(GLRenderTarget& target);
+    static uint64_t byteSize(const GLRenderTarget& target);
+
+    GLProcLoader m_load_proc;
+    enum class TextureStorage { Unknown, Supported, Unsupported };
+    TextureStorage m_texture_storage = TextureStorage::Unknown;
+    TexStorage2DProc m_glTexStorage2D = nullptr;
+
+    // Least recently released first
+    std::vector<GLRenderTarget> m_idle;
+    uint64_t m_idle_bytes = 0;
+
+    static std::atomic<uint64_t> s_idle_limit;
+};
+
+// GPU time of stretches of commands in one GL context, read back a few
+// frames later without ever stalling the pipeline: a measure is skipped
+// rather than waited for when too many are still pending.
+//
+// Elapsed mode uses GL_TIME_ELAPSED queries. Timestamps mode uses pairs of
+// GL_TIMESTAMP ones, which do not conflict with a time query already active
+// in the context (Unity's own profiler). Nothing is timed when the context
+// has no timer queries: OpenGL before 3.3 without GL_ARB_timer_query, OpenGL
+// ES without GL_EXT_disjoint_timer_query.
+//
+// Only used from the thread where its context is current.
+class GLTimerQueries
+{
+public:
+    enum class Mode { Elapsed, Timestamps };
+
+    GLTimerQueries(GLProcLoader loadProc, Mode mode) : m_load_proc(loadProc), m_mode(mode) {}
+    GLTimerQueries(const GLTimerQueries&) = delete;
+    GLTimerQueries& operator=(const GLTimerQueries&) = delete;
+
+    // Starts timing the commands that follow, unless already timing
+    void begin();
+    // Stops timing, the measure can be polled once the GPU went past it
+    void end();
+    // Oldest completed measure, in microseconds
+    bool poll(uint64_t* us);
+
+    // Deletes the queries, before the context goes away
+    void release();
+    // The context went away along with the queries
+    void forget();
+    // Hands the queries over to collectAbandoned, from a thread where the
+    // context is not current
+    void abandon();
+
+    // Deletes the abandoned queries (context current) or forgets about them
+    // when the context went away
+    static void collectAbandoned();
+    static void forgetAbandoned();
+
+private:
+    typedef void (*GenQueriesProc)(GLsizei n, GLuint* ids);
+    typedef void (*DeleteQueriesProc)(GLsizei n, const GLuint* ids);
+    typedef void (*BeginQueryProc)(GLenum target, GLuint id);
+    typedef void (*EndQueryProc)(GLenum target);
+    typedef void (*QueryCounterProc)(GLuint id, GLenum target);
+    typedef void (*GetQueryivProc)(GLenum target, GLenum pname, GLint* params);
+    typedef void (*GetQueryObjectivProc)(GLuint id, GLenum pname, GLint* params);
+    typedef void (*GetQueryObjectui64vProc)(GLuint id, GLenum pname, uint64_t* params);
+
+    // Measures in flight, a few frames worth
+    enum : size_t { kMeasures = 8 };
+
+    void detect();
+    void reset();
+
+    GLProcLoader m_load_proc;
+    Mode m_mode;
+    enum class Support { Unknown, Supported, Unsupported };
+    Support m_support = Support::Unknown;
+    // OpenGL ES: results are meaningless after a disjoint operation
+    bool m_check_disjoint = false;
+
+    GenQueriesProc m_glGenQueries = nullptr;
+    DeleteQueriesProc m_glDeleteQueries = nullptr;
+    BeginQueryProc m_glBeginQuery = nullptr;
+    EndQueryProc m_glEndQuery = nullptr;
+    QueryCounterProc m_glQueryCounter = nullptr;
+    GetQueryivProc m_glGetQueryiv = nullptr;
+    GetQueryObjectivProc m_glGetQueryObjectiv = nullptr;
+    GetQueryObjectui64vProc m_glGetQueryObjectui64v = nullptr;
+
+    // Start and end query of each measure, the end one is unused in elapsed
+    // mode. Pending measures follow m_first, the active one comes after them.
+    GLuint m_queries[kMeasures][2] = {};
+    size_t m_first = 0;
+    size_t m_pending = 0;
+    bool m_active = false;
+};
+
 class RenderAPI_OpenGLBase : public RenderAPI
 {
+#if defined(UNITY_LINUX)
+    // Stands in for the GL output of the Linux backends, with the same
+    // frame accounting
+    friend class LinuxCPUVideoOutput;
+#endif
 public:
-	RenderAPI_OpenGLBase(UnityGfxRenderer apiType);
-	virtual ~RenderAPI_OpenGLBase() { }
+	RenderAPI_OpenGLBase(UnityGfxRenderer apiType, GLProcLoader loadProc);
+	virtual ~RenderAPI_OpenGLBase();
 
     virtual void setVlcContext(libvlc_media_player_t *mp) override = 0 ;
     virtual void retrieveOpenGLContext() override = 0 ;
@@ -47,26 +222,46 @@ public:
     static void cleanup(void* opaque);
     static bool resize(void* opaque, const libvlc_video_render_cfg_t *cfg, libvlc_video_output_cfg_t *output);
     static void swap(void* opaque);
+    static void set_window(void* opaque, libvlc_video_output_resize_cb report_size_change,
+                           libvlc_video_output_mouse_move_cb report_mouse_move,
+                           libvlc_video_output_mouse_press_cb report_mouse_press,
+                           libvlc_video_output_mouse_release_cb report_mouse_release,
+                           void* report_opaque);
 
 	virtual void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) override = 0;
 
     virtual bool makeCurrent(bool) = 0;
     virtual void ensureCurrentContext() = 0;
 
+    // GPU time of VLC's frames, from the first make current after a swap to
+    // the next swap (VLC thread, VLC's context current)
+    void vlcGpuFrameBegin() { m_vlc_timer.begin(); }
+    void vlcGpuFrameEnd();
+
     void* getVideoFrame(unsigned width, unsigned height, bool* out_updated) override;
+    bool setFrameQueue(unsigned slots, int mode) override;
+    bool getFrameInfo(FrameInfo* info) const override;
+    bool setOrientation(bool flip_x, bool flip_y) override;
+    bool setTargetTexture(void* texture, unsigned width, unsigned height) override;
+    bool setMipmaps(bool enabled) override;
+    bool requestReadback(unsigned width, unsigned height, int format) override;
+    bool pollReadback(ReadbackFrame* frame) override;
+    void performRenderThreadWork() override;
 
 private:
     void releaseFrameBufferResources();
 
-    std::mutex text_lock;
+    struct FrameBuffer {
+        GLRenderTarget target;
+        FrameInfo info;
+        // GLsync after VLC's rendering, for the render thread work
+        void* fence = nullptr;
+    };
+
     unsigned width = 0;
     unsigned height = 0;
-    GLuint tex[3];
-    GLuint fbo[3];
-    size_t idx_render = 0;
-    size_t idx_swap = 1;
-    size_t idx_display = 2;
-    bool updated = false;
+    FrameQueue<FrameBuffer> frames;
+    GLTexturePool m_texture_pool;
 
 protected:
 #if defined(SHOW_WATERMARK)
@@ -74,6 +269,127 @@ protected:
 #endif
 
     libvlc_media_player_t *m_mp = nullptr;
+
+    // Fill in the timing of the frame about to be published (VLC thread)
+    void stampFrame(FrameInfo& info);
+    // Called by swap once the frame VLC rendered is complete, watermark
+    // included, before it is published (VLC thread, VLC's context current)
+    virtual void frameComplete() {}
+    // Account for a frame acquired by getVideoFrame (Unity main thread)
+    void countPresented(const FrameInfo& info, uint32_t skipped);
+
+    // Orientation VLC renders with, from the flips set by setOrientation
+    libvlc_video_orient_t outputOrientation() const;
+    // Texture of Unity's context returned by getVideoFrame, updated when it
+    // holds a new frame, levels being its allocated mip levels. The render
+    // thread work takes over the fence of VLC's rendering (Unity main thread)
+    void presentFrame(GLuint texture, unsigned width, unsigned height, unsigned levels,
+                      bool updated, void** fence = nullptr);
+    // Generates the mip chain of the last frame presented and copies it to
+    // the target texture, when enabled and not done yet (render thread,
+    // Unity's context current)
+    void processPresentedFrame();
+    // Scales the frame in source to the target texture
+    void copyToTarget(GLuint source, unsigned width, unsigned height, GLuint target,
+                      unsigned target_width, unsigned target_height);
+    // Forgets the presented frame and deletes the fences, before the frame
+    // buffers are released (VLC thread, VLC's context current)
+    void releasePresentedFrame();
+    // Fences the frame just rendered when the render thread work reads it
+    // (VLC thread, VLC's context current)
+    void fenceRendered(FrameBuffer& frame);
+
+    // GPU time of the work of a render event in Unity's context, from the
+    // first command worth timing to the end of the event (render thread,
+    // Unity's context current)
+    void unityGpuWorkBegin() { m_unity_timer.begin(); }
+    void unityGpuWorkEnd();
+    // Unity's context went away along with the objects this player had in it
+    // (render thread)
+    void forgetUnityObjects();
+
+    // Ends the render event's measure when leaving performRenderThreadWork
+    class UnityGpuWork
+    {
+    public:
+        UnityGpuWork(RenderAPI_OpenGLBase& api, bool context_current) :
+            m_api(api), m_context_current(context_current) {}
+        ~UnityGpuWork()
+        {
+            if (m_context_current)
+                m_api.unityGpuWorkEnd();
+        }
+        UnityGpuWork(const UnityGpuWork&) = delete;
+        UnityGpuWork& operator=(const UnityGpuWork&) = delete;
+
+    private:
+        RenderAPI_OpenGLBase& m_api;
+        bool m_context_current;
+    };
+
+    GLTimerQueries m_vlc_timer;
+    GLTimerQueries m_unity_timer;
+    // Fed by the swap callbacks with each frame published
+    std::unique_ptr<OpenGLReadback> m_readback;
+
+    // Set by the resize callbacks from outputOrientation (VLC thread)
+    libvlc_video_orient_t m_output_orientation = libvlc_video_orient_top_left;
+    std::atomic<bool> m_flip_x{false};
+    std::atomic<bool> m_flip_y{false};
+    // Set by setMipmaps, read when the frame textures are allocated
+    std::atomic<bool> m_mipmaps{false};
+
+    // Size Unity asks for in getVideoFrame, forwarded to VLC
+    OutputSizeReporter m_size_reporter;
+    uint64_t m_frame_number = 0;
+
+    // Frame queue layout requested through setFrameQueue, applied by the
+    // resize callback when the frame buffers are (re)allocated.
+    std::atomic<size_t> m_frame_queue_slots{FrameQueueIndex::kDefaultSlots};
+    std::atomic<FrameQueueMode> m_frame_queue_mode{FrameQueueMode::Mailbox};
+
+private:
+    typedef void (*BlitFramebufferProc)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+                                        GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+                                        GLbitfield mask, GLenum filter);
+    typedef void* (*FenceSyncProc)(GLenum condition, GLbitfield flags);
+    typedef void (*WaitSyncProc)(void* sync, GLbitfield flags, uint64_t timeout);
+    typedef void (*DeleteSyncProc)(void* sync);
+
+    GLProcLoader m_load_proc;
+    // Loaded by the VLC thread before the first fence, from OpenGL 3.2 and
+    // OpenGL ES 3.0
+    bool m_sync_detected = false;
+    FenceSyncProc m_glFenceSync = nullptr;
+    WaitSyncProc m_glWaitSync = nullptr;
+    DeleteSyncProc m_glDeleteSync = nullptr;
+
+    // Target texture set by setTargetTexture and the frame presented last,
+    // between the main thread and the render thread
+    std::mutex m_present_lock;
+    std::atomic<bool> m_has_target{false};
+    GLuint m_target_tex = 0;
+    unsigned m_target_width = 0;
+    unsigned m_target_height = 0;
+    GLuint m_presented_source = 0;
+    unsigned m_presented_width = 0;
+    unsigned m_presented_height = 0;
+    unsigned m_presented_levels = 1;
+    void* m_presented_fence = nullptr;
+    // Until the render thread work submitted its commands on the presented
+    // frame, which the main thread keeps displayed meanwhile
+    std::atomic<bool> m_present_pending{false};
+    // Written under the lock, bumped when there is something to process
+    std::atomic<uint64_t> m_presented_serial{0};
+    // Render thread only
+    uint64_t m_processed_serial = 0;
+    // Read and draw framebuffers of the copy to the target, in Unity's
+    // context. The copy is a scaling blit from OpenGL 3.0 and OpenGL ES 3.0,
+    // a plain copy of frames of the target size before.
+    GLuint m_copy_fbo = 0;
+    GLuint m_target_fbo = 0;
+    bool m_blit_detected = false;
+    BlitFramebufferProc m_glBlitFramebuffer = nullptr;
 };
 
 
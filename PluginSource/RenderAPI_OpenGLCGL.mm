@@ -100,7 +100,6 @@ RenderAPI_OpenGLCGL::RenderAPI_OpenGLCGL(UnityGfxRenderer apiType)
 void RenderAPI_OpenGLCGL::swap(void* opaque)
 {
     RenderAPI_OpenGLCGL* that = reinterpret_cast<RenderAPI_OpenGLCGL*>(opaque);
-    std::lock_guard<std::mutex> lock(that->text_lock);
 
 #if defined(SHOW_WATERMARK)
     bool isPaused = libvlc_unity_trial_is_paused();
@@ -113,12 +112,13 @@ void RenderAPI_OpenGLCGL::swap(void* opaque)
         libvlc_media_player_stop_async(that->m_mp);
         return;
     }
-    that->watermark.draw(that->fbo[that->idx_render], that->width, that->height);
+    that->watermark.draw(that->fbo[that->frames.renderIndex()], that->width, that->height);
 #endif
 
-    that->updated = true;
-    std::swap(that->idx_swap, that->idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->idx_render]);
+    that->m_stats.frameRendered();
+    if (that->frames.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->frames.renderIndex()]);
 }
 
 
@@ -133,7 +133,7 @@ bool RenderAPI_OpenGLCGL::makeCurrent(bool current)
             DEBUG("[GLCGL] make current failed");
             return false;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo[idx_render]);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[frames.renderIndex()]);
     }
     else
     {
@@ -169,6 +169,7 @@ bool RenderAPI_OpenGLCGL::setup(void **opaque, const libvlc_video_setup_device_c
     auto *that = static_cast<RenderAPI_OpenGLCGL*>(*opaque);
     that->width = 0;
     that->height = 0;
+    that->setVideoSize(0, 0);
 
     bool ret = true;
 
@@ -180,6 +181,8 @@ bool RenderAPI_OpenGLCGL::setup(void **opaque, const libvlc_video_setup_device_c
     that->makeCurrent(false);
 #endif
 
+    if (ret)
+        that->vlcOutputOpened();
     return ret;
 }
 
@@ -197,6 +200,7 @@ void RenderAPI_OpenGLCGL::cleanup(void* opaque)
     that->watermark.cleanup();
     that->makeCurrent(false);
 #endif
+    that->vlcOutputClosed();
 }
 
 bool RenderAPI_OpenGLCGL::resize(void* opaque, const libvlc_video_render_cfg_t *cfg, libvlc_video_output_cfg_t *output)
@@ -245,6 +249,7 @@ bool RenderAPI_OpenGLCGL::resize(void* opaque, const libvlc_video_render_cfg_t *
 
     that->width = cfg->width;
     that->height = cfg->height;
+    that->setVideoSize(cfg->width, cfg->height);
 
     output->opengl_format = GL_RGBA;
     output->full_range = true;
@@ -338,15 +343,12 @@ void RenderAPI_OpenGLCGL::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnit
 void* RenderAPI_OpenGLCGL::getVideoFrame(unsigned width, unsigned height, bool* out_updated)
 {
     (void)width; (void)height;
-    std::lock_guard<std::mutex> lock(text_lock);
+    bool updated = frames.acquire();
+    if (updated)
+        m_stats.framePresented();
     if (out_updated)
         *out_updated = updated;
-    if (updated)
-    {
-        std::swap(idx_swap, idx_display);
-        updated = false;
-    }
-    return CVMetalTextureGetTexture(buffers[idx_display].texture_metal);
+    return CVMetalTextureGetTexture(buffers[frames.displayIndex()].texture_metal);
 }
 
 void RenderAPI_OpenGLCGL::releaseFrameBufferResources()
@@ -7,7 +7,7 @@
 #import <OpenGLES/ES2/gl.h>
 #import <CoreVideo/CVMetalTextureCache.h>
 #import <CoreVideo/CoreVideo.h>
-#include <mutex>
+#include "TripleBuffer.h"
 #if defined(SHOW_WATERMARK)
 #include "RenderAPI_OpenGLWatermark.h"
 #endif
@@ -98,14 +98,10 @@ private:
 
     RenderAPICoreVideoBuffer buffers[3];
 
-    std::mutex text_lock;
     unsigned width;
     unsigned height;
     GLuint fbo[3];
-    size_t idx_render = 0;
-    size_t idx_swap = 1;
-    size_t idx_display = 2;
-    bool updated;
+    TripleBufferIndex frames;
 
 #if defined(SHOW_WATERMARK)
     OpenGLWatermark watermark;
@@ -85,7 +85,6 @@ RenderAPI_OpenGLEAGL::RenderAPI_OpenGLEAGL(UnityGfxRenderer apiType)
 void RenderAPI_OpenGLEAGL::swap(void* opaque)
 {
     RenderAPI_OpenGLEAGL* that = reinterpret_cast<RenderAPI_OpenGLEAGL*>(opaque);
-    std::lock_guard<std::mutex> lock(that->text_lock);
 
 #if defined(SHOW_WATERMARK)
     bool isPaused = libvlc_unity_trial_is_paused();
@@ -98,12 +97,13 @@ void RenderAPI_OpenGLEAGL::swap(void* opaque)
         libvlc_media_player_stop_async(that->m_mp);
         return;
     }
-    that->watermark.draw(that->fbo[that->idx_render], that->width, that->height);
+    that->watermark.draw(that->fbo[that->frames.renderIndex()], that->width, that->height);
 #endif
 
-    that->updated = true;
-    std::swap(that->idx_swap, that->idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->idx_render]);
+    that->m_stats.frameRendered();
+    if (that->frames.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->frames.renderIndex()]);
 }
 
 
@@ -118,7 +118,7 @@ bool RenderAPI_OpenGLEAGL::makeCurrent(bool current)
             DEBUG("[GLEAGL] make current failed");
             return false;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo[idx_render]);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[frames.renderIndex()]);
     }
     else
     {
@@ -154,6 +154,7 @@ bool RenderAPI_OpenGLEAGL::setup(void **opaque, const libvlc_video_setup_device_
     auto *that = static_cast<RenderAPI_OpenGLEAGL*>(*opaque);
     that->width = 0;
     that->height = 0;
+    that->setVideoSize(0, 0);
 
     bool ret = true;
 
@@ -165,6 +166,8 @@ bool RenderAPI_OpenGLEAGL::setup(void **opaque, const libvlc_video_setup_device_
 
     that->makeCurrent(false);
 #endif
+    if (ret)
+        that->vlcOutputOpened();
     return ret;
 }
 
@@ -177,6 +180,7 @@ void RenderAPI_OpenGLEAGL::cleanup(void* opaque)
 #if defined(SHOW_WATERMARK)
      that->watermark.cleanup();
 #endif
+    that->vlcOutputClosed();
 }
 
 bool RenderAPI_OpenGLEAGL::resize(void* opaque, const libvlc_video_render_cfg_t *cfg, libvlc_video_output_cfg_t *output)
@@ -217,8 +221,9 @@ bool RenderAPI_OpenGLEAGL::resize(void* opaque, const libvlc_video_render_cfg_t
 
     that->width = cfg->width;
     that->height = cfg->height;
+    that->setVideoSize(cfg->width, cfg->height);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->idx_render]);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->fbo[that->frames.renderIndex()]);
 
     output->opengl_format = GL_RGBA;
     output->full_range = true;
@@ -316,15 +321,12 @@ void RenderAPI_OpenGLEAGL::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUni
 void* RenderAPI_OpenGLEAGL::getVideoFrame(unsigned width, unsigned height, bool* out_updated)
 {
     (void)width; (void)height;
-    std::lock_guard<std::mutex> lock(text_lock);
+    bool updated = frames.acquire();
+    if (updated)
+        m_stats.framePresented();
     if (out_updated)
         *out_updated = updated;
-    if (updated)
-    {
-        std::swap(idx_swap, idx_display);
-        updated = false;
-    }
-    return CVMetalTextureGetTexture(buffers[idx_display].texture_metal);
+    return CVMetalTextureGetTexture(buffers[frames.displayIndex()].texture_metal);
 }
 
 void RenderAPI_OpenGLEAGL::releaseFrameBufferResources()
@@ -1,4 +1,7 @@
+#define LOG_CATEGORY LogCategory::EGL
+
 #include "RenderAPI_OpenGLEGL.h"
+#include "RenderAPI_OpenGLReadback.h"
 #include "Log.h"
 #include <cassert>
 
@@ -13,7 +16,12 @@ namespace {
 bool staticMakeCurrent(void* data, bool current)
 {
     auto that = static_cast<RenderAPI_OpenEGL*>(data);
-    return that->makeCurrent(current);
+    if (!that->makeCurrent(current))
+        return false;
+    // VLC makes its context current to render a frame, and again to swap it
+    if (current)
+        that->vlcGpuFrameBegin();
+    return true;
 }
 
 }
@@ -23,8 +31,8 @@ RenderAPI* CreateRenderAPI_OpenEGL(UnityGfxRenderer apiType)
 	return new RenderAPI_OpenEGL(apiType);
 }
 
-RenderAPI_OpenEGL::RenderAPI_OpenEGL(UnityGfxRenderer apiType) :
-    RenderAPI_OpenGLBase(apiType)
+RenderAPI_OpenEGL::RenderAPI_OpenEGL(UnityGfxRenderer apiType, GLProcLoader loadProc) :
+    RenderAPI_OpenGLBase(apiType, loadProc)
 {
 }
 
@@ -78,7 +86,7 @@ void RenderAPI_OpenEGL::setVlcContext(libvlc_media_player_t *mp)
 
     DEBUG("[EGL] subscribing to opengl output callbacks %p", this);
     libvlc_video_set_output_callbacks(mp, libvlc_video_engine_gles2,
-        setup, cleanup, nullptr, resize, swap,
+        setup, cleanup, set_window, resize, swap,
         staticMakeCurrent, get_proc_address, nullptr, nullptr, this);
 }
 
@@ -199,6 +207,8 @@ void RenderAPI_OpenEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityI
 #endif
 	} else if (type == kUnityGfxDeviceEventShutdown) {
         DEBUG("[EGL] kUnityGfxDeviceEventShutdown");
+        forgetUnityObjects();
+        m_readback->forget();
         eglDestroyContext(m_display, m_context);
         eglDestroySurface(m_display, m_surface);
 	}
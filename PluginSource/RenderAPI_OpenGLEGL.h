@@ -8,7 +8,7 @@
 class RenderAPI_OpenEGL : public RenderAPI_OpenGLBase
 {
 public:
-	RenderAPI_OpenEGL(UnityGfxRenderer apiType);
+	RenderAPI_OpenEGL(UnityGfxRenderer apiType, GLProcLoader loadProc = get_proc_address);
 	virtual ~RenderAPI_OpenEGL() { }
 
     virtual void setVlcContext(libvlc_media_player_t *mp) override;
@@ -1,8 +1,10 @@
+#define LOG_CATEGORY LogCategory::GLX
+
 #include "RenderAPI_OpenGLGLX.h"
+#include "RenderAPI_OpenGLReadback.h"
 #include "Log.h"
 #include <cassert>
 #include <cstring>
-#include <dirent.h>
 #include <sys/stat.h>
 
 #ifndef GLX_CONTEXT_MAJOR_VERSION_ARB
@@ -17,10 +19,19 @@ Display* RenderAPI_OpenGLGLX::unity_display = nullptr;
 
 namespace {
 
+// Bound on the CPU-side wait for a frame when VLC's context is not shared
+// with Unity's, so that a lost GPU does not hang the vout thread forever.
+const GLuint64 kFenceTimeoutNs = 100000000;
+
 bool staticMakeCurrent(void* data, bool current)
 {
     auto that = static_cast<RenderAPI_OpenGLGLX*>(data);
-    return that->makeCurrent(current);
+    if (!that->makeCurrent(current))
+        return false;
+    // VLC makes its context current to render a frame, and again to swap it
+    if (current)
+        that->vlcGpuFrameBegin();
+    return true;
 }
 
 void* loadGlxProc(const char* name, void*)
@@ -31,13 +42,10 @@ void* loadGlxProc(const char* name, void*)
 
 }
 
-RenderAPI* CreateRenderAPI_OpenGLGLX(UnityGfxRenderer apiType)
-{
-    return new RenderAPI_OpenGLGLX(apiType);
-}
-
-RenderAPI_OpenGLGLX::RenderAPI_OpenGLGLX(UnityGfxRenderer apiType) :
-    RenderAPI_OpenGLBase(apiType)
+RenderAPI_OpenGLGLX::RenderAPI_OpenGLGLX(UnityGfxRenderer apiType, LinuxBackend backend) :
+    RenderAPI_OpenGLBase(apiType, get_proc_address),
+    m_backend(backend),
+    m_cpu_output(*this, "GLX", loadGlxProc)
 {
 }
 
@@ -68,6 +76,24 @@ void* RenderAPI_OpenGLGLX::get_proc_address(void* /*data*/, const char* procname
 
 void RenderAPI_OpenGLGLX::setVlcContext(libvlc_media_player_t *mp)
 {
+    if (m_init_failed) {
+        DEBUG("[GLX] initialization failed, no video output for %p", mp);
+        m_pending_mp = nullptr;
+        return;
+    }
+    if (m_cpu_fallback) {
+        m_pending_mp = nullptr;
+        m_cpu_output.attach(mp);
+        return;
+    }
+    if (m_share_group) {
+        m_pending_mp = nullptr;
+        DEBUG("[GLX] subscribing to share group opengl output callbacks %p", this);
+        libvlc_video_set_output_callbacks(mp, libvlc_video_engine_opengl,
+            setup, cleanup, set_window, resize, swap,
+            staticMakeCurrent, get_proc_address, nullptr, nullptr, this);
+        return;
+    }
     if (!isInitialized()) {
         libvlc_media_player_t* prev = m_pending_mp;
         m_pending_mp = mp;
@@ -80,7 +106,7 @@ void RenderAPI_OpenGLGLX::setVlcContext(libvlc_media_player_t *mp)
 
     DEBUG("[GLX] subscribing to DMA-BUF opengl output callbacks %p", this);
     libvlc_video_set_output_callbacks(mp, libvlc_video_engine_opengl,
-        dmabuf_setup, dmabuf_cleanup, nullptr, dmabuf_resize, dmabuf_swap,
+        dmabuf_setup, dmabuf_cleanup, set_window, dmabuf_resize, dmabuf_swap,
         staticMakeCurrent, get_proc_address, nullptr, nullptr, this);
 }
 
@@ -139,6 +165,11 @@ void RenderAPI_OpenGLGLX::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnit
             return;
         }
 
+        if (m_backend == LinuxBackend::CPU) {
+            enableCPUFallback();
+            return;
+        }
+
         int screen = DefaultScreen(m_display);
 
         // Match Unity's direct/indirect rendering mode
@@ -278,9 +309,27 @@ void RenderAPI_OpenGLGLX::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnit
             return;
         }
 
+        m_shared_context = shared_context;
+        if (m_backend == LinuxBackend::GLXShareGroup) {
+            if (!shared_context) {
+                DEBUG("[GLX] no context in Unity's share group");
+                shutdownInternal();
+                enableCPUFallback();
+                return;
+            }
+            m_share_group = true;
+            DEBUG("[GLX] kUnityGfxDeviceEventInitialize success disp=%p pbuf=%lx ctx=%p share group",
+                  m_display, m_pbuffer, m_context);
+            libvlc_media_player_t* pending = m_pending_mp;
+            m_pending_mp = nullptr;
+            if (pending)
+                setVlcContext(pending);
+            return;
+        }
         if (!initDMABuf()) {
             DEBUG("[GLX] DMA-BUF initialization failed");
             shutdownInternal();
+            enableCPUFallback();
             return;
         }
 
@@ -295,10 +344,37 @@ void RenderAPI_OpenGLGLX::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnit
 
     } else if (type == kUnityGfxDeviceEventShutdown) {
         DEBUG("[GLX] kUnityGfxDeviceEventShutdown");
+        m_cpu_output.releaseUnityObjects(false);
+        m_cpu_fallback.store(false, std::memory_order_relaxed);
+        m_init_failed = false;
+        m_vlc_timer.forget();
+        m_readback->forget();
+        forgetUnityObjects();
         shutdownInternal();
+        LinuxDMABufPool::instance().forgetUnityObjects();
+        LinuxCPUVideoOutput::forgetGarbage();
     }
 }
 
+// Without a render node or memory objects, frames cannot be shared with
+// Unity's context. Not in watermarked builds, the watermark is drawn by VLC's
+// context.
+void RenderAPI_OpenGLGLX::enableCPUFallback()
+{
+#if defined(SHOW_WATERMARK)
+    DEBUG("[GLX] no CPU fallback in watermarked builds");
+    m_init_failed = true;
+    m_pending_mp = nullptr;
+#else
+    DEBUG("[GLX] falling back to uploading CPU frames into Unity's context");
+    m_cpu_fallback.store(true, std::memory_order_release);
+    libvlc_media_player_t* pending = m_pending_mp;
+    m_pending_mp = nullptr;
+    if (pending)
+        setVlcContext(pending);
+#endif
+}
+
 void RenderAPI_OpenGLGLX::shutdownInternal()
 {
     releaseDMABufResources();
@@ -311,6 +387,7 @@ void RenderAPI_OpenGLGLX::shutdownInternal()
         m_pbuffer = None;
     }
     m_dmabuf_initialized = false;
+    m_share_group = false;
     m_display = nullptr;
 }
 
@@ -319,29 +396,77 @@ RenderAPI_OpenGLGLX::~RenderAPI_OpenGLGLX()
     shutdownInternal();
 }
 
+void RenderAPI_OpenGLGLX::waitFencesInUnityContext()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_fence_lock);
+        if (m_unity_fences.empty())
+            return;
+        m_waiting_fences.swap(m_unity_fences);
+    }
+    // Frames complete in order: only the latest fence needs to be waited on
+    for (size_t i = 0; i < m_waiting_fences.size(); i++) {
+        if (i + 1 == m_waiting_fences.size())
+            glWaitSync(m_waiting_fences[i], 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(m_waiting_fences[i]);
+    }
+    m_waiting_fences.clear();
+}
+
 void RenderAPI_OpenGLGLX::performRenderThreadWork()
 {
+    // Unity's context is current, make it wait for the frames acquired since
+    // the last render event before it samples them.
+    const bool unity_current = glXGetCurrentContext() != nullptr;
+    UnityGpuWork gpu_work(*this, unity_current);
+    if (unity_current) {
+        waitFencesInUnityContext();
+        m_dmabuf_retired.collect();
+        LinuxCPUVideoOutput::collectGarbage();
+        if (m_cpu_fallback) {
+            m_cpu_output.renderThreadWork();
+            processPresentedFrame();
+            return;
+        }
+        processPresentedFrame();
+        if (m_share_group)
+            return;
+        if (dmabufReady())
+            LinuxDMABufPool::instance().collectUnity(glDeleters());
+    }
+    if (m_cpu_fallback || m_share_group)
+        return;
+
+    // Fast path: nothing to import, don't contend with the VLC thread
+    if (m_unity_textures_imported.load(std::memory_order_acquire))
+        return;
+
     std::lock_guard<std::mutex> lock(m_dmabuf_lock);
 
-    if (!isInitialized())
+    if (!dmabufReady())
         return;
 
-    if (m_unity_textures_imported || m_dmabuf_width == 0 || m_dmabuf_height == 0)
+    if (m_unity_textures_imported.load(std::memory_order_relaxed) || m_dmabuf_width == 0 || m_dmabuf_height == 0)
         return;
 
-    if (glXGetCurrentContext() == nullptr) {
+    if (!unity_current) {
         DEBUG("[GLX] no GL context current on render thread");
         return;
     }
 
     DEBUG("[GLX] importing DMA-BUF textures into Unity context (render thread)");
-    for (size_t i = 0; i < kDMABufSlots; i++) {
-        if (!importDMABufToUnityContext(m_dmabuf_buffers[i], m_dmabuf_width, m_dmabuf_height)) {
+    unityGpuWorkBegin();
+    for (size_t i = 0; i < m_dmabuf_buffers.slotCount(); i++) {
+        LinuxDMABuf* dmabuf = m_dmabuf_buffers[i].dmabuf;
+        if (dmabuf->unity_tex)
+            continue; // Came back from the pool already imported
+        if (!importDMABufToUnityContext(*dmabuf)) {
             DEBUG("[GLX] failed to import DMA-BUF buffer %zu into Unity context", i);
             return;
         }
+        m_stats.dmabufImported();
     }
-    m_unity_textures_imported = true;
+    m_unity_textures_imported.store(true, std::memory_order_release);
     DEBUG("[GLX] all DMA-BUF textures imported into Unity context");
 }
 
@@ -396,104 +521,69 @@ bool RenderAPI_OpenGLGLX::initDMABuf()
     // Restore Unity's context
     glXMakeContextCurrent(m_display, prev_draw, prev_read, prev_ctx);
 
-    // Open DRM render node
-    DIR* dir = opendir("/dev/dri");
-    if (!dir) {
-        DEBUG("[GLX] cannot open /dev/dri");
+    if (!m_drm)
+        m_drm = LinuxDRMDevice::acquire();
+    if (!m_drm) {
+        DEBUG("[GLX] no shared DRM device");
         return false;
     }
-
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strncmp(entry->d_name, "renderD", 7) == 0) {
-            char path[280];
-            snprintf(path, sizeof(path), "/dev/dri/%.255s", entry->d_name);
-            m_drm_fd = open(path, O_RDWR | O_CLOEXEC);
-            if (m_drm_fd >= 0) {
-                DEBUG("[GLX] opened DRM render node %s (fd=%d)", path, m_drm_fd);
-                break;
-            }
-        }
-    }
-    closedir(dir);
-
-    if (m_drm_fd < 0) {
-        DEBUG("[GLX] no DRM render node found");
-        return false;
-    }
-
-    m_gbm_device = gbm_create_device(m_drm_fd);
-    if (!m_gbm_device) {
-        DEBUG("[GLX] gbm_create_device failed");
-        close(m_drm_fd);
-        m_drm_fd = -1;
-        return false;
-    }
-    DEBUG("[GLX] GBM device created");
+    m_gbm_device = m_drm->gbm();
+    // GL_EXT_memory_object_fd has no way to pass a DRM format modifier and
+    // GLX cannot import EGL images, only linear buffers are shared
+    DEBUG("[GLX] DMA-BUF buffers use modifier 0x%016llx (linear)",
+          (unsigned long long)DRM_FORMAT_MOD_LINEAR);
 
     m_dmabuf_initialized = true;
     return true;
 }
 
-bool RenderAPI_OpenGLGLX::createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h)
+LinuxDMABufPool::GLDeleters RenderAPI_OpenGLGLX::glDeleters() const
 {
-    if (!isInitialized()) {
-        DEBUG("[GLX] createDMABufBuffer called before DMA-BUF initialization");
-        return false;
-    }
-
-    auto cleanup_failed_buffer = [&]() {
-        if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-        if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-        if (buf.vlc_mem_obj && glDeleteMemoryObjectsEXT) {
-            glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-        }
-        if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-        if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-        buf.stride = 0;
-        buf.size = 0;
-    };
+    return { glDeleteMemoryObjectsEXT, raw_glDeleteTextures };
+}
 
-    buf.bo = gbm_bo_create(m_gbm_device, w, h, GBM_FORMAT_ABGR8888,
-                           GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
-    if (!buf.bo) {
-        DEBUG("[GLX] gbm_bo_create failed %ux%u", w, h);
+bool RenderAPI_OpenGLGLX::acquireDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h, uint32_t format)
+{
+    if (!dmabufReady()) {
+        DEBUG("[GLX] acquireDMABufBuffer called before DMA-BUF initialization");
         return false;
     }
 
-    buf.dmabuf_fd = gbm_bo_get_fd(buf.bo);
-    if (buf.dmabuf_fd < 0) {
-        DEBUG("[GLX] gbm_bo_get_fd failed");
-        gbm_bo_destroy(buf.bo);
-        buf.bo = nullptr;
-        return false;
+    auto& pool = LinuxDMABufPool::instance();
+    const std::vector<uint64_t> linear;
+    LinuxDMABuf* dmabuf = pool.acquire(this, w, h, format, linear);
+    if (!dmabuf)
+        dmabuf = pool.allocate(m_drm, this, w, h, format,
+                               GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR, linear);
+    if (dmabuf && !dmabuf->vlc_fbo) {
+        dmabuf->owner = this;
+        if (!createDMABufBuffer(*dmabuf)) {
+            pool.release(dmabuf);
+            dmabuf = nullptr;
+        }
     }
-
-    buf.stride = gbm_bo_get_stride(buf.bo);
-
-    // Get true DMA-BUF allocation size via lseek (stride*height may be too small)
-    off_t real_size = lseek(buf.dmabuf_fd, 0, SEEK_END);
-    lseek(buf.dmabuf_fd, 0, SEEK_SET);
-    if (real_size <= 0) {
-        // Fallback to stride * height
-        buf.size = (uint64_t)buf.stride * h;
-        DEBUG("[GLX] lseek failed, using stride*height=%lu", (unsigned long)buf.size);
-    } else {
-        buf.size = (uint64_t)real_size;
+    if (!dmabuf) {
+        if (format == GBM_FORMAT_ABGR8888)
+            return false;
+        // Not every driver can allocate or render to the deeper formats
+        DEBUG("[GLX] format 0x%08x unavailable, falling back to 8-bit", format);
+        return acquireDMABufBuffer(buf, w, h, GBM_FORMAT_ABGR8888);
     }
+    buf.dmabuf = dmabuf;
+    return true;
+}
 
-    DEBUG("[GLX] DMA-BUF: fd=%d stride=%u size=%lu %ux%u",
-          buf.dmabuf_fd, buf.stride, (unsigned long)buf.size, w, h);
-
+bool RenderAPI_OpenGLGLX::createDMABufBuffer(LinuxDMABuf& buf)
+{
     // Import into VLC's GL context
     glGenTextures(1, &buf.vlc_tex);
     glBindTexture(GL_TEXTURE_2D, buf.vlc_tex);
 
     if (!LinuxGLImportMemoryFd("GLX", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
                                glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
-                               buf.vlc_mem_obj, buf.vlc_tex, buf.dmabuf_fd, buf.size,
-                               w, h, "VLC")) {
-        cleanup_failed_buffer();
+                               buf.vlc_mem_obj, buf.vlc_tex, buf.fd, buf.size,
+                               buf.width, buf.height, LinuxDMABufGLFormat(buf.format), "VLC")) {
+        LinuxDMABufPool::deleteVlcObjects(buf, glDeleters());
         return false;
     }
 
@@ -512,7 +602,7 @@ bool RenderAPI_OpenGLGLX::createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsi
         DEBUG("[GLX] DMA-BUF FBO incomplete, status=0x%x", status);
         glBindTexture(GL_TEXTURE_2D, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        cleanup_failed_buffer();
+        LinuxDMABufPool::deleteVlcObjects(buf, glDeleters());
         return false;
     }
 
@@ -523,7 +613,29 @@ bool RenderAPI_OpenGLGLX::createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsi
     return true;
 }
 
-bool RenderAPI_OpenGLGLX::importDMABufToUnityContext(DMABufBuffer& buf, unsigned w, unsigned h)
+// Buffers the main thread may have handed to Unity, kept until it moved on
+void RenderAPI_OpenGLGLX::retireDMABufBuffers(uint32_t generation)
+{
+    std::vector<LinuxDMABuf*> buffers;
+    for (auto& buf : m_dmabuf_buffers) {
+        if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
+        if (buf.dmabuf)
+            buffers.push_back(buf.dmabuf);
+        buf.dmabuf = nullptr;
+    }
+    m_dmabuf_retired.retire(std::move(buffers), generation);
+}
+
+void RenderAPI_OpenGLGLX::releaseDMABufBuffers()
+{
+    for (auto& buf : m_dmabuf_buffers) {
+        if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
+        LinuxDMABufPool::instance().release(buf.dmabuf);
+        buf.dmabuf = nullptr;
+    }
+}
+
+bool RenderAPI_OpenGLGLX::importDMABufToUnityContext(LinuxDMABuf& buf)
 {
     // Use raw GL function pointers to bypass Unity's GL wrapper.
     raw_glGenTextures(1, &buf.unity_tex);
@@ -531,8 +643,8 @@ bool RenderAPI_OpenGLGLX::importDMABufToUnityContext(DMABufBuffer& buf, unsigned
 
     if (!LinuxGLImportMemoryFd("GLX", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
                                glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
-                               buf.unity_mem_obj, buf.unity_tex, buf.dmabuf_fd, buf.size,
-                               w, h, "Unity")) {
+                               buf.unity_mem_obj, buf.unity_tex, buf.fd, buf.size,
+                               buf.width, buf.height, LinuxDMABufGLFormat(buf.format), "Unity")) {
         if (buf.unity_tex) { raw_glDeleteTextures(1, &buf.unity_tex); buf.unity_tex = 0; }
         buf.unity_mem_obj = 0;
         return false;
@@ -566,37 +678,36 @@ void RenderAPI_OpenGLGLX::releaseDMABufResources()
     }
 
     if (context_current) {
-        for (auto& buf : m_dmabuf_buffers) {
-            if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-            if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-            if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-            if (buf.vlc_mem_obj && glDeleteMemoryObjectsEXT) {
-                glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-            }
+        {
+            std::lock_guard<std::mutex> lock(m_fence_lock);
+            for (GLsync fence : m_unity_fences)
+                glDeleteSync(fence);
+            m_unity_fences.clear();
         }
+        // The buffers stay in the pool for other players, with their Unity
+        // textures, only the objects of our context go away with it
+        releaseDMABufBuffers();
+        m_dmabuf_retired.releaseAll();
+        LinuxDMABufPool::instance().dropOwner(this, glDeleters());
         glXMakeContextCurrent(m_display, prev_draw, prev_read, prev_ctx);
+    } else {
+        for (auto& buf : m_dmabuf_buffers) {
+            buf.fence = nullptr;
+            LinuxDMABufPool::instance().release(buf.dmabuf);
+            buf.dmabuf = nullptr;
+        }
+        m_dmabuf_retired.releaseAll();
+        LinuxDMABufPool::instance().dropOwner(this, LinuxDMABufPool::GLDeleters{ nullptr, nullptr });
     }
 
-    for (auto& buf : m_dmabuf_buffers) {
-        buf.fence = nullptr;
-        buf.vlc_fbo = 0;
-        buf.vlc_tex = 0;
-        buf.vlc_mem_obj = 0;
-        buf.unity_tex = 0;
-        buf.unity_mem_obj = 0;
-
-        if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-        if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-        buf.stride = 0;
-        buf.size = 0;
-    }
-
-    m_unity_textures_imported = false;
+    m_unity_textures_imported.store(false, std::memory_order_release);
+    m_presented_tex.store(0, std::memory_order_relaxed);
     m_dmabuf_width = 0;
     m_dmabuf_height = 0;
+    m_dmabuf_format = 0;
 
-    if (m_gbm_device) { gbm_device_destroy(m_gbm_device); m_gbm_device = nullptr; }
-    if (m_drm_fd >= 0) { close(m_drm_fd); m_drm_fd = -1; }
+    m_gbm_device = nullptr;
+    if (m_drm) { m_drm->release(); m_drm = nullptr; }
 
     glCreateMemoryObjectsEXT = nullptr;
     glTexStorageMem2DEXT = nullptr;
@@ -610,6 +721,23 @@ void RenderAPI_OpenGLGLX::releaseDMABufResources()
     m_dmabuf_initialized = false;
 }
 
+// --- Share group VLC callbacks ---
+
+void RenderAPI_OpenGLGLX::frameComplete()
+{
+    // Only the share group output renders through the base swap. Unity's
+    // context waits on the latest frame at the next render event, which
+    // covers the older ones: only the newest fence is kept
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    if (fence) {
+        std::lock_guard<std::mutex> lock(m_fence_lock);
+        for (GLsync previous : m_unity_fences)
+            glDeleteSync(previous);
+        m_unity_fences.assign(1, fence);
+    }
+}
+
 // --- DMA-BUF VLC callbacks ---
 
 bool RenderAPI_OpenGLGLX::dmabuf_setup(void** opaque,
@@ -623,20 +751,22 @@ bool RenderAPI_OpenGLGLX::dmabuf_setup(void** opaque,
         return false;
     }
     auto* that = static_cast<RenderAPI_OpenGLGLX*>(*opaque);
-    if (!that || !that->isInitialized()) {
+    if (!that || !that->dmabufReady()) {
         DEBUG("[GLX] DMA-BUF setup called before initialization");
         return false;
     }
     that->m_dmabuf_width = 0;
     that->m_dmabuf_height = 0;
+    that->setVideoSize(0, 0);
 #if defined(SHOW_WATERMARK)
     that->makeCurrent(true);
     bool ok = that->watermark.setup();
     that->makeCurrent(false);
-    return ok;
-#else
-    return true;
+    if (!ok)
+        return false;
 #endif
+    that->vlcOutputOpened();
+    return true;
 }
 
 void RenderAPI_OpenGLGLX::dmabuf_cleanup(void* opaque)
@@ -647,28 +777,29 @@ void RenderAPI_OpenGLGLX::dmabuf_cleanup(void* opaque)
         return;
     }
 
+    that->m_size_reporter.setCallback(nullptr, nullptr);
     if (!that->makeCurrent(true)) {
         DEBUG("[GLX] DMA-BUF cleanup skipped because makeCurrent failed");
-        for (auto& buf : that->m_dmabuf_buffers) {
+        for (auto& buf : that->m_dmabuf_buffers)
             buf.fence = nullptr;
-            buf.vlc_fbo = 0;
-            buf.vlc_tex = 0;
-            buf.vlc_mem_obj = 0;
-        }
+        that->m_vlc_timer.forget();
+        that->m_readback->forget();
+        that->vlcOutputClosed();
         return;
     }
+    that->m_vlc_timer.release();
+    that->m_readback->release();
+    // Buffers are kept, along with their objects in our context which
+    // outlives VLC's output: the last frame stays displayed, and the next
+    // resize gets them back from the pool.
     for (auto& buf : that->m_dmabuf_buffers) {
         if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-        if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-        if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-        if (buf.vlc_mem_obj && that->glDeleteMemoryObjectsEXT) {
-            that->glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-        }
     }
 #if defined(SHOW_WATERMARK)
     that->watermark.cleanup();
 #endif
     that->makeCurrent(false);
+    that->vlcOutputClosed();
 }
 
 bool RenderAPI_OpenGLGLX::dmabuf_resize(void* opaque,
@@ -676,7 +807,7 @@ bool RenderAPI_OpenGLGLX::dmabuf_resize(void* opaque,
                                          libvlc_video_output_cfg_t* output)
 {
     auto* that = static_cast<RenderAPI_OpenGLGLX*>(opaque);
-    if (!that || !cfg || !output || !that->isInitialized()) {
+    if (!that || !cfg || !output || !that->dmabufReady()) {
         DEBUG("[GLX] DMA-BUF resize called before initialization");
         return false;
     }
@@ -691,52 +822,73 @@ bool RenderAPI_OpenGLGLX::dmabuf_resize(void* opaque,
     {
         std::lock_guard<std::mutex> lock(that->m_dmabuf_lock);
 
-        if (cfg->width != that->m_dmabuf_width || cfg->height != that->m_dmabuf_height) {
-            for (auto& buf : that->m_dmabuf_buffers) {
-                if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-                if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-                if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-                if (buf.vlc_mem_obj && that->glDeleteMemoryObjectsEXT) {
-                    that->glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-                }
-                if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-                if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-                buf.unity_tex = 0;
-                buf.unity_mem_obj = 0;
-            }
+        const size_t slots = that->m_frame_queue_slots.load(std::memory_order_relaxed);
+        const uint32_t format = LinuxDMABufFormatForBitDepth(that->m_bit_depth.load(std::memory_order_relaxed));
+        const bool reallocate = cfg->width != that->m_dmabuf_width ||
+                                cfg->height != that->m_dmabuf_height ||
+                                format != that->m_dmabuf_format ||
+                                slots != that->m_dmabuf_buffers.slotCount();
+        uint32_t retired_generation = 0;
+        if (reallocate) {
+            // Stop handing out the current buffers. getVideoFrame calls past
+            // that check see the generation change before any slot does.
+            that->m_unity_textures_imported.store(false, std::memory_order_release);
+            retired_generation = that->m_dmabuf_generation.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        // Also drops the frames rendered at the previous size
+        that->m_dmabuf_buffers.configure(slots, that->m_frame_queue_mode.load(std::memory_order_relaxed));
+
+        if (reallocate) {
+            auto& pool = LinuxDMABufPool::instance();
+            that->retireDMABufBuffers(retired_generation);
+            pool.collectOwner(that, that->glDeleters());
 
-            // Create new buffers
-            for (size_t i = 0; i < kDMABufSlots; i++) {
-                if (!that->createDMABufBuffer(that->m_dmabuf_buffers[i], cfg->width, cfg->height)) {
+            bool imported = true;
+            for (size_t i = 0; i < that->m_dmabuf_buffers.slotCount(); i++) {
+                if (!that->acquireDMABufBuffer(that->m_dmabuf_buffers[i], cfg->width, cfg->height, format)) {
                     DEBUG("[GLX] DMA-BUF buffer creation failed for slot %zu", i);
                     ok = false;
                     break;
                 }
+                imported = imported && that->m_dmabuf_buffers[i].dmabuf->unity_tex != 0;
             }
 
             if (ok) {
+                // Not when only the slot count or the format changed
+                if (cfg->width != that->m_dmabuf_width || cfg->height != that->m_dmabuf_height)
+                    that->m_stats.resized();
                 that->m_dmabuf_width = cfg->width;
                 that->m_dmabuf_height = cfg->height;
-                that->m_unity_textures_imported = false;
+                that->m_dmabuf_format = format;
+                that->setVideoSize(cfg->width, cfg->height);
+                that->m_size_reporter.setOutputSize(cfg->width, cfg->height);
+                // A size seen before: nothing left for the render thread
+                if (imported)
+                    that->m_unity_textures_imported.store(true, std::memory_order_release);
+            } else {
+                that->releaseDMABufBuffers();
+                that->m_dmabuf_width = 0;
+                that->m_dmabuf_height = 0;
+                that->m_dmabuf_format = 0;
             }
         }
 
         if (ok) {
-            that->m_idx_render = 0;
-            that->m_idx_swap = 1;
-            that->m_idx_display = 2;
-            that->m_updated = false;
-            glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo);
         }
     }
 
     if (ok) {
+        // VLC only tells RGB from RGBA apart, it renders at the precision
+        // of the slot textures bound as its framebuffer
         output->opengl_format = GL_RGBA;
         output->full_range = true;
         output->colorspace = libvlc_video_colorspace_BT709;
         output->primaries  = libvlc_video_primaries_BT709;
         output->transfer   = libvlc_video_transfer_func_SRGB;
-        output->orientation = libvlc_video_orient_bottom_right;
+        that->m_output_orientation = that->outputOrientation();
+        output->orientation = that->m_output_orientation;
     }
 
     that->makeCurrent(false);
@@ -746,50 +898,143 @@ bool RenderAPI_OpenGLGLX::dmabuf_resize(void* opaque,
 void RenderAPI_OpenGLGLX::dmabuf_swap(void* opaque)
 {
     auto* that = static_cast<RenderAPI_OpenGLGLX*>(opaque);
-    if (!that || !that->isInitialized()) {
+    if (!that || !that->dmabufReady()) {
         DEBUG("[GLX] DMA-BUF swap called before initialization");
         return;
     }
-    std::lock_guard<std::mutex> lock(that->m_dmabuf_lock);
 
     if (that->m_dmabuf_width == 0 || that->m_dmabuf_height == 0)
         return;
 
 #if defined(SHOW_WATERMARK)
     if (that->m_dmabuf_width > 0 && that->m_dmabuf_height > 0) {
-        that->watermark.draw(that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo,
+        that->watermark.draw(that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo,
                              that->m_dmabuf_width, that->m_dmabuf_height);
     }
 #endif
 
+    that->vlcGpuFrameEnd();
+    auto& rendered = that->m_dmabuf_buffers.renderSlot();
+    // Still set when the frame was replaced before Unity acquired it
+    if (rendered.fence)
+        glDeleteSync(rendered.fence);
+    rendered.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Required for another context to ever see the fence signaled
     glFlush();
-    glFinish();
 
-    that->m_updated = true;
-    std::swap(that->m_idx_swap, that->m_idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo);
+    if (!that->m_shared_context && rendered.fence) {
+        // Unity cannot wait on our fence, the frame must be complete before
+        // it is published
+        if (glClientWaitSync(rendered.fence, 0, kFenceTimeoutNs) == GL_TIMEOUT_EXPIRED)
+            DEBUG("[GLX] DMA-BUF frame not complete after %llums",
+                  (unsigned long long)(kFenceTimeoutNs / 1000000));
+        glDeleteSync(rendered.fence);
+        rendered.fence = nullptr;
+    }
+
+    that->stampFrame(rendered.info);
+    that->m_readback->frameRendered(rendered.dmabuf->vlc_tex, that->m_dmabuf_width,
+                                    that->m_dmabuf_height, that->m_output_orientation,
+                                    rendered.info);
+    if (that->m_dmabuf_buffers.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo);
 }
 
-void* RenderAPI_OpenGLGLX::getVideoFrame(unsigned, unsigned, bool* out_updated)
+void* RenderAPI_OpenGLGLX::getVideoFrame(unsigned width, unsigned height, bool* out_updated)
 {
-    std::lock_guard<std::mutex> lock(m_dmabuf_lock);
+    if (m_cpu_fallback)
+        return m_cpu_output.videoFrame(width, height, out_updated);
+    if (m_share_group)
+        return RenderAPI_OpenGLBase::getVideoFrame(width, height, out_updated);
 
     if (out_updated)
         *out_updated = false;
 
-    if (m_dmabuf_width == 0 || m_dmabuf_height == 0)
-        return nullptr;
+    m_size_reporter.request(width, height);
+
+    // Until the render thread imported the buffers of a new generation (or
+    // while they are being allocated), keep presenting the previous one
+    const GLuint presented = m_presented_tex.load(std::memory_order_relaxed);
+    const uint32_t generation = m_dmabuf_generation.load(std::memory_order_acquire);
+    if (!m_unity_textures_imported.load(std::memory_order_acquire))
+        return presented ? (void*)(size_t)presented : nullptr;
+
+    uint32_t skipped = 0;
+    const bool acquired = m_dmabuf_buffers.acquire(&skipped);
+    if (acquired) {
+        auto& display = m_dmabuf_buffers.displaySlot();
+        countPresented(display.info, skipped);
+        if (display.fence) {
+            // Waited on by the next render event, before Unity draws with it
+            std::lock_guard<std::mutex> lock(m_fence_lock);
+            m_unity_fences.push_back(display.fence);
+            display.fence = nullptr;
+        }
+    }
 
-    // Textures not yet imported by render thread
-    if (!m_unity_textures_imported)
-        return nullptr;
+    // No buffer when the slot it showed was dropped by a resize
+    const LinuxDMABuf* shown = m_dmabuf_buffers.displaySlot().dmabuf;
+    const GLuint texture = shown ? shown->unity_tex : 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Switch generations on their first frame only, and not when a resize
+    // started while reading the slots
+    const bool switching = generation != m_presented_generation;
+    if (!texture || (switching && !acquired) ||
+        m_dmabuf_generation.load(std::memory_order_relaxed) != generation)
+        return presented ? (void*)(size_t)presented : nullptr;
+
+    if (switching) {
+        m_presented_generation = generation;
+        m_dmabuf_retired.presented(generation);
+    }
+    m_presented_tex.store(texture, std::memory_order_relaxed);
+    presentFrame(texture, shown->width, shown->height, 1, acquired);
+    if (out_updated)
+        *out_updated = acquired;
+    return (void*)(size_t)texture;
+}
+
+bool RenderAPI_OpenGLGLX::setMipmaps(bool enabled)
+{
+    RenderAPI_OpenGLBase::setMipmaps(enabled);
+    // DMA-BUF imports only have the level VLC renders to
+    const bool supported = m_cpu_fallback || m_backend != LinuxBackend::GLXDMABuf;
+    if (enabled && !supported)
+        DEBUG("[GLX] no mipmaps on DMA-BUF buffers");
+    return supported;
+}
 
-    if (m_updated) {
-        std::swap(m_idx_swap, m_idx_display);
-        m_updated = false;
-        if (out_updated)
-            *out_updated = true;
+bool RenderAPI_OpenGLGLX::requestReadback(unsigned width, unsigned height, int format)
+{
+    // VLC renders to system memory, there is no frame of VLC's context to
+    // read back
+    if (m_cpu_fallback) {
+        DEBUG("[GLX] no readback of CPU frames");
+        return false;
     }
+    return RenderAPI_OpenGLBase::requestReadback(width, height, format);
+}
 
-    return (void*)(size_t)m_dmabuf_buffers[m_idx_display].unity_tex;
+void RenderAPI_OpenGLGLX::setbitDepthFormat(int bit_depth)
+{
+    DEBUG("[GLX] %d-bit slots requested", bit_depth);
+    m_bit_depth.store(bit_depth, std::memory_order_relaxed);
+}
+
+bool RenderAPI_OpenGLGLX::getFrameInfo(FrameInfo* info) const
+{
+    if (m_cpu_fallback)
+        return m_cpu_output.frameInfo(info);
+    if (m_share_group)
+        return RenderAPI_OpenGLBase::getFrameInfo(info);
+
+    if (!m_unity_textures_imported.load(std::memory_order_acquire))
+        return false;
+
+    const FrameInfo& displayed = m_dmabuf_buffers.displaySlot().info;
+    if (displayed.frame_number == 0)
+        return false;
+    *info = displayed;
+    return true;
 }
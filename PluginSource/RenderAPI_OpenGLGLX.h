@@ -3,10 +3,17 @@
 
 #include "RenderAPI_OpenGLBase.h"
 #include "RenderAPI_OpenGLLinuxDMABuf.h"
+#include "LinuxDMABufPool.h"
+#include "LinuxDRMDevice.h"
+#include "FrameQueue.h"
+#include "LinuxCPUVideoOutput.h"
+#include "LinuxBackendProbe.h"
 #include "PlatformBase.h"
 #include <GL/glx.h>
 #include <X11/Xlib.h>
+#include <atomic>
 #include <mutex>
+#include <vector>
 #include <gbm.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -15,7 +22,8 @@
 class RenderAPI_OpenGLGLX : public RenderAPI_OpenGLBase
 {
 public:
-    RenderAPI_OpenGLGLX(UnityGfxRenderer apiType);
+    // backend is one of GLXShareGroup, GLXDMABuf or CPU
+    RenderAPI_OpenGLGLX(UnityGfxRenderer apiType, LinuxBackend backend);
     virtual ~RenderAPI_OpenGLGLX();
 
     virtual void setVlcContext(libvlc_media_player_t *mp) override;
@@ -25,12 +33,19 @@ public:
     virtual void ensureCurrentContext() override;
     virtual bool makeCurrent(bool current) override;
     virtual void performRenderThreadWork() override;
-    bool isInitialized() const override { return m_dmabuf_initialized && m_context != nullptr && m_pbuffer != None && m_gbm_device != nullptr; }
+    bool isInitialized() const override { return m_cpu_fallback || m_share_group || m_init_failed || dmabufReady(); }
 
     static void* get_proc_address(void* /*data*/, const char* procname);
     void* getVideoFrame(unsigned width, unsigned height, bool* out_updated) override;
+    bool getFrameInfo(FrameInfo* info) const override;
+    void setbitDepthFormat(int bit_depth) override;
+    bool setMipmaps(bool enabled) override;
+    bool requestReadback(unsigned width, unsigned height, int format) override;
 
 protected:
+    friend class LinuxBackendProbe;
+
+    const LinuxBackend m_backend;
     Display* m_display = nullptr;
     GLXPbuffer m_pbuffer = None;
     GLXContext m_context = nullptr;
@@ -38,36 +53,67 @@ protected:
     static GLXContext unity_context;
     static Display* unity_display;
 
-    // DMA-BUF buffer descriptor (one per triple-buffer slot)
+    // Set once VLC's context is in Unity's share group and its textures are
+    // handed to Unity as they are (LinuxBackend::GLXShareGroup), with the
+    // base class output callbacks
+    bool m_share_group = false;
+    void frameComplete() override;
+
+    // Set when frames cannot be shared with Unity's context: they are
+    // decoded on the CPU and uploaded by the render thread instead
+    std::atomic<bool> m_cpu_fallback{false};
+    LinuxCPUVideoOutput m_cpu_output;
+    void enableCPUFallback();
+    // Set when no way of handing frames over is left, until the device shuts
+    // down: players get no video output, initialization is not retried
+    bool m_init_failed = false;
+
+    // Frame queue slot, its buffer is taken from LinuxDMABufPool
     struct DMABufBuffer {
-        struct gbm_bo* bo = nullptr;
-        int dmabuf_fd = -1;
-        GLuint vlc_mem_obj = 0;
-        GLuint vlc_tex = 0;
-        GLuint vlc_fbo = 0;
-        GLuint unity_mem_obj = 0;
-        GLuint unity_tex = 0;
-        uint32_t stride = 0;
-        uint64_t size = 0;
+        LinuxDMABuf* dmabuf = nullptr;
         GLsync fence = nullptr;
+        FrameInfo info;
     };
 
     // DMA-BUF state
-    static constexpr size_t kDMABufSlots = 3;
     bool m_dmabuf_initialized = false;
-    bool m_unity_textures_imported = false;
+    bool dmabufReady() const { return m_dmabuf_initialized && m_context != nullptr && m_pbuffer != None && m_gbm_device != nullptr; }
+    std::atomic<bool> m_unity_textures_imported{false};
+    LinuxDRMDevice* m_drm = nullptr;
     struct gbm_device* m_gbm_device = nullptr;
-    int m_drm_fd = -1;
-    DMABufBuffer m_dmabuf_buffers[kDMABufSlots];
+    FrameQueue<DMABufBuffer> m_dmabuf_buffers;
     unsigned m_dmabuf_width = 0;
     unsigned m_dmabuf_height = 0;
+    // Slot format requested through setbitDepthFormat, applied by the next
+    // resize, and the one the slots were allocated for
+    std::atomic<int> m_bit_depth{8};
+    uint32_t m_dmabuf_format = 0;
 
-    // Shadowed triple-buffer state (same pattern as Vulkan class)
+    // Serializes buffer (re)allocation on the VLC thread with the Unity-side
+    // import on the render thread. Frame exchange itself is lock-free.
     std::mutex m_dmabuf_lock;
-    size_t m_idx_render = 0;
-    size_t m_idx_swap = 1;
-    size_t m_idx_display = 2;
-    bool m_updated = false;
+
+    // Every reallocation of the slots starts a new generation. Unity keeps
+    // being handed the last texture of the previous one until the new buffers
+    // are imported and hold a frame, the old buffers are retired once Unity
+    // moved on. getVideoFrame reads the slots without the lock and checks the
+    // generation did not change meanwhile, like a seqlock.
+    std::atomic<uint32_t> m_dmabuf_generation{0};
+    LinuxDMABufRetireList m_dmabuf_retired;
+    // What Unity was handed last, main thread only but reset on teardown
+    std::atomic<GLuint> m_presented_tex{0};
+    uint32_t m_presented_generation = 0;
+
+    // Frames are synchronized with fences rather than by finishing VLC's
+    // context: dmabuf_swap fences every frame, getVideoFrame hands the fence
+    // of the frame it acquires over to the render thread, which makes Unity's
+    // context wait for it GPU-side. Sync objects only cross contexts of the
+    // same share group, without one VLC's thread waits for its frames itself.
+    bool m_shared_context = false;
+    std::mutex m_fence_lock;
+    std::vector<GLsync> m_unity_fences;
+    std::vector<GLsync> m_waiting_fences; // render thread only
+    void waitFencesInUnityContext();
 
     // GL_EXT_memory_object_fd function pointers
     PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT = nullptr;
@@ -88,8 +134,12 @@ protected:
 
     void shutdownInternal();
 
-    bool createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h);
-    bool importDMABufToUnityContext(DMABufBuffer& buf, unsigned w, unsigned h);
+    bool acquireDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h, uint32_t format);
+    bool createDMABufBuffer(LinuxDMABuf& buf);
+    bool importDMABufToUnityContext(LinuxDMABuf& buf);
+    void releaseDMABufBuffers();
+    void retireDMABufBuffers(uint32_t generation);
+    LinuxDMABufPool::GLDeleters glDeleters() const;
     bool loadMemoryObjectExtensions();
 
     // DMA-BUF-specific VLC callbacks
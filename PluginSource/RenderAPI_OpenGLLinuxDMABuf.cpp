@@ -1,7 +1,13 @@
+#define LOG_CATEGORY LogCategory::DMABuf
+
 #include "RenderAPI_OpenGLLinuxDMABuf.h"
 #include "Log.h"
+#include <cerrno>
 #include <cstring>
+#include <gbm.h>
+#include <poll.h>
 #include <unistd.h>
+#include <xf86drm.h>
 
 #ifndef GL_HANDLE_TYPE_OPAQUE_FD_EXT
 #define GL_HANDLE_TYPE_OPAQUE_FD_EXT 0x9586
@@ -153,6 +159,24 @@ bool LinuxGLLoadMemoryObjectFunctions(const char* logPrefix,
     return true;
 }
 
+uint32_t LinuxDMABufFormatForBitDepth(int bitDepth)
+{
+    switch (bitDepth) {
+    case 10: return GBM_FORMAT_ABGR2101010;
+    case 16: return GBM_FORMAT_ABGR16161616F;
+    default: return GBM_FORMAT_ABGR8888;
+    }
+}
+
+GLenum LinuxDMABufGLFormat(uint32_t format)
+{
+    switch (format) {
+    case GBM_FORMAT_ABGR2101010: return GL_RGB10_A2;
+    case GBM_FORMAT_ABGR16161616F: return GL_RGBA16F;
+    default: return GL_RGBA8;
+    }
+}
+
 bool LinuxGLImportMemoryFd(const char* logPrefix,
                            PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT,
                            PFNGLIMPORTMEMORYFDEXTPROC glImportMemoryFdEXT,
@@ -165,6 +189,7 @@ bool LinuxGLImportMemoryFd(const char* logPrefix,
                            uint64_t size,
                            unsigned width,
                            unsigned height,
+                           GLenum internalFormat,
                            const char* label)
 {
     glCreateMemoryObjectsEXT(1, &memObj);
@@ -198,7 +223,7 @@ bool LinuxGLImportMemoryFd(const char* logPrefix,
     }
 
     clearGlErrors();
-    glTexStorageMem2DEXT(GL_TEXTURE_2D, 1, GL_RGBA8, width, height, memObj, 0);
+    glTexStorageMem2DEXT(GL_TEXTURE_2D, 1, internalFormat, width, height, memObj, 0);
     err = glGetError();
     if (err != GL_NO_ERROR) {
         DEBUG("[%s] glTexStorageMem2DEXT failed for %s, GL error=0x%x (size=%lu, %ux%u)",
@@ -214,3 +239,241 @@ bool LinuxGLImportMemoryFd(const char* logPrefix,
           logPrefix, label, tex, memObj, (unsigned long)size);
     return true;
 }
+
+bool LinuxGLLoadSemaphoreFunctions(const char* logPrefix,
+                                   LinuxGLProcLoader loadProc,
+                                   void* loadProcData,
+                                   LinuxGLSemaphoreFunctions& functions)
+{
+    functions = LinuxGLSemaphoreFunctions();
+    static const char* requiredExtensions[] = {
+        "GL_EXT_semaphore",
+        "GL_EXT_semaphore_fd",
+    };
+    if (!LinuxGLHasExtensions(logPrefix, loadProc, loadProcData, requiredExtensions,
+                              sizeof(requiredExtensions) / sizeof(requiredExtensions[0])))
+        return false;
+
+    functions.glGenSemaphoresEXT = reinterpret_cast<PFNGLGENSEMAPHORESEXTPROC>(
+        loadProc("glGenSemaphoresEXT", loadProcData));
+    functions.glDeleteSemaphoresEXT = reinterpret_cast<PFNGLDELETESEMAPHORESEXTPROC>(
+        loadProc("glDeleteSemaphoresEXT", loadProcData));
+    functions.glImportSemaphoreFdEXT = reinterpret_cast<PFNGLIMPORTSEMAPHOREFDEXTPROC>(
+        loadProc("glImportSemaphoreFdEXT", loadProcData));
+    functions.glWaitSemaphoreEXT = reinterpret_cast<PFNGLWAITSEMAPHOREEXTPROC>(
+        loadProc("glWaitSemaphoreEXT", loadProcData));
+
+    if (!functions.glGenSemaphoresEXT || !functions.glDeleteSemaphoresEXT ||
+        !functions.glImportSemaphoreFdEXT || !functions.glWaitSemaphoreEXT) {
+        DEBUG("[%s] failed to load GL_EXT_semaphore_fd functions", logPrefix);
+        functions = LinuxGLSemaphoreFunctions();
+        return false;
+    }
+
+    DEBUG("[%s] GL_EXT_semaphore_fd functions loaded", logPrefix);
+    return true;
+}
+
+namespace {
+
+// Wraps a sync_file into a new DRM syncobj and returns its opaque fd, which
+// is what GL_HANDLE_TYPE_OPAQUE_FD_EXT semaphores are on Linux drivers.
+int syncFileToSyncobjFd(int drmFd, int syncFileFd)
+{
+    uint32_t handle = 0;
+    if (drmSyncobjCreate(drmFd, 0, &handle) != 0)
+        return -1;
+    int objFd = -1;
+    if (drmSyncobjImportSyncFile(drmFd, handle, syncFileFd) != 0 ||
+        drmSyncobjHandleToFD(drmFd, handle, &objFd) != 0)
+        objFd = -1;
+    // The fd keeps the syncobj alive
+    drmSyncobjDestroy(drmFd, handle);
+    return objFd;
+}
+
+void waitSyncFileOnCpu(const char* logPrefix, int syncFileFd, int timeoutMs)
+{
+    struct pollfd pfd = { syncFileFd, POLLIN, 0 };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeoutMs);
+    } while (ret < 0 && errno == EINTR);
+    if (ret == 0)
+        DEBUG("[%s] frame not complete after %dms", logPrefix, timeoutMs);
+}
+
+} // namespace
+
+void LinuxGLWaitSyncFile(const char* logPrefix,
+                         int drmFd,
+                         const LinuxGLSemaphoreFunctions* semaphores,
+                         int syncFileFd,
+                         int timeoutMs)
+{
+    if (syncFileFd < 0)
+        return;
+
+    int objFd = semaphores && drmFd >= 0 ? syncFileToSyncobjFd(drmFd, syncFileFd) : -1;
+    if (objFd < 0) {
+        waitSyncFileOnCpu(logPrefix, syncFileFd, timeoutMs);
+        close(syncFileFd);
+        return;
+    }
+
+    GLuint semaphore = 0;
+    semaphores->glGenSemaphoresEXT(1, &semaphore);
+    clearGlErrors();
+    // Takes ownership of objFd on success
+    semaphores->glImportSemaphoreFdEXT(semaphore, GL_HANDLE_TYPE_OPAQUE_FD_EXT, objFd);
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        DEBUG("[%s] glImportSemaphoreFdEXT failed, GL error=0x%x", logPrefix, err);
+        semaphores->glDeleteSemaphoresEXT(1, &semaphore);
+        close(objFd);
+        waitSyncFileOnCpu(logPrefix, syncFileFd, timeoutMs);
+        close(syncFileFd);
+        return;
+    }
+    semaphores->glWaitSemaphoreEXT(semaphore, 0, nullptr, 0, nullptr, nullptr);
+    // The wait is already queued, deleting only drops our reference
+    semaphores->glDeleteSemaphoresEXT(1, &semaphore);
+    close(syncFileFd);
+}
+
+#ifdef SUPPORT_EGL
+bool LinuxEGLLoadImageFunctions(const char* logPrefix,
+                                EGLDisplay display,
+                                LinuxEGLImageFunctions& functions)
+{
+    functions = LinuxEGLImageFunctions();
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensionListContains(extensions, "EGL_EXT_image_dma_buf_import_modifiers")) {
+        DEBUG("[%s] EGL_EXT_image_dma_buf_import_modifiers not available", logPrefix);
+        return false;
+    }
+
+    functions.eglQueryDmaBufModifiersEXT = reinterpret_cast<PFNEGLQUERYDMABUFMODIFIERSEXTPROC>(
+        eglGetProcAddress("eglQueryDmaBufModifiersEXT"));
+    functions.eglCreateImageKHR = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+        eglGetProcAddress("eglCreateImageKHR"));
+    functions.eglDestroyImageKHR = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+        eglGetProcAddress("eglDestroyImageKHR"));
+    functions.glEGLImageTargetTexture2DOES = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC_>(
+        eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+
+    if (!functions.eglQueryDmaBufModifiersEXT || !functions.eglCreateImageKHR ||
+        !functions.eglDestroyImageKHR || !functions.glEGLImageTargetTexture2DOES) {
+        DEBUG("[%s] failed to load EGL DMA-BUF import functions", logPrefix);
+        functions = LinuxEGLImageFunctions();
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint64_t> LinuxEGLQueryModifiers(const char* logPrefix,
+                                             EGLDisplay display,
+                                             const LinuxEGLImageFunctions& functions,
+                                             uint32_t format)
+{
+    std::vector<uint64_t> modifiers;
+    if (!functions.eglQueryDmaBufModifiersEXT)
+        return modifiers;
+
+    EGLint count = 0;
+    if (!functions.eglQueryDmaBufModifiersEXT(display, (EGLint)format, 0, nullptr, nullptr, &count) || count <= 0) {
+        DEBUG("[%s] no modifiers for format 0x%08x", logPrefix, format);
+        return modifiers;
+    }
+
+    std::vector<EGLuint64KHR> all(count);
+    std::vector<EGLBoolean> external_only(count);
+    if (!functions.eglQueryDmaBufModifiersEXT(display, (EGLint)format, count,
+                                              all.data(), external_only.data(), &count))
+        return modifiers;
+
+    for (EGLint i = 0; i < count; i++) {
+        // External-only layouts can only be sampled as GL_TEXTURE_EXTERNAL_OES
+        if (!external_only[i])
+            modifiers.push_back(all[i]);
+    }
+    DEBUG_VERBOSE("[%s] %zu of %d modifiers usable for format 0x%08x",
+                  logPrefix, modifiers.size(), count, format);
+    return modifiers;
+}
+
+bool LinuxEGLImportDMABuf(const char* logPrefix,
+                          EGLDisplay display,
+                          const LinuxEGLImageFunctions& functions,
+                          int dmabufFd,
+                          unsigned width,
+                          unsigned height,
+                          uint32_t format,
+                          uint64_t modifier,
+                          unsigned planeCount,
+                          const uint32_t* offsets,
+                          const uint32_t* strides,
+                          const char* label)
+{
+    static const EGLint planeAttribs[][5] = {
+        { EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE0_PITCH_EXT,
+          EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT },
+        { EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT,
+          EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT },
+        { EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT, EGL_DMA_BUF_PLANE2_PITCH_EXT,
+          EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT },
+        { EGL_DMA_BUF_PLANE3_FD_EXT, EGL_DMA_BUF_PLANE3_OFFSET_EXT, EGL_DMA_BUF_PLANE3_PITCH_EXT,
+          EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT, EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT },
+    };
+    const unsigned maxPlanes = sizeof(planeAttribs) / sizeof(planeAttribs[0]);
+    if (planeCount == 0 || planeCount > maxPlanes) {
+        DEBUG("[%s] cannot import %u planes for %s", logPrefix, planeCount, label);
+        return false;
+    }
+
+    EGLint attribs[6 + 4 * 10 + 1];
+    size_t n = 0;
+    attribs[n++] = EGL_WIDTH;
+    attribs[n++] = (EGLint)width;
+    attribs[n++] = EGL_HEIGHT;
+    attribs[n++] = (EGLint)height;
+    attribs[n++] = EGL_LINUX_DRM_FOURCC_EXT;
+    attribs[n++] = (EGLint)format;
+    for (unsigned i = 0; i < planeCount; i++) {
+        // Auxiliary planes live in the same buffer object
+        attribs[n++] = planeAttribs[i][0];
+        attribs[n++] = dmabufFd;
+        attribs[n++] = planeAttribs[i][1];
+        attribs[n++] = (EGLint)offsets[i];
+        attribs[n++] = planeAttribs[i][2];
+        attribs[n++] = (EGLint)strides[i];
+        attribs[n++] = planeAttribs[i][3];
+        attribs[n++] = (EGLint)(modifier & 0xffffffff);
+        attribs[n++] = planeAttribs[i][4];
+        attribs[n++] = (EGLint)(modifier >> 32);
+    }
+    attribs[n++] = EGL_NONE;
+
+    EGLImageKHR image = functions.eglCreateImageKHR(display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT,
+                                                    nullptr, attribs);
+    if (image == EGL_NO_IMAGE_KHR) {
+        DEBUG("[%s] eglCreateImageKHR failed for %s: 0x%x (modifier 0x%016llx)",
+              logPrefix, label, eglGetError(), (unsigned long long)modifier);
+        return false;
+    }
+
+    clearGlErrors();
+    functions.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, image);
+    GLenum err = glGetError();
+    functions.eglDestroyImageKHR(display, image);
+    if (err != GL_NO_ERROR) {
+        DEBUG("[%s] glEGLImageTargetTexture2DOES failed for %s, GL error=0x%x",
+              logPrefix, label, err);
+        return false;
+    }
+
+    DEBUG("[%s] EGL image imported for %s: modifier 0x%016llx, %u plane(s)",
+          logPrefix, label, (unsigned long long)modifier, planeCount);
+    return true;
+}
+#endif
@@ -4,6 +4,12 @@
 #include "RenderAPI_OpenGLBase.h"
 #include <cstddef>
 #include <cstdint>
+#include <vector>
+
+#ifdef SUPPORT_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 typedef void (*PFNGLMEMORYOBJECTPARAMETERIVEXTPROC_)(GLuint, GLenum, const GLint*);
 typedef void (*PFNGLGENTEXTURESPROC_RAW)(GLsizei, GLuint*);
@@ -32,6 +38,13 @@ bool LinuxGLLoadMemoryObjectFunctions(const char* logPrefix,
                                       PFNGLTEXPARAMETERIPROC_RAW& raw_glTexParameteri,
                                       PFNGLDELETETEXTURESPROC_RAW& raw_glDeleteTextures);
 
+// DMA-BUF format of the slots for a bit depth set through
+// libvlc_unity_set_bit_depth_format: 8 for ABGR8888, 10 for ABGR2101010 and
+// 16 for half float ABGR16161616F.
+uint32_t LinuxDMABufFormatForBitDepth(int bitDepth);
+// GL internal format textures importing format are created with.
+GLenum LinuxDMABufGLFormat(uint32_t format);
+
 bool LinuxGLImportMemoryFd(const char* logPrefix,
                            PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT,
                            PFNGLIMPORTMEMORYFDEXTPROC glImportMemoryFdEXT,
@@ -44,6 +57,75 @@ bool LinuxGLImportMemoryFd(const char* logPrefix,
                            uint64_t size,
                            unsigned width,
                            unsigned height,
+                           GLenum internalFormat,
                            const char* label);
 
+// GL_EXT_semaphore_fd entry points, loaded in the context that waits.
+struct LinuxGLSemaphoreFunctions
+{
+    PFNGLGENSEMAPHORESEXTPROC glGenSemaphoresEXT = nullptr;
+    PFNGLDELETESEMAPHORESEXTPROC glDeleteSemaphoresEXT = nullptr;
+    PFNGLIMPORTSEMAPHOREFDEXTPROC glImportSemaphoreFdEXT = nullptr;
+    PFNGLWAITSEMAPHOREEXTPROC glWaitSemaphoreEXT = nullptr;
+};
+
+// Loads GL_EXT_semaphore_fd if the current context supports it.
+bool LinuxGLLoadSemaphoreFunctions(const char* logPrefix,
+                                   LinuxGLProcLoader loadProc,
+                                   void* loadProcData,
+                                   LinuxGLSemaphoreFunctions& functions);
+
+// Makes the current context wait for a sync_file, signaled once the producer
+// finished its frame, and closes it. The sync_file is turned into a DRM
+// syncobj on drmFd, whose opaque fd is imported as a GL semaphore so that the
+// wait happens on the GPU. Without semaphore support (semaphores nullptr) or
+// syncobjs, falls back to waiting on the CPU for at most timeoutMs.
+void LinuxGLWaitSyncFile(const char* logPrefix,
+                         int drmFd,
+                         const LinuxGLSemaphoreFunctions* semaphores,
+                         int syncFileFd,
+                         int timeoutMs);
+
+#ifdef SUPPORT_EGL
+typedef void (*PFNGLEGLIMAGETARGETTEXTURE2DOESPROC_)(GLenum, void*);
+
+// EGL_EXT_image_dma_buf_import_modifiers entry points. Memory objects cannot
+// carry a DRM format modifier, buffers with a tiled layout are imported
+// through EGL images instead.
+struct LinuxEGLImageFunctions
+{
+    PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT = nullptr;
+    PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR = nullptr;
+    PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR = nullptr;
+    PFNGLEGLIMAGETARGETTEXTURE2DOESPROC_ glEGLImageTargetTexture2DOES = nullptr;
+};
+
+// Loads them if display can import DMA-BUFs with modifiers.
+bool LinuxEGLLoadImageFunctions(const char* logPrefix,
+                                EGLDisplay display,
+                                LinuxEGLImageFunctions& functions);
+
+// Modifiers display can import format with as a regular 2D texture.
+std::vector<uint64_t> LinuxEGLQueryModifiers(const char* logPrefix,
+                                             EGLDisplay display,
+                                             const LinuxEGLImageFunctions& functions,
+                                             uint32_t format);
+
+// Imports a DMA-BUF with its modifier into the texture bound to
+// GL_TEXTURE_2D of the current context. The EGL image is only needed for the
+// import, the texture keeps the storage once it is destroyed.
+bool LinuxEGLImportDMABuf(const char* logPrefix,
+                          EGLDisplay display,
+                          const LinuxEGLImageFunctions& functions,
+                          int dmabufFd,
+                          unsigned width,
+                          unsigned height,
+                          uint32_t format,
+                          uint64_t modifier,
+                          unsigned planeCount,
+                          const uint32_t* offsets,
+                          const uint32_t* strides,
+                          const char* label);
+#endif
+
 #endif /* RENDER_API_OPENGL_LINUX_DMABUF_H */
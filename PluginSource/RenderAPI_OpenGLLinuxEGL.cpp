@@ -1,20 +1,31 @@
+#define LOG_CATEGORY LogCategory::EGL
+
 #include "RenderAPI_OpenGLLinuxEGL.h"
+#include "RenderAPI_OpenGLReadback.h"
 #include "Log.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <dirent.h>
 #include <sys/stat.h>
 
-#ifndef EGL_PLATFORM_GBM_KHR
-#define EGL_PLATFORM_GBM_KHR 0x31D7
-#endif
-
 namespace {
 
+// Bound on waiting for a frame on the CPU, when it cannot be waited on by
+// Unity's context, so that a lost GPU does not hang the thread forever.
+enum : int { kFrameTimeoutMs = 100 };
+
+// VLC-side contexts created ahead of the first players
+enum : unsigned { kPrewarmedContexts = 2 };
+
 bool staticMakeCurrent(void* data, bool current)
 {
     auto that = static_cast<RenderAPI_OpenGLLinuxEGL*>(data);
-    return that->makeCurrent(current);
+    if (!that->makeCurrent(current))
+        return false;
+    // VLC makes its context current to render a frame, and again to swap it
+    if (current)
+        that->vlcGpuFrameBegin();
+    return true;
 }
 
 void* loadDesktopProc(const char* name, void*)
@@ -25,14 +36,13 @@ void* loadDesktopProc(const char* name, void*)
 } // namespace
 
 bool RenderAPI_OpenGLLinuxEGL::m_unity_context_ready = false;
+EGLDisplay RenderAPI_OpenGLLinuxEGL::m_unity_egl_display = EGL_NO_DISPLAY;
+LinuxEGLImageFunctions RenderAPI_OpenGLLinuxEGL::m_unity_egl_image;
 
-RenderAPI* CreateRenderAPI_OpenGLLinuxEGL(UnityGfxRenderer apiType)
-{
-    return new RenderAPI_OpenGLLinuxEGL(apiType);
-}
-
-RenderAPI_OpenGLLinuxEGL::RenderAPI_OpenGLLinuxEGL(UnityGfxRenderer apiType) :
-    RenderAPI_OpenEGL(apiType)
+RenderAPI_OpenGLLinuxEGL::RenderAPI_OpenGLLinuxEGL(UnityGfxRenderer apiType, LinuxBackend backend) :
+    RenderAPI_OpenEGL(apiType, get_proc_address_desktop),
+    m_backend(backend),
+    m_cpu_output(*this, "EGL-Linux", loadDesktopProc)
 {
     // Parent class doesn't initialize these, causing garbage values
     // that bypass safety checks if ProcessDeviceEvent fails
@@ -72,19 +82,25 @@ void RenderAPI_OpenGLLinuxEGL::retrieveOpenGLContext()
     EGLContext egl_ctx = eglGetCurrentContext();
     if (egl_ctx != EGL_NO_CONTEXT) {
         DEBUG("[EGL-Linux] Unity has an EGL context %p", egl_ctx);
+        m_unity_egl_display = eglGetCurrentDisplay();
+        LinuxEGLLoadImageFunctions("EGL-Linux", m_unity_egl_display, m_unity_egl_image);
         m_unity_context_ready = true;
-        return;
-    }
-
-    // Check if Unity exposes a GLX context (XWayland)
-    GLXContext glx_ctx = glXGetCurrentContext();
-    if (glx_ctx != nullptr) {
+    } else {
+        // Check if Unity exposes a GLX context (XWayland)
+        GLXContext glx_ctx = glXGetCurrentContext();
+        if (glx_ctx == nullptr) {
+            DEBUG("[EGL-Linux] no Unity GL context detected yet");
+            return;
+        }
         DEBUG("[EGL-Linux] Unity has a GLX context %p (XWayland)", glx_ctx);
         m_unity_context_ready = true;
-        return;
     }
 
-    DEBUG("[EGL-Linux] no Unity GL context detected yet");
+    // Set up the shared display and the first contexts now rather than when
+    // the first players are created. The device reference is kept until the
+    // graphics device shuts down, so that they survive the players.
+    if (initDRMAndGBM())
+        m_drm->prewarmEGLContexts(kPrewarmedContexts);
 }
 
 // ---------------------------------------------------------------------------
@@ -98,7 +114,7 @@ void RenderAPI_OpenGLLinuxEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type,
     if (type == kUnityGfxDeviceEventInitialize) {
         DEBUG("[EGL-Linux] ProcessDeviceEvent Initialize");
 
-        if (m_context != EGL_NO_CONTEXT) {
+        if (isInitialized()) {
             return;
         }
 
@@ -107,129 +123,32 @@ void RenderAPI_OpenGLLinuxEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type,
             return;
         }
 
-        if (!initDRMAndGBM()) {
-            DEBUG("[EGL-Linux] DRM/GBM init failed");
-            return;
-        }
-
-        // Create EGL display on our GBM device
-        typedef EGLDisplay (*PFNEGLGETPLATFORMDISPLAYEXTPROC_)(EGLenum, void*, const EGLint*);
-        auto eglGetPlatformDisplayEXT_ =
-            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC_>(
-                eglGetProcAddress("eglGetPlatformDisplayEXT"));
-        if (eglGetPlatformDisplayEXT_) {
-            m_display = eglGetPlatformDisplayEXT_(EGL_PLATFORM_GBM_KHR,
-                                                   m_gbm_device, nullptr);
-        }
-        if (m_display == EGL_NO_DISPLAY) {
-            m_display = eglGetDisplay(reinterpret_cast<EGLNativeDisplayType>(m_gbm_device));
-        }
-        if (m_display == EGL_NO_DISPLAY) {
-            DEBUG("[EGL-Linux] eglGetDisplay failed: 0x%x", eglGetError());
-            return;
-        }
-
-        if (!eglInitialize(m_display, nullptr, nullptr)) {
-            DEBUG("[EGL-Linux] eglInitialize failed: 0x%x", eglGetError());
-            m_display = EGL_NO_DISPLAY;
+        if (m_backend == LinuxBackend::CPU) {
+            enableCPUFallback();
             return;
         }
 
-        // Log EGL version and client APIs
-        {
-            const char* egl_vendor = eglQueryString(m_display, EGL_VENDOR);
-            const char* egl_version = eglQueryString(m_display, EGL_VERSION);
-            const char* egl_apis = eglQueryString(m_display, EGL_CLIENT_APIS);
-            DEBUG("[EGL-Linux] EGL vendor=%s version=%s apis=%s",
-                  egl_vendor ? egl_vendor : "?",
-                  egl_version ? egl_version : "?",
-                  egl_apis ? egl_apis : "?");
-        }
-
-        // Bind desktop OpenGL API (not GLES)
-        if (!eglBindAPI(EGL_OPENGL_API)) {
-            DEBUG("[EGL-Linux] eglBindAPI(EGL_OPENGL_API) failed: 0x%x", eglGetError());
+        if (!initDRMAndGBM()) {
+            DEBUG("[EGL-Linux] DRM/GBM init failed");
+            enableCPUFallback();
             return;
         }
-        DEBUG("[EGL-Linux] eglBindAPI(EGL_OPENGL_API) succeeded");
-
-        // Choose an EGL config — surfaceless (we render to DMA-BUF FBOs)
-        // GBM displays typically don't support pbuffers
-        EGLConfig config;
-        EGLint num_configs = 0;
-        bool config_found = false;
-
-        // Try 1: RGBA8 with no surface type constraint
-        {
-            const EGLint attr[] = {
-                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-                EGL_SURFACE_TYPE,    0,
-                EGL_RED_SIZE,   8,
-                EGL_GREEN_SIZE, 8,
-                EGL_BLUE_SIZE,  8,
-                EGL_ALPHA_SIZE, 8,
-                EGL_NONE
-            };
-            if (eglChooseConfig(m_display, attr, &config, 1, &num_configs) && num_configs > 0) {
-                DEBUG("[EGL-Linux] config found (surfaceless RGBA8): %d configs", num_configs);
-                config_found = true;
-            }
-        }
-
-        // Try 2: minimal constraints
-        if (!config_found) {
-            const EGLint attr[] = {
-                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-                EGL_NONE
-            };
-            if (eglChooseConfig(m_display, attr, &config, 1, &num_configs) && num_configs > 0) {
-                DEBUG("[EGL-Linux] config found (minimal GL): %d configs", num_configs);
-                config_found = true;
-            }
-        }
 
-        // Try 3: any config at all (debug)
-        if (!config_found) {
-            EGLint total = 0;
-            eglGetConfigs(m_display, nullptr, 0, &total);
-            DEBUG("[EGL-Linux] no GL configs found, total configs on display: %d", total);
-            if (total > 0) {
-                // Try GLES as last resort
-                eglBindAPI(EGL_OPENGL_ES_API);
-                const EGLint attr[] = {
-                    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-                    EGL_NONE
-                };
-                if (eglChooseConfig(m_display, attr, &config, 1, &num_configs) && num_configs > 0) {
-                    DEBUG("[EGL-Linux] WARNING: only GLES configs available, not desktop GL");
-                }
-            }
-            DEBUG("[EGL-Linux] eglChooseConfig failed, cannot create EGL context");
+        // EGL display on the shared GBM device, initialized by the device
+        m_display = m_drm->eglDisplay();
+        if (m_display == EGL_NO_DISPLAY) {
+            DEBUG("[EGL-Linux] no EGL display on the GBM device");
+            enableCPUFallback();
             return;
         }
 
-        // Surfaceless context — we only render to FBOs backed by DMA-BUF
+        // Borrowed from the device, the config is chosen and usually the
+        // context created before the first player
         m_surface = EGL_NO_SURFACE;
-
-        // Create a standalone GL context (no sharing — we use DMA-BUF instead)
-        // Try GL 4.5 core, then 3.3 core
-        static const int gl_versions[][2] = { {4, 5}, {3, 3} };
-        for (auto& ver : gl_versions) {
-            const EGLint ctx_attr[] = {
-                EGL_CONTEXT_MAJOR_VERSION, ver[0],
-                EGL_CONTEXT_MINOR_VERSION, ver[1],
-                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
-                EGL_NONE
-            };
-            m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, ctx_attr);
-            if (m_context != EGL_NO_CONTEXT) {
-                DEBUG("[EGL-Linux] created GL %d.%d core context", ver[0], ver[1]);
-                break;
-            }
-        }
-
+        m_context = m_drm->acquireEGLContext();
         if (m_context == EGL_NO_CONTEXT) {
-            DEBUG("[EGL-Linux] all eglCreateContext attempts failed: 0x%x", eglGetError());
+            DEBUG("[EGL-Linux] no EGL context available");
+            enableCPUFallback();
             return;
         }
 
@@ -247,10 +166,13 @@ void RenderAPI_OpenGLLinuxEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type,
         if (!loadMemoryObjectExtensions()) {
             DEBUG("[EGL-Linux] GL_EXT_memory_object_fd not available — cannot share textures");
             makeCurrent(false);
-            eglDestroyContext(m_display, m_context);
+            m_drm->releaseEGLContext(m_context, true);
             m_context = EGL_NO_CONTEXT;
+            enableCPUFallback();
             return;
         }
+        loadNativeFenceExtension();
+        negotiateModifiers(GBM_FORMAT_ABGR8888);
         makeCurrent(false);
 
         DEBUG("[EGL-Linux] init success: display=%p surface=%p context=%p gbm=%p",
@@ -262,7 +184,15 @@ void RenderAPI_OpenGLLinuxEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type,
 
     } else if (type == kUnityGfxDeviceEventShutdown) {
         DEBUG("[EGL-Linux] ProcessDeviceEvent Shutdown");
+        m_cpu_output.releaseUnityObjects(false);
+        m_cpu_fallback.store(false, std::memory_order_relaxed);
+        m_init_failed = false;
+        m_vlc_timer.forget();
+        m_readback->forget();
+        forgetUnityObjects();
         releaseResources();
+        LinuxDMABufPool::instance().forgetUnityObjects();
+        LinuxCPUVideoOutput::forgetGarbage();
     }
 }
 
@@ -272,6 +202,16 @@ void RenderAPI_OpenGLLinuxEGL::ProcessDeviceEvent(UnityGfxDeviceEventType type,
 
 void RenderAPI_OpenGLLinuxEGL::setVlcContext(libvlc_media_player_t *mp)
 {
+    if (m_init_failed) {
+        DEBUG("[EGL-Linux] initialization failed, no video output for %p", mp);
+        m_pending_mp = nullptr;
+        return;
+    }
+    if (m_cpu_fallback) {
+        m_pending_mp = nullptr;
+        m_cpu_output.attach(mp);
+        return;
+    }
     if (m_context == EGL_NO_CONTEXT) {
         libvlc_media_player_t* prev = m_pending_mp;
         m_pending_mp = mp;
@@ -283,7 +223,7 @@ void RenderAPI_OpenGLLinuxEGL::setVlcContext(libvlc_media_player_t *mp)
 
     DEBUG("[EGL-Linux] subscribing to DMA-BUF opengl output callbacks %p", this);
     libvlc_video_set_output_callbacks(mp, libvlc_video_engine_opengl,
-        dmabuf_setup, dmabuf_cleanup, nullptr, dmabuf_resize, dmabuf_swap,
+        dmabuf_setup, dmabuf_cleanup, set_window, dmabuf_resize, dmabuf_swap,
         staticMakeCurrent, get_proc_address_desktop, nullptr, nullptr, this);
 }
 
@@ -305,43 +245,37 @@ void RenderAPI_OpenGLLinuxEGL::unsetVlcContext(libvlc_media_player_t *mp)
 
 bool RenderAPI_OpenGLLinuxEGL::initDRMAndGBM()
 {
-    DIR* dir = opendir("/dev/dri");
-    if (!dir) {
-        DEBUG("[EGL-Linux] cannot open /dev/dri");
-        return false;
-    }
-
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strncmp(entry->d_name, "renderD", 7) == 0) {
-            char path[280];
-            snprintf(path, sizeof(path), "/dev/dri/%.255s", entry->d_name);
-            m_drm_fd = open(path, O_RDWR | O_CLOEXEC);
-            if (m_drm_fd >= 0) {
-                DEBUG("[EGL-Linux] opened DRM render node %s (fd=%d)", path, m_drm_fd);
-                break;
-            }
-        }
-    }
-    closedir(dir);
-
-    if (m_drm_fd < 0) {
-        DEBUG("[EGL-Linux] no DRM render node found");
-        return false;
-    }
+    if (m_drm)
+        return true;
 
-    m_gbm_device = gbm_create_device(m_drm_fd);
-    if (!m_gbm_device) {
-        DEBUG("[EGL-Linux] gbm_create_device failed");
-        close(m_drm_fd);
-        m_drm_fd = -1;
+    m_drm = LinuxDRMDevice::acquire();
+    if (!m_drm) {
+        DEBUG("[EGL-Linux] no shared DRM device");
         return false;
     }
-
-    DEBUG("[EGL-Linux] GBM device created");
+    m_gbm_device = m_drm->gbm();
     return true;
 }
 
+// Without a render node, a context on it or memory objects, frames cannot be
+// shared with Unity's context. Not in watermarked builds, the watermark is
+// drawn by VLC's context.
+void RenderAPI_OpenGLLinuxEGL::enableCPUFallback()
+{
+#if defined(SHOW_WATERMARK)
+    DEBUG("[EGL-Linux] no CPU fallback in watermarked builds");
+    m_init_failed = true;
+    m_pending_mp = nullptr;
+#else
+    DEBUG("[EGL-Linux] falling back to uploading CPU frames into Unity's context");
+    m_cpu_fallback.store(true, std::memory_order_release);
+    libvlc_media_player_t* pending = m_pending_mp;
+    m_pending_mp = nullptr;
+    if (pending)
+        setVlcContext(pending);
+#endif
+}
+
 // ---------------------------------------------------------------------------
 // GL_EXT_memory_object_fd extension loading
 // ---------------------------------------------------------------------------
@@ -370,57 +304,162 @@ bool RenderAPI_OpenGLLinuxEGL::loadMemoryObjectExtensions()
                                             raw_glDeleteTextures);
 }
 
-// ---------------------------------------------------------------------------
-// DMA-BUF buffer creation and import
-// ---------------------------------------------------------------------------
-
-bool RenderAPI_OpenGLLinuxEGL::createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h)
+void RenderAPI_OpenGLLinuxEGL::loadNativeFenceExtension()
 {
-    buf.bo = gbm_bo_create(m_gbm_device, w, h, GBM_FORMAT_ABGR8888,
-                           GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
-    if (!buf.bo) {
-        DEBUG("[EGL-Linux] gbm_bo_create failed %ux%u", w, h);
-        return false;
+    m_eglCreateSyncKHR = nullptr;
+    m_eglDestroySyncKHR = nullptr;
+    m_eglDupNativeFenceFDANDROID = nullptr;
+
+    const char* extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_ANDROID_native_fence_sync")) {
+        DEBUG("[EGL-Linux] EGL_ANDROID_native_fence_sync not available, frames are waited for on VLC's thread");
+        return;
+    }
+    auto create = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+    auto destroy = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+    auto dup = reinterpret_cast<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>(
+        eglGetProcAddress("eglDupNativeFenceFDANDROID"));
+    if (!create || !destroy || !dup) {
+        DEBUG("[EGL-Linux] failed to load EGL_ANDROID_native_fence_sync functions");
+        return;
     }
+    m_eglCreateSyncKHR = create;
+    m_eglDestroySyncKHR = destroy;
+    m_eglDupNativeFenceFDANDROID = dup;
+    DEBUG("[EGL-Linux] frames are handed over with sync_file fences");
+}
 
-    buf.dmabuf_fd = gbm_bo_get_fd(buf.bo);
-    if (buf.dmabuf_fd < 0) {
-        DEBUG("[EGL-Linux] gbm_bo_get_fd failed");
-        gbm_bo_destroy(buf.bo);
-        buf.bo = nullptr;
-        return false;
+void RenderAPI_OpenGLLinuxEGL::negotiateModifiers(uint32_t format)
+{
+    m_modifiers.clear();
+    m_modifiers_format = format;
+    m_modifiers_rejected.store(false, std::memory_order_relaxed);
+    const std::vector<uint64_t> unity_modifiers =
+        LinuxEGLQueryModifiers("EGL-Linux", m_unity_egl_display, m_unity_egl_image, format);
+    if (unity_modifiers.empty()) {
+        DEBUG("[EGL-Linux] Unity's context only imports linear DMA-BUFs of format 0x%08x", format);
+        return;
     }
+    if (!m_egl_image.eglCreateImageKHR &&
+        !LinuxEGLLoadImageFunctions("EGL-Linux", m_display, m_egl_image))
+        return;
 
-    buf.stride = gbm_bo_get_stride(buf.bo);
+    bool tiled = false;
+    for (uint64_t modifier : LinuxEGLQueryModifiers("EGL-Linux", m_display, m_egl_image, format)) {
+        if (modifier == DRM_FORMAT_MOD_INVALID ||
+            std::find(unity_modifiers.begin(), unity_modifiers.end(), modifier) == unity_modifiers.end())
+            continue;
+        m_modifiers.push_back(modifier);
+        tiled = tiled || modifier != DRM_FORMAT_MOD_LINEAR;
+    }
+    // Software drivers only offer linear, the plain GBM path does that
+    if (!tiled)
+        m_modifiers.clear();
+    DEBUG("[EGL-Linux] %zu DRM format modifiers of format 0x%08x common to VLC's and Unity's contexts%s",
+          m_modifiers.size(), format, m_modifiers.empty() ? ", buffers are linear" : "");
+}
 
-    off_t real_size = lseek(buf.dmabuf_fd, 0, SEEK_END);
-    lseek(buf.dmabuf_fd, 0, SEEK_SET);
-    if (real_size <= 0) {
-        buf.size = (uint64_t)buf.stride * h;
-        DEBUG("[EGL-Linux] lseek failed, using stride*height=%lu", (unsigned long)buf.size);
-    } else {
-        buf.size = (uint64_t)real_size;
+// VLC thread, with VLC's context current. Returns a sync_file signaled once
+// the commands submitted so far complete, or -1.
+int RenderAPI_OpenGLLinuxEGL::exportSyncFile()
+{
+    if (!m_eglDupNativeFenceFDANDROID)
+        return -1;
+
+    const EGLint attribs[] = {
+        EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID,
+        EGL_NONE
+    };
+    EGLSyncKHR sync = m_eglCreateSyncKHR(m_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+    if (sync == EGL_NO_SYNC_KHR) {
+        DEBUG_VERBOSE("[EGL-Linux] eglCreateSyncKHR failed: 0x%x", eglGetError());
+        return -1;
     }
+    // The native fence only exists once the commands have been flushed
+    glFlush();
+    int fd = m_eglDupNativeFenceFDANDROID(m_display, sync);
+    m_eglDestroySyncKHR(m_display, sync);
+    return fd >= 0 ? fd : -1;
+}
 
-    DEBUG("[EGL-Linux] DMA-BUF: fd=%d stride=%u size=%lu %ux%u",
-          buf.dmabuf_fd, buf.stride, (unsigned long)buf.size, w, h);
+// Render thread, with Unity's context current.
+void RenderAPI_OpenGLLinuxEGL::waitFrameInUnityContext(int sync_fd)
+{
+    const bool unity_context = glXGetCurrentContext() != nullptr ||
+                               eglGetCurrentContext() != EGL_NO_CONTEXT;
+    if (unity_context && m_unity_semaphore_support == SemaphoreSupport::Unknown) {
+        m_unity_semaphore_support =
+            LinuxGLLoadSemaphoreFunctions("EGL-Linux", loadDesktopProc, nullptr, m_unity_semaphores)
+                ? SemaphoreSupport::Supported : SemaphoreSupport::Unsupported;
+        if (m_unity_semaphore_support == SemaphoreSupport::Unsupported)
+            DEBUG("[EGL-Linux] Unity's context cannot import semaphores, frames are waited for on the render thread");
+    }
+
+    const bool gpu_wait = unity_context && m_unity_semaphore_support == SemaphoreSupport::Supported;
+    LinuxGLWaitSyncFile("EGL-Linux", m_drm ? m_drm->fd() : -1,
+                        gpu_wait ? &m_unity_semaphores : nullptr,
+                        sync_fd, kFrameTimeoutMs);
+}
 
+// ---------------------------------------------------------------------------
+// DMA-BUF buffer creation and import
+// ---------------------------------------------------------------------------
+
+LinuxDMABufPool::GLDeleters RenderAPI_OpenGLLinuxEGL::glDeleters() const
+{
+    return { glDeleteMemoryObjectsEXT, raw_glDeleteTextures };
+}
+
+bool RenderAPI_OpenGLLinuxEGL::acquireDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h, uint32_t format)
+{
+    if (format != m_modifiers_format)
+        negotiateModifiers(format);
+
+    auto& pool = LinuxDMABufPool::instance();
+    LinuxDMABuf* dmabuf = pool.acquire(this, w, h, format, m_modifiers);
+    if (!dmabuf)
+        dmabuf = pool.allocate(m_drm, this, w, h, format,
+                               GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR, m_modifiers);
+    if (dmabuf && !dmabuf->vlc_fbo) {
+        dmabuf->owner = this;
+        if (!createDMABufBuffer(*dmabuf)) {
+            const uint64_t modifier = dmabuf->modifier;
+            pool.release(dmabuf);
+            dmabuf = nullptr;
+            if (modifier != DRM_FORMAT_MOD_LINEAR) {
+                DEBUG("[EGL-Linux] VLC's context rejected modifier 0x%016llx, using linear buffers",
+                      (unsigned long long)modifier);
+                m_modifiers.clear();
+                return acquireDMABufBuffer(buf, w, h, format);
+            }
+        }
+    }
+    if (!dmabuf) {
+        if (format == GBM_FORMAT_ABGR8888)
+            return false;
+        // Not every driver can allocate or render to the deeper formats
+        DEBUG("[EGL-Linux] format 0x%08x unavailable, falling back to 8-bit", format);
+        return acquireDMABufBuffer(buf, w, h, GBM_FORMAT_ABGR8888);
+    }
+    buf.dmabuf = dmabuf;
+    return true;
+}
+
+bool RenderAPI_OpenGLLinuxEGL::createDMABufBuffer(LinuxDMABuf& buf)
+{
     // Import into VLC's EGL/GL context
     glGenTextures(1, &buf.vlc_tex);
     glBindTexture(GL_TEXTURE_2D, buf.vlc_tex);
 
-    if (!LinuxGLImportMemoryFd("EGL-Linux", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
-                               glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
-                               buf.vlc_mem_obj, buf.vlc_tex, buf.dmabuf_fd, buf.size,
-                               w, h, "VLC")) {
-        if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-        if (buf.vlc_mem_obj && glDeleteMemoryObjectsEXT) {
-            glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-        }
-        if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-        if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-        buf.stride = 0;
-        buf.size = 0;
+    const bool imported = buf.modifier == DRM_FORMAT_MOD_LINEAR
+        ? LinuxGLImportMemoryFd("EGL-Linux", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
+                                glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
+                                buf.vlc_mem_obj, buf.vlc_tex, buf.fd, buf.size,
+                                buf.width, buf.height, LinuxDMABufGLFormat(buf.format), "VLC")
+        : LinuxEGLImportDMABuf("EGL-Linux", m_display, m_egl_image, buf.fd, buf.width, buf.height,
+                               buf.format, buf.modifier, buf.plane_count, buf.offsets, buf.strides, "VLC");
+    if (!imported) {
+        LinuxDMABufPool::deleteVlcObjects(buf, glDeleters());
         return false;
     }
 
@@ -438,15 +477,7 @@ bool RenderAPI_OpenGLLinuxEGL::createDMABufBuffer(DMABufBuffer& buf, unsigned w,
         DEBUG("[EGL-Linux] DMA-BUF FBO incomplete, status=0x%x", status);
         glBindTexture(GL_TEXTURE_2D, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-        if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-        if (buf.vlc_mem_obj && glDeleteMemoryObjectsEXT) {
-            glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-        }
-        if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-        if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-        buf.stride = 0;
-        buf.size = 0;
+        LinuxDMABufPool::deleteVlcObjects(buf, glDeleters());
         return false;
     }
 
@@ -457,7 +488,31 @@ bool RenderAPI_OpenGLLinuxEGL::createDMABufBuffer(DMABufBuffer& buf, unsigned w,
     return true;
 }
 
-bool RenderAPI_OpenGLLinuxEGL::importDMABufToUnityContext(DMABufBuffer& buf, unsigned w, unsigned h)
+// VLC thread. Buffers the main thread may have handed to Unity, kept until
+// it moved on.
+void RenderAPI_OpenGLLinuxEGL::retireDMABufBuffers(uint32_t generation)
+{
+    std::vector<LinuxDMABuf*> buffers;
+    for (auto& buf : m_dmabuf_buffers) {
+        if (buf.sync_fd >= 0) { close(buf.sync_fd); buf.sync_fd = -1; }
+        if (buf.dmabuf)
+            buffers.push_back(buf.dmabuf);
+        buf.dmabuf = nullptr;
+    }
+    m_dmabuf_retired.retire(std::move(buffers), generation);
+}
+
+// VLC thread.
+void RenderAPI_OpenGLLinuxEGL::releaseDMABufBuffers()
+{
+    for (auto& buf : m_dmabuf_buffers) {
+        if (buf.sync_fd >= 0) { close(buf.sync_fd); buf.sync_fd = -1; }
+        LinuxDMABufPool::instance().release(buf.dmabuf);
+        buf.dmabuf = nullptr;
+    }
+}
+
+bool RenderAPI_OpenGLLinuxEGL::importDMABufToUnityContext(LinuxDMABuf& buf)
 {
     // Verify Unity's GL context is current
     GLXContext glx_ctx = glXGetCurrentContext();
@@ -478,10 +533,14 @@ bool RenderAPI_OpenGLLinuxEGL::importDMABufToUnityContext(DMABufBuffer& buf, uns
           buf.unity_tex, glGetError());
     raw_glBindTexture(GL_TEXTURE_2D, buf.unity_tex);
 
-    if (!LinuxGLImportMemoryFd("EGL-Linux", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
-                               glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
-                               buf.unity_mem_obj, buf.unity_tex, buf.dmabuf_fd, buf.size,
-                               w, h, "Unity")) {
+    const bool imported = buf.modifier == DRM_FORMAT_MOD_LINEAR
+        ? LinuxGLImportMemoryFd("EGL-Linux", glCreateMemoryObjectsEXT, glImportMemoryFdEXT, glDeleteMemoryObjectsEXT,
+                                glMemoryObjectParameterivEXT, glTexStorageMem2DEXT,
+                                buf.unity_mem_obj, buf.unity_tex, buf.fd, buf.size,
+                                buf.width, buf.height, LinuxDMABufGLFormat(buf.format), "Unity")
+        : LinuxEGLImportDMABuf("EGL-Linux", m_unity_egl_display, m_unity_egl_image, buf.fd, buf.width, buf.height,
+                               buf.format, buf.modifier, buf.plane_count, buf.offsets, buf.strides, "Unity");
+    if (!imported) {
         if (buf.unity_tex) { raw_glDeleteTextures(1, &buf.unity_tex); buf.unity_tex = 0; }
         buf.unity_mem_obj = 0;
         return false;
@@ -510,49 +569,46 @@ void RenderAPI_OpenGLLinuxEGL::releaseResources()
         DEBUG("[EGL-Linux] releaseResources: skipping explicit GL cleanup because makeCurrent failed");
     }
 
+    // The buffers stay in the pool for other players, with their Unity
+    // textures, only the objects of our context go away with it
+    releaseDMABufBuffers();
+    m_dmabuf_retired.releaseAll();
     if (context_current) {
-        for (auto& buf : m_dmabuf_buffers) {
-            if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-            if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-            if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-            if (buf.vlc_mem_obj && glDeleteMemoryObjectsEXT) {
-                glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-            }
-        }
+        LinuxDMABufPool::instance().dropOwner(this, glDeleters());
         makeCurrent(false);
+    } else {
+        LinuxDMABufPool::instance().dropOwner(this, LinuxDMABufPool::GLDeleters{ nullptr, nullptr });
     }
 
-    for (auto& buf : m_dmabuf_buffers) {
-        buf.fence = nullptr;
-        buf.vlc_fbo = 0;
-        buf.vlc_tex = 0;
-        buf.vlc_mem_obj = 0;
-        buf.unity_tex = 0;
-        buf.unity_mem_obj = 0;
-        if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-        if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-        buf.stride = 0;
-        buf.size = 0;
-    }
-
-    m_unity_textures_imported = false;
+    m_unity_textures_imported.store(false, std::memory_order_release);
+    m_presented_tex.store(0, std::memory_order_relaxed);
     m_dmabuf_width = 0;
     m_dmabuf_height = 0;
+    m_dmabuf_format = 0;
 
     if (m_context != EGL_NO_CONTEXT) {
-        eglDestroyContext(m_display, m_context);
+        // Back to the device's pool unless it may still be current somewhere
+        m_drm->releaseEGLContext(m_context, context_current);
         m_context = EGL_NO_CONTEXT;
     }
     if (m_surface != EGL_NO_SURFACE) {
         eglDestroySurface(m_display, m_surface);
         m_surface = EGL_NO_SURFACE;
     }
-    if (m_display != EGL_NO_DISPLAY) {
-        eglTerminate(m_display);
-        m_display = EGL_NO_DISPLAY;
-    }
-    if (m_gbm_device) { gbm_device_destroy(m_gbm_device); m_gbm_device = nullptr; }
-    if (m_drm_fd >= 0) { close(m_drm_fd); m_drm_fd = -1; }
+    int sync_fd = m_unity_sync_fd.exchange(-1, std::memory_order_acq_rel);
+    if (sync_fd >= 0)
+        close(sync_fd);
+    m_eglCreateSyncKHR = nullptr;
+    m_eglDestroySyncKHR = nullptr;
+    m_eglDupNativeFenceFDANDROID = nullptr;
+    m_egl_image = LinuxEGLImageFunctions();
+    m_modifiers.clear();
+    m_modifiers_format = 0;
+
+    // The display belongs to the shared device
+    m_display = EGL_NO_DISPLAY;
+    m_gbm_device = nullptr;
+    if (m_drm) { m_drm->release(); m_drm = nullptr; }
 
     glCreateMemoryObjectsEXT = nullptr;
     glTexStorageMem2DEXT = nullptr;
@@ -582,14 +638,16 @@ bool RenderAPI_OpenGLLinuxEGL::dmabuf_setup(void** opaque,
     auto* that = static_cast<RenderAPI_OpenGLLinuxEGL*>(*opaque);
     that->m_dmabuf_width = 0;
     that->m_dmabuf_height = 0;
+    that->setVideoSize(0, 0);
 #if defined(SHOW_WATERMARK)
     that->makeCurrent(true);
     bool ok = that->watermark.setup();
     that->makeCurrent(false);
-    return ok;
-#else
-    return true;
+    if (!ok)
+        return false;
 #endif
+    that->vlcOutputOpened();
+    return true;
 }
 
 void RenderAPI_OpenGLLinuxEGL::dmabuf_cleanup(void* opaque)
@@ -597,28 +655,70 @@ void RenderAPI_OpenGLLinuxEGL::dmabuf_cleanup(void* opaque)
     DEBUG("[EGL-Linux] DMA-BUF output callback cleanup");
     auto* that = static_cast<RenderAPI_OpenGLLinuxEGL*>(opaque);
 
+    that->m_size_reporter.setCallback(nullptr, nullptr);
+    // Buffers are kept, along with their objects in our context which
+    // outlives VLC's output: the last frame stays displayed, and the next
+    // resize gets them back from the pool.
+    for (auto& buf : that->m_dmabuf_buffers) {
+        if (buf.sync_fd >= 0) { close(buf.sync_fd); buf.sync_fd = -1; }
+    }
     if (!that->makeCurrent(true)) {
         DEBUG("[EGL-Linux] DMA-BUF cleanup skipped because makeCurrent failed");
-        for (auto& buf : that->m_dmabuf_buffers) {
-            buf.fence = nullptr;
-            buf.vlc_fbo = 0;
-            buf.vlc_tex = 0;
-            buf.vlc_mem_obj = 0;
-        }
+        that->m_vlc_timer.forget();
+        that->m_readback->forget();
+        that->vlcOutputClosed();
         return;
     }
-    for (auto& buf : that->m_dmabuf_buffers) {
-        if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-        if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-        if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-        if (buf.vlc_mem_obj && that->glDeleteMemoryObjectsEXT) {
-            that->glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-        }
-    }
+    that->m_vlc_timer.release();
+    that->m_readback->release();
 #if defined(SHOW_WATERMARK)
     that->watermark.cleanup();
 #endif
     that->makeCurrent(false);
+    that->vlcOutputClosed();
+}
+
+// VLC thread, m_dmabuf_lock held and VLC's context current. Replaces the
+// buffers of every slot, the previous ones are retired.
+bool RenderAPI_OpenGLLinuxEGL::reallocateDMABufBuffers(unsigned w, unsigned h, uint32_t format, size_t slots)
+{
+    // Stop handing out the current buffers. getVideoFrame calls past that
+    // check see the generation change before any slot does.
+    m_unity_textures_imported.store(false, std::memory_order_release);
+    const uint32_t retired_generation = m_dmabuf_generation.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // Also drops the frames rendered in the previous buffers
+    m_dmabuf_buffers.configure(slots, m_frame_queue_mode.load(std::memory_order_relaxed));
+
+    auto& pool = LinuxDMABufPool::instance();
+    retireDMABufBuffers(retired_generation);
+    pool.collectOwner(this, glDeleters());
+
+    bool imported = true;
+    for (size_t i = 0; i < m_dmabuf_buffers.slotCount(); i++) {
+        if (!acquireDMABufBuffer(m_dmabuf_buffers[i], w, h, format)) {
+            DEBUG("[EGL-Linux] DMA-BUF buffer creation failed for slot %zu", i);
+            releaseDMABufBuffers();
+            m_dmabuf_width = 0;
+            m_dmabuf_height = 0;
+            m_dmabuf_format = 0;
+            return false;
+        }
+        imported = imported && m_dmabuf_buffers[i].dmabuf->unity_tex != 0;
+    }
+
+    // Not when only the slot count or the format changed
+    if (w != m_dmabuf_width || h != m_dmabuf_height)
+        m_stats.resized();
+    m_dmabuf_width = w;
+    m_dmabuf_height = h;
+    m_dmabuf_format = format;
+    setVideoSize(w, h);
+    m_size_reporter.setOutputSize(w, h);
+    // A size seen before: nothing left for the render thread
+    if (imported)
+        m_unity_textures_imported.store(true, std::memory_order_release);
+    return true;
 }
 
 bool RenderAPI_OpenGLLinuxEGL::dmabuf_resize(void* opaque,
@@ -634,51 +734,34 @@ bool RenderAPI_OpenGLLinuxEGL::dmabuf_resize(void* opaque,
     {
         std::lock_guard<std::mutex> lock(that->m_dmabuf_lock);
 
-        if (cfg->width != that->m_dmabuf_width || cfg->height != that->m_dmabuf_height) {
-            for (auto& buf : that->m_dmabuf_buffers) {
-                if (buf.fence) { glDeleteSync(buf.fence); buf.fence = nullptr; }
-                if (buf.vlc_fbo) { glDeleteFramebuffers(1, &buf.vlc_fbo); buf.vlc_fbo = 0; }
-                if (buf.vlc_tex) { glDeleteTextures(1, &buf.vlc_tex); buf.vlc_tex = 0; }
-                if (buf.vlc_mem_obj && that->glDeleteMemoryObjectsEXT) {
-                    that->glDeleteMemoryObjectsEXT(1, &buf.vlc_mem_obj); buf.vlc_mem_obj = 0;
-                }
-                if (buf.dmabuf_fd >= 0) { close(buf.dmabuf_fd); buf.dmabuf_fd = -1; }
-                if (buf.bo) { gbm_bo_destroy(buf.bo); buf.bo = nullptr; }
-                buf.unity_tex = 0;
-                buf.unity_mem_obj = 0;
-            }
-
-            for (size_t i = 0; i < kDMABufSlots; i++) {
-                if (!that->createDMABufBuffer(that->m_dmabuf_buffers[i], cfg->width, cfg->height)) {
-                    DEBUG("[EGL-Linux] DMA-BUF buffer creation failed for slot %zu", i);
-                    ok = false;
-                    break;
-                }
-            }
-
-            if (ok) {
-                that->m_dmabuf_width = cfg->width;
-                that->m_dmabuf_height = cfg->height;
-                that->m_unity_textures_imported = false;
-            }
+        const size_t slots = that->m_frame_queue_slots.load(std::memory_order_relaxed);
+        const uint32_t format = LinuxDMABufFormatForBitDepth(that->m_bit_depth.load(std::memory_order_relaxed));
+        const bool reallocate = cfg->width != that->m_dmabuf_width ||
+                                cfg->height != that->m_dmabuf_height ||
+                                format != that->m_dmabuf_format ||
+                                slots != that->m_dmabuf_buffers.slotCount();
+        if (reallocate) {
+            ok = that->reallocateDMABufBuffers(cfg->width, cfg->height, format, slots);
+        } else {
+            // Drops the frames rendered before
+            that->m_dmabuf_buffers.configure(slots, that->m_frame_queue_mode.load(std::memory_order_relaxed));
         }
 
         if (ok) {
-            that->m_idx_render = 0;
-            that->m_idx_swap = 1;
-            that->m_idx_display = 2;
-            that->m_updated = false;
-            glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo);
         }
     }
 
     if (ok) {
+        // VLC only tells RGB from RGBA apart, it renders at the precision
+        // of the slot textures bound as its framebuffer
         output->opengl_format = GL_RGBA;
         output->full_range = true;
         output->colorspace = libvlc_video_colorspace_BT709;
         output->primaries  = libvlc_video_primaries_BT709;
         output->transfer   = libvlc_video_transfer_func_SRGB;
-        output->orientation = libvlc_video_orient_bottom_right;
+        that->m_output_orientation = that->outputOrientation();
+        output->orientation = that->m_output_orientation;
     }
 
     that->makeCurrent(false);
@@ -688,26 +771,55 @@ bool RenderAPI_OpenGLLinuxEGL::dmabuf_resize(void* opaque,
 void RenderAPI_OpenGLLinuxEGL::dmabuf_swap(void* opaque)
 {
     auto* that = static_cast<RenderAPI_OpenGLLinuxEGL*>(opaque);
-    std::lock_guard<std::mutex> lock(that->m_dmabuf_lock);
+
+    if (that->m_dmabuf_width == 0 || that->m_dmabuf_height == 0)
+        return;
+
+    if (that->m_modifiers_rejected.exchange(false, std::memory_order_acquire)) {
+        // Unity cannot show the tiled buffers, this frame is lost either way
+        std::lock_guard<std::mutex> lock(that->m_dmabuf_lock);
+        if (!that->reallocateDMABufBuffers(that->m_dmabuf_width, that->m_dmabuf_height,
+                                           that->m_dmabuf_format, that->m_dmabuf_buffers.slotCount()))
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo);
+        return;
+    }
 
 #if defined(SHOW_WATERMARK)
     if (that->m_dmabuf_width > 0 && that->m_dmabuf_height > 0) {
-        that->watermark.draw(that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo,
+        that->watermark.draw(that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo,
                              that->m_dmabuf_width, that->m_dmabuf_height);
     }
 #endif
 
-    auto& rendered = that->m_dmabuf_buffers[that->m_idx_render];
-    if (rendered.fence) {
-        glDeleteSync(rendered.fence);
-        rendered.fence = nullptr;
+    that->vlcGpuFrameEnd();
+    auto& rendered = that->m_dmabuf_buffers.renderSlot();
+    // Still set when the frame was replaced before Unity acquired it
+    if (rendered.sync_fd >= 0) {
+        close(rendered.sync_fd);
+        rendered.sync_fd = -1;
+    }
+    rendered.sync_fd = that->exportSyncFile();
+    if (rendered.sync_fd < 0) {
+        // Nothing Unity could wait on, the frame must be complete before it
+        // is published
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (fence) {
+            if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFrameTimeoutMs * 1000000ull) == GL_TIMEOUT_EXPIRED)
+                DEBUG("[EGL-Linux] DMA-BUF frame not complete after %dms", kFrameTimeoutMs);
+            glDeleteSync(fence);
+        } else {
+            glFinish();
+        }
     }
-    rendered.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-    glFlush();
 
-    that->m_updated = true;
-    std::swap(that->m_idx_swap, that->m_idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers[that->m_idx_render].vlc_fbo);
+    that->stampFrame(rendered.info);
+    that->m_readback->frameRendered(rendered.dmabuf->vlc_tex, that->m_dmabuf_width,
+                                    that->m_dmabuf_height, that->m_output_orientation,
+                                    rendered.info);
+    if (that->m_dmabuf_buffers.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->m_dmabuf_buffers.renderSlot().dmabuf->vlc_fbo);
 }
 
 // ---------------------------------------------------------------------------
@@ -718,19 +830,56 @@ void RenderAPI_OpenGLLinuxEGL::dmabuf_swap(void* opaque)
 
 void RenderAPI_OpenGLLinuxEGL::performRenderThreadWork()
 {
+    int sync_fd = m_unity_sync_fd.exchange(-1, std::memory_order_acq_rel);
+    if (sync_fd >= 0)
+        waitFrameInUnityContext(sync_fd);
+    const bool unity_current = glXGetCurrentContext() != nullptr ||
+                               eglGetCurrentContext() != EGL_NO_CONTEXT;
+    UnityGpuWork gpu_work(*this, unity_current);
+    if (unity_current) {
+        m_dmabuf_retired.collect();
+        if (raw_glDeleteTextures)
+            LinuxDMABufPool::instance().collectUnity(glDeleters());
+        LinuxCPUVideoOutput::collectGarbage();
+        if (m_cpu_fallback) {
+            m_cpu_output.renderThreadWork();
+            processPresentedFrame();
+            return;
+        }
+        processPresentedFrame();
+    }
+    if (m_cpu_fallback)
+        return;
+
+    // Fast path: nothing to import, don't contend with the VLC thread
+    if (m_unity_textures_imported.load(std::memory_order_acquire))
+        return;
+
     std::lock_guard<std::mutex> lock(m_dmabuf_lock);
 
-    if (m_unity_textures_imported || m_dmabuf_width == 0 || m_dmabuf_height == 0)
+    if (m_unity_textures_imported.load(std::memory_order_relaxed) || m_dmabuf_width == 0 || m_dmabuf_height == 0)
         return;
 
     DEBUG("[EGL-Linux] importing DMA-BUF textures into Unity context (render thread)");
-    for (size_t i = 0; i < kDMABufSlots; i++) {
-        if (!importDMABufToUnityContext(m_dmabuf_buffers[i], m_dmabuf_width, m_dmabuf_height)) {
+    if (unity_current)
+        unityGpuWorkBegin();
+    for (size_t i = 0; i < m_dmabuf_buffers.slotCount(); i++) {
+        LinuxDMABuf* dmabuf = m_dmabuf_buffers[i].dmabuf;
+        if (dmabuf->unity_tex)
+            continue; // Came back from the pool already imported
+        if (!importDMABufToUnityContext(*dmabuf)) {
             DEBUG("[EGL-Linux] failed to import DMA-BUF buffer %zu into Unity context", i);
+            if (dmabuf->modifier != DRM_FORMAT_MOD_LINEAR && !m_modifiers.empty()) {
+                DEBUG("[EGL-Linux] Unity's context rejected modifier 0x%016llx, reallocating linear buffers",
+                      (unsigned long long)dmabuf->modifier);
+                m_modifiers.clear();
+                m_modifiers_rejected.store(true, std::memory_order_release);
+            }
             return;
         }
+        m_stats.dmabufImported();
     }
-    m_unity_textures_imported = true;
+    m_unity_textures_imported.store(true, std::memory_order_release);
     DEBUG("[EGL-Linux] all DMA-BUF textures imported into Unity context");
 }
 
@@ -740,34 +889,96 @@ void RenderAPI_OpenGLLinuxEGL::performRenderThreadWork()
 
 void* RenderAPI_OpenGLLinuxEGL::getVideoFrame(unsigned width, unsigned height, bool* out_updated)
 {
-    (void)width; (void)height;
-    std::lock_guard<std::mutex> lock(m_dmabuf_lock);
+    if (m_cpu_fallback)
+        return m_cpu_output.videoFrame(width, height, out_updated);
 
     if (out_updated)
         *out_updated = false;
 
-    if (m_dmabuf_width == 0 || m_dmabuf_height == 0)
-        return nullptr;
+    m_size_reporter.request(width, height);
+
+    // Until the render thread imported the buffers of a new generation (or
+    // while they are being allocated), keep presenting the previous one
+    const GLuint presented = m_presented_tex.load(std::memory_order_relaxed);
+    const uint32_t generation = m_dmabuf_generation.load(std::memory_order_acquire);
+    if (!m_unity_textures_imported.load(std::memory_order_acquire))
+        return presented ? (void*)(size_t)presented : nullptr;
+
+    uint32_t skipped = 0;
+    const bool acquired = m_dmabuf_buffers.acquire(&skipped);
+    if (acquired) {
+        auto& display = m_dmabuf_buffers.displaySlot();
+        countPresented(display.info, skipped);
+        if (display.sync_fd >= 0) {
+            // Waited on in Unity's context by the next render event. Frames
+            // complete in order, an older one still pending can be dropped.
+            int previous = m_unity_sync_fd.exchange(display.sync_fd, std::memory_order_acq_rel);
+            display.sync_fd = -1;
+            if (previous >= 0)
+                close(previous);
+        }
+    }
 
-    // Textures not yet imported by render thread
-    if (!m_unity_textures_imported)
-        return nullptr;
+    // No buffer when the slot it showed was dropped by a resize
+    const LinuxDMABuf* shown = m_dmabuf_buffers.displaySlot().dmabuf;
+    const GLuint texture = shown ? shown->unity_tex : 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Switch generations on their first frame only, and not when a resize
+    // started while reading the slots
+    const bool switching = generation != m_presented_generation;
+    if (!texture || (switching && !acquired) ||
+        m_dmabuf_generation.load(std::memory_order_relaxed) != generation)
+        return presented ? (void*)(size_t)presented : nullptr;
 
-    if (m_updated) {
-        std::swap(m_idx_swap, m_idx_display);
-        m_updated = false;
-        if (out_updated)
-            *out_updated = true;
+    if (switching) {
+        m_presented_generation = generation;
+        m_dmabuf_retired.presented(generation);
     }
+    m_presented_tex.store(texture, std::memory_order_relaxed);
+    presentFrame(texture, shown->width, shown->height, 1, acquired);
+    if (out_updated)
+        *out_updated = acquired;
+    return (void*)(size_t)texture;
+}
 
-    auto& display = m_dmabuf_buffers[m_idx_display];
+bool RenderAPI_OpenGLLinuxEGL::setMipmaps(bool enabled)
+{
+    RenderAPI_OpenGLBase::setMipmaps(enabled);
+    // DMA-BUF imports only have the level VLC renders to
+    const bool supported = m_cpu_fallback || m_backend == LinuxBackend::CPU;
+    if (enabled && !supported)
+        DEBUG("[EGL-Linux] no mipmaps on DMA-BUF buffers");
+    return supported;
+}
 
-    // VLC renders in its own standalone EGL context while Unity consumes the
-    // imported DMA-BUF in a separate GLX context under XWayland. These
-    // contexts are not in the same GL share group, so waiting on a GLsync here
-    // from the managed GetTexture() call can crash inside the driver. Keep the
-    // fence lifetime on the VLC/EGL side and rely on DMA-BUF implicit sync for
-    // this path.
+bool RenderAPI_OpenGLLinuxEGL::requestReadback(unsigned width, unsigned height, int format)
+{
+    // VLC renders to system memory, there is no frame of VLC's context to
+    // read back
+    if (m_cpu_fallback) {
+        DEBUG("[EGL-Linux] no readback of CPU frames");
+        return false;
+    }
+    return RenderAPI_OpenGLBase::requestReadback(width, height, format);
+}
+
+void RenderAPI_OpenGLLinuxEGL::setbitDepthFormat(int bit_depth)
+{
+    DEBUG("[EGL-Linux] %d-bit slots requested", bit_depth);
+    m_bit_depth.store(bit_depth, std::memory_order_relaxed);
+}
 
-    return (void*)(size_t)display.unity_tex;
+bool RenderAPI_OpenGLLinuxEGL::getFrameInfo(FrameInfo* info) const
+{
+    if (m_cpu_fallback)
+        return m_cpu_output.frameInfo(info);
+
+    if (!m_unity_textures_imported.load(std::memory_order_acquire))
+        return false;
+
+    const FrameInfo& displayed = m_dmabuf_buffers.displaySlot().info;
+    if (displayed.frame_number == 0)
+        return false;
+    *info = displayed;
+    return true;
 }
@@ -2,9 +2,17 @@
 #define RENDER_API_OPENGL_LINUX_EGL_H
 
 #include "RenderAPI_OpenGLEGL.h"
+#include <EGL/eglext.h>
 #include "RenderAPI_OpenGLLinuxDMABuf.h"
+#include "LinuxDMABufPool.h"
+#include "LinuxDRMDevice.h"
+#include "FrameQueue.h"
+#include "LinuxCPUVideoOutput.h"
+#include "LinuxBackendProbe.h"
 #include <GL/glx.h>
+#include <atomic>
 #include <mutex>
+#include <vector>
 #include <gbm.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -13,7 +21,8 @@
 class RenderAPI_OpenGLLinuxEGL : public RenderAPI_OpenEGL
 {
 public:
-    RenderAPI_OpenGLLinuxEGL(UnityGfxRenderer apiType);
+    // backend is EGLDMABuf or CPU
+    RenderAPI_OpenGLLinuxEGL(UnityGfxRenderer apiType, LinuxBackend backend);
     virtual ~RenderAPI_OpenGLLinuxEGL();
 
     void setVlcContext(libvlc_media_player_t *mp) override;
@@ -21,48 +30,101 @@ public:
     void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) override;
     void retrieveOpenGLContext() override;
     void* getVideoFrame(unsigned width, unsigned height, bool* out_updated) override;
+    bool getFrameInfo(FrameInfo* info) const override;
+    void setbitDepthFormat(int bit_depth) override;
+    bool setMipmaps(bool enabled) override;
+    bool requestReadback(unsigned width, unsigned height, int format) override;
     void performRenderThreadWork() override;
-    bool isInitialized() const override { return m_context != EGL_NO_CONTEXT; }
+    bool isInitialized() const override { return m_context != EGL_NO_CONTEXT || m_cpu_fallback || m_init_failed; }
 
     static void* get_proc_address_desktop(void* data, const char* procname);
 
 private:
-    // DRM/GBM state
-    int m_drm_fd = -1;
+    friend class LinuxBackendProbe;
+
+    const LinuxBackend m_backend;
+
+    // DRM/GBM state, shared with the other players
+    LinuxDRMDevice* m_drm = nullptr;
     struct gbm_device* m_gbm_device = nullptr;
     libvlc_media_player_t* m_pending_mp = nullptr;
 
     // Unity context flag — static so it's shared across instances
     // (EarlyRenderAPI sets it, per-player instances read it)
     static bool m_unity_context_ready;
+    // Unity's EGL display and its EGL image functions, unset when it is a
+    // GLX context or cannot import EGL images: buffers are linear then
+    static EGLDisplay m_unity_egl_display;
+    static LinuxEGLImageFunctions m_unity_egl_image;
+
+    // Set when frames cannot be shared with Unity's context: they are
+    // decoded on the CPU and uploaded by the render thread instead
+    std::atomic<bool> m_cpu_fallback{false};
+    LinuxCPUVideoOutput m_cpu_output;
+    // Set when no way of handing frames over is left, until the device shuts
+    // down: players get no video output, initialization is not retried
+    bool m_init_failed = false;
 
-    // DMA-BUF buffer descriptor
+    // Frame queue slot, its buffer is taken from LinuxDMABufPool
     struct DMABufBuffer {
-        struct gbm_bo* bo = nullptr;
-        int dmabuf_fd = -1;
-        GLuint vlc_mem_obj = 0;
-        GLuint vlc_tex = 0;
-        GLuint vlc_fbo = 0;
-        GLuint unity_mem_obj = 0;
-        GLuint unity_tex = 0;
-        uint32_t stride = 0;
-        uint64_t size = 0;
-        GLsync fence = nullptr;
+        LinuxDMABuf* dmabuf = nullptr;
+        // sync_file signaled when VLC finished rendering the frame
+        int sync_fd = -1;
+        FrameInfo info;
     };
 
     // DMA-BUF state
-    static constexpr size_t kDMABufSlots = 3;
-    bool m_unity_textures_imported = false;
-    DMABufBuffer m_dmabuf_buffers[kDMABufSlots];
+    std::atomic<bool> m_unity_textures_imported{false};
+    FrameQueue<DMABufBuffer> m_dmabuf_buffers;
     unsigned m_dmabuf_width = 0;
     unsigned m_dmabuf_height = 0;
+    // Slot format requested through setbitDepthFormat, applied by the next
+    // resize, and the one the slots were allocated for
+    std::atomic<int> m_bit_depth{8};
+    uint32_t m_dmabuf_format = 0;
 
-    // Triple-buffer indices
+    // Serializes buffer (re)allocation on the VLC thread with the Unity-side
+    // import on the render thread. Frame exchange itself is lock-free.
     std::mutex m_dmabuf_lock;
-    size_t m_idx_render = 0;
-    size_t m_idx_swap = 1;
-    size_t m_idx_display = 2;
-    bool m_updated = false;
+
+    // Every reallocation of the slots starts a new generation. Unity keeps
+    // being handed the last texture of the previous one until the new buffers
+    // are imported and hold a frame, the old buffers are retired once Unity
+    // moved on. getVideoFrame reads the slots without the lock and checks the
+    // generation did not change meanwhile, like a seqlock.
+    std::atomic<uint32_t> m_dmabuf_generation{0};
+    LinuxDMABufRetireList m_dmabuf_retired;
+    // What Unity was handed last, main thread only but reset on teardown
+    std::atomic<GLuint> m_presented_tex{0};
+    uint32_t m_presented_generation = 0;
+
+    // DRM format modifiers both contexts can import for m_modifiers_format,
+    // negotiated at init and again when the slot format changes.
+    // Empty for linear buffers, which are shared through memory objects like
+    // before; tiled ones go through EGL images as memory objects cannot carry
+    // a modifier. Under m_dmabuf_lock. When Unity's context rejects a tiled
+    // buffer, the render thread drops them and asks VLC's thread to
+    // reallocate the slots as linear.
+    LinuxEGLImageFunctions m_egl_image;
+    std::vector<uint64_t> m_modifiers;
+    uint32_t m_modifiers_format = 0;
+    std::atomic<bool> m_modifiers_rejected{false};
+
+    // VLC's EGL context and Unity's GLX or EGL context share nothing, GLsync
+    // objects cannot cross between them. Each frame instead exports a
+    // sync_file (EGL_ANDROID_native_fence_sync) that travels with its slot.
+    // getVideoFrame passes the one of the frame it acquires to the render
+    // thread, which makes Unity's context wait on it through a
+    // GL_EXT_semaphore_fd semaphore. Without the EGL extension, VLC's thread
+    // waits for its frames itself.
+    PFNEGLCREATESYNCKHRPROC m_eglCreateSyncKHR = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC m_eglDestroySyncKHR = nullptr;
+    PFNEGLDUPNATIVEFENCEFDANDROIDPROC m_eglDupNativeFenceFDANDROID = nullptr;
+    std::atomic<int> m_unity_sync_fd{-1};
+    // Render thread only
+    enum class SemaphoreSupport { Unknown, Supported, Unsupported };
+    SemaphoreSupport m_unity_semaphore_support = SemaphoreSupport::Unknown;
+    LinuxGLSemaphoreFunctions m_unity_semaphores;
 
     // GL_EXT_memory_object_fd function pointers
     PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT = nullptr;
@@ -79,9 +141,19 @@ private:
 
     // Helpers
     bool initDRMAndGBM();
+    void enableCPUFallback();
     bool loadMemoryObjectExtensions();
-    bool createDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h);
-    bool importDMABufToUnityContext(DMABufBuffer& buf, unsigned w, unsigned h);
+    void loadNativeFenceExtension();
+    void negotiateModifiers(uint32_t format);
+    int exportSyncFile();
+    void waitFrameInUnityContext(int sync_fd);
+    bool reallocateDMABufBuffers(unsigned w, unsigned h, uint32_t format, size_t slots);
+    bool acquireDMABufBuffer(DMABufBuffer& buf, unsigned w, unsigned h, uint32_t format);
+    bool createDMABufBuffer(LinuxDMABuf& buf);
+    bool importDMABufToUnityContext(LinuxDMABuf& buf);
+    void releaseDMABufBuffers();
+    void retireDMABufBuffers(uint32_t generation);
+    LinuxDMABufPool::GLDeleters glDeleters() const;
     void releaseResources();
 
     // DMA-BUF VLC callbacks
@@ -0,0 +1,496 @@
+#include "RenderAPI_OpenGLReadback.h"
+#include "Log.h"
+#include <cstring>
+
+#ifndef GL_RGBA8
+#  define GL_RGBA8 0x8058
+#endif
+// Pixel pack buffers, buffer mapping and sync objects of OpenGL 3.2 and
+// OpenGL ES 3, missing from the OpenGL ES 2 headers
+#ifndef GL_PIXEL_PACK_BUFFER
+#  define GL_PIXEL_PACK_BUFFER 0x88EB
+#  define GL_PIXEL_PACK_BUFFER_BINDING 0x88ED
+#endif
+#ifndef GL_STREAM_READ
+#  define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#  define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#  define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#  define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#  define GL_TIMEOUT_EXPIRED 0x911B
+#  define GL_WAIT_FAILED 0x911D
+#endif
+#ifndef GL_VERTEX_ARRAY_BINDING
+#  define GL_VERTEX_ARRAY_BINDING 0x85B5
+#endif
+
+namespace {
+
+// Both shaders follow the #version line of the context, see detect()
+const char* kVertexShader = R"raw(
+in vec2 aPos;
+
+void main()
+{
+  gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)raw";
+
+// Every texel of the target holds 4 bytes of the output row: one pixel in
+// RGBA8, part of one or two pixels in RGB8, 4 pixels in GRAY8. Output rows
+// start from the top of the picture, whichever way VLC rendered it.
+const char* kFragmentShader = R"raw(
+#ifdef GL_ES
+precision highp float;
+#endif
+
+out vec4 fragColor;
+
+uniform sampler2D source;
+// Output size in pixels
+uniform vec2 size;
+// Source coordinates of the output ones, origin + axes * output
+uniform vec2 origin;
+uniform vec2 axes;
+// Bytes per output pixel
+uniform float channels;
+
+vec4 pixel(float x, float y)
+{
+    vec2 position = vec2((x + 0.5) / size.x, (y + 0.5) / size.y);
+    // Base level only, the other ones are not generated yet
+    return texture(source, origin + axes * position, -16.0);
+}
+
+float byteAt(float index, float y)
+{
+    float x = floor((index + 0.5) / channels);
+    vec4 color = pixel(x, y);
+    if (channels == 1.0)
+        return dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+    float channel = index - x * channels;
+    return channel < 0.5 ? color.r : (channel < 1.5 ? color.g : color.b);
+}
+
+void main()
+{
+    float x = floor(gl_FragCoord.x);
+    float y = floor(gl_FragCoord.y);
+    if (channels == 4.0) {
+        fragColor = pixel(x, y);
+        return;
+    }
+    float index = x * 4.0;
+    fragColor = vec4(byteAt(index, y), byteAt(index + 1.0, y),
+                        byteAt(index + 2.0, y), byteAt(index + 3.0, y));
+}
+)raw";
+
+GLuint compileShader(GLenum type, const char* version, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    const char* sources[] = { version, source };
+    glShaderSource(shader, 2, sources, NULL);
+    glCompileShader(shader);
+    GLint success = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLchar log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        DEBUG("[Readback] failed to compile the shader: %s", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+unsigned bytesPerPixel(ReadbackFormat format)
+{
+    switch (format) {
+    case ReadbackFormat::RGB8: return 3;
+    case ReadbackFormat::GRAY8: return 1;
+    default: return 4;
+    }
+}
+
+}
+
+OpenGLReadback::OpenGLReadback(GLProcLoader loadProc, GLTexturePool& pool) :
+    m_load_proc(loadProc),
+    m_pool(pool)
+{
+}
+
+bool OpenGLReadback::request(unsigned width, unsigned height, ReadbackFormat format)
+{
+    if (m_support.load(std::memory_order_relaxed) == Support::Unsupported)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_requests.size() >= kSlots) {
+        DEBUG_VERBOSE("[Readback] too many requests pending");
+        return false;
+    }
+    m_requests.push_back({width, height, format});
+    return true;
+}
+
+bool OpenGLReadback::poll(ReadbackFrame* out)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    Slot* oldest = nullptr;
+    for (Slot& slot : m_slots) {
+        // The previous poll's data is given back now
+        if (slot.state == Slot::State::Held)
+            slot.state = Slot::State::Free;
+        if (slot.state == Slot::State::Ready && (!oldest || slot.sequence < oldest->sequence))
+            oldest = &slot;
+    }
+    if (!oldest)
+        return false;
+
+    oldest->state = Slot::State::Held;
+    *out = oldest->frame;
+    out->data = oldest->data.data();
+    return true;
+}
+
+bool OpenGLReadback::detect()
+{
+    bool es = false;
+    int major = 0, minor = 0;
+    bool supported = m_load_proc && glVersion(&es, &major, &minor);
+    if (supported) {
+        if (es)
+            supported = major >= 3;
+        else
+            supported = major > 3 || (major == 3 && (minor >= 2 || glHasExtension("GL_ARB_sync")));
+    }
+    if (supported) {
+        m_glFenceSync = reinterpret_cast<FenceSyncProc>(m_load_proc(nullptr, "glFenceSync"));
+        m_glClientWaitSync = reinterpret_cast<ClientWaitSyncProc>(m_load_proc(nullptr, "glClientWaitSync"));
+        m_glDeleteSync = reinterpret_cast<DeleteSyncProc>(m_load_proc(nullptr, "glDeleteSync"));
+        m_glMapBufferRange = reinterpret_cast<MapBufferRangeProc>(m_load_proc(nullptr, "glMapBufferRange"));
+        m_glUnmapBuffer = reinterpret_cast<UnmapBufferProc>(m_load_proc(nullptr, "glUnmapBuffer"));
+        m_glGenVertexArrays = reinterpret_cast<GenVertexArraysProc>(m_load_proc(nullptr, "glGenVertexArrays"));
+        m_glBindVertexArray = reinterpret_cast<BindVertexArrayProc>(m_load_proc(nullptr, "glBindVertexArray"));
+        m_glDeleteVertexArrays = reinterpret_cast<DeleteVertexArraysProc>(m_load_proc(nullptr, "glDeleteVertexArrays"));
+        supported = m_glFenceSync && m_glClientWaitSync && m_glDeleteSync &&
+                    m_glMapBufferRange && m_glUnmapBuffer && m_glGenVertexArrays &&
+                    m_glBindVertexArray && m_glDeleteVertexArrays;
+    }
+    // Core profiles reject unversioned shaders, all of these versions have
+    // in/out variables and texture()
+    if (es)
+        m_shader_version = "#version 300 es\n";
+    else if (major > 3 || minor >= 2)
+        m_shader_version = "#version 150 core\n";
+    else if (minor == 1)
+        m_shader_version = "#version 140\n";
+    else
+        m_shader_version = "#version 130\n";
+
+    DEBUG("[Readback] GL %s%d.%d, asynchronous readback %s", es ? "ES " : "", major, minor,
+          supported ? "supported" : "unsupported");
+    m_support.store(supported ? Support::Supported : Support::Unsupported, std::memory_order_relaxed);
+    return supported;
+}
+
+bool OpenGLReadback::setupProgram()
+{
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, m_shader_version, kVertexShader);
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, m_shader_version, kFragmentShader);
+    if (!vertex || !fragment) {
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return false;
+    }
+
+    m_program = glCreateProgram();
+    glAttachShader(m_program, vertex);
+    glAttachShader(m_program, fragment);
+    glLinkProgram(m_program);
+    // Not needed anymore once linked
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLchar log[1024];
+        glGetProgramInfoLog(m_program, sizeof(log), NULL, log);
+        DEBUG("[Readback] failed to link the program: %s", log);
+        glDeleteProgram(m_program);
+        m_program = 0;
+        return false;
+    }
+
+    m_pos_attrib = glGetAttribLocation(m_program, "aPos");
+    m_source_uniform = glGetUniformLocation(m_program, "source");
+    m_size_uniform = glGetUniformLocation(m_program, "size");
+    m_origin_uniform = glGetUniformLocation(m_program, "origin");
+    m_axes_uniform = glGetUniformLocation(m_program, "axes");
+    m_channels_uniform = glGetUniformLocation(m_program, "channels");
+
+    // Core profiles draw nothing without a vertex array object, this one
+    // keeps the quad layout so that draw() only binds it
+    static const float quad[] = { -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f };
+    GLint previous_vao = 0, previous_vbo = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previous_vbo);
+    m_glGenVertexArrays(1, &m_vao);
+    m_glBindVertexArray(m_vao);
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(m_pos_attrib);
+    glVertexAttribPointer(m_pos_attrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+    m_glBindVertexArray(previous_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, previous_vbo);
+    return true;
+}
+
+void OpenGLReadback::frameRendered(GLuint texture, unsigned width, unsigned height,
+                                   libvlc_video_orient_t orientation, const FrameInfo& info)
+{
+    if (m_support.load(std::memory_order_relaxed) == Support::Unsupported)
+        return;
+
+    Slot* claimed = nullptr;
+    Request request = {};
+    bool pending = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (Slot& slot : m_slots) {
+            if (slot.state == Slot::State::Pending)
+                pending = true;
+            else if (slot.state == Slot::State::Free && !claimed)
+                claimed = &slot;
+        }
+        if (m_requests.empty())
+            claimed = nullptr;
+        if (!claimed && !pending)
+            return;
+    }
+
+    if (m_support.load(std::memory_order_relaxed) == Support::Unknown && !detect()) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_requests.clear();
+        return;
+    }
+
+    GLint previous_pbo = 0;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previous_pbo);
+
+    collect();
+
+    if (claimed) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            request = m_requests.front();
+            m_requests.erase(m_requests.begin());
+            claimed->state = Slot::State::Pending;
+            claimed->sequence = ++m_sequence;
+        }
+        if (!readBack(*claimed, request, texture, width, height, orientation, info)) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            claimed->state = Slot::State::Free;
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, previous_pbo);
+}
+
+// VLC thread, maps the buffers the GPU is done with
+void OpenGLReadback::collect()
+{
+    // Pollers change the states of the other slots meanwhile, only the VLC
+    // thread moves slots out of Pending
+    Slot* pending[kSlots];
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (Slot& slot : m_slots) {
+            if (slot.state == Slot::State::Pending && slot.fence)
+                pending[count++] = &slot;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        Slot& slot = *pending[i];
+
+        GLenum status = m_glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            continue;
+        m_glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        bool copied = false;
+        if (status != GL_WAIT_FAILED) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            const size_t size = size_t(slot.frame.stride) * slot.frame.height;
+            const void* mapped = m_glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            if (mapped) {
+                slot.data.resize(size);
+                memcpy(slot.data.data(), mapped, size);
+                copied = m_glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+            }
+        }
+        if (!copied)
+            DEBUG("[Readback] failed to read back frame %llu",
+                  (unsigned long long)slot.frame.info.frame_number);
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        slot.state = copied ? Slot::State::Ready : Slot::State::Free;
+    }
+}
+
+bool OpenGLReadback::readBack(Slot& slot, const Request& request, GLuint texture,
+                              unsigned width, unsigned height,
+                              libvlc_video_orient_t orientation, const FrameInfo& info)
+{
+    Request scaled = request;
+    if (scaled.width == 0 || scaled.height == 0) {
+        scaled.width = width;
+        scaled.height = height;
+    }
+    if (!texture || scaled.width == 0 || scaled.height == 0)
+        return false;
+    if (!m_program && !setupProgram()) {
+        m_support.store(Support::Unsupported, std::memory_order_relaxed);
+        return false;
+    }
+
+    const unsigned packed_width = (scaled.width * bytesPerPixel(scaled.format) + 3) / 4;
+    GLRenderTarget target;
+    if (!m_pool.acquire(packed_width, scaled.height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 1,
+                        &target)) {
+        DEBUG("[Readback] failed to create a %ux%u target", packed_width, scaled.height);
+        return false;
+    }
+
+    GLint previous_fbo = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    draw(texture, packed_width, scaled, orientation);
+
+    const size_t stride = size_t(packed_width) * 4;
+    const size_t size = stride * scaled.height;
+    if (!slot.pbo)
+        glGenBuffers(1, &slot.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.pbo_size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        slot.pbo_size = size;
+    }
+    // Rows are a multiple of 4 bytes, the default pack alignment
+    glReadPixels(0, 0, packed_width, scaled.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    slot.fence = m_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo);
+    // Reused by the next readback of that size, after this one in the
+    // command stream
+    m_pool.release(target);
+    if (!slot.fence)
+        return false;
+
+    slot.frame.data = nullptr;
+    slot.frame.width = scaled.width;
+    slot.frame.height = scaled.height;
+    slot.frame.stride = static_cast<uint32_t>(stride);
+    slot.frame.format = static_cast<int32_t>(scaled.format);
+    slot.frame.info = info;
+    DEBUG_VERBOSE("[Readback] reading back frame %llu at %ux%u, format %d",
+                  (unsigned long long)info.frame_number, scaled.width, scaled.height,
+                  slot.frame.format);
+    return true;
+}
+
+// Draws into the bound framebuffer, restoring the state VLC may rely on
+void OpenGLReadback::draw(GLuint texture, unsigned packed_width, const Request& request,
+                          libvlc_video_orient_t orientation)
+{
+    GLint previous_program, previous_vao, previous_active_texture, previous_texture;
+    GLint previous_viewport[4];
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &previous_active_texture);
+    glGetIntegerv(GL_VIEWPORT, previous_viewport);
+    const GLboolean previous_blend = glIsEnabled(GL_BLEND);
+    const GLboolean previous_scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, packed_width, request.height);
+
+    // VLC rendered the picture transformed by its output orientation, the
+    // reverse transform gets it upright, from the top row
+    const bool mirrored = orientation == libvlc_video_orient_top_right ||
+                          orientation == libvlc_video_orient_bottom_right;
+    const bool upside_down = orientation == libvlc_video_orient_bottom_left ||
+                             orientation == libvlc_video_orient_bottom_right;
+    glUseProgram(m_program);
+    glUniform1i(m_source_uniform, 0);
+    glUniform2f(m_size_uniform, (float)request.width, (float)request.height);
+    glUniform2f(m_origin_uniform, mirrored ? 1.f : 0.f, upside_down ? 0.f : 1.f);
+    glUniform2f(m_axes_uniform, mirrored ? -1.f : 1.f, upside_down ? 1.f : -1.f);
+    glUniform1f(m_channels_uniform, (float)bytesPerPixel(request.format));
+
+    m_glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(previous_program);
+    m_glBindVertexArray(previous_vao);
+    glBindTexture(GL_TEXTURE_2D, previous_texture);
+    glActiveTexture(previous_active_texture);
+    if (previous_blend)
+        glEnable(GL_BLEND);
+    if (previous_scissor)
+        glEnable(GL_SCISSOR_TEST);
+    glViewport(previous_viewport[0], previous_viewport[1],
+               (GLsizei)previous_viewport[2], (GLsizei)previous_viewport[3]);
+}
+
+void OpenGLReadback::release()
+{
+    for (Slot& slot : m_slots) {
+        if (slot.fence)
+            m_glDeleteSync(slot.fence);
+        if (slot.pbo)
+            glDeleteBuffers(1, &slot.pbo);
+    }
+    if (m_vao)
+        m_glDeleteVertexArrays(1, &m_vao);
+    if (m_vbo)
+        glDeleteBuffers(1, &m_vbo);
+    if (m_program)
+        glDeleteProgram(m_program);
+    reset();
+}
+
+void OpenGLReadback::forget()
+{
+    reset();
+}
+
+void OpenGLReadback::reset()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (Slot& slot : m_slots) {
+        slot.fence = nullptr;
+        slot.pbo = 0;
+        slot.pbo_size = 0;
+        // Readbacks in flight are lost, completed ones can still be polled
+        if (slot.state == Slot::State::Pending)
+            slot.state = Slot::State::Free;
+    }
+    m_vao = 0;
+    m_vbo = 0;
+    m_program = 0;
+}
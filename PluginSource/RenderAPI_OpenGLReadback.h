@@ -0,0 +1,126 @@
+#ifndef RENDERAPI_OPENGLREADBACK_H
+#define RENDERAPI_OPENGLREADBACK_H
+
+#include "RenderAPI_OpenGLBase.h"
+#include "FrameReadback.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Copies of rendered frames to system memory, for consumers that process
+// the video on the CPU.
+//
+// In VLC's context, when a frame is published, a shader pass scales the
+// frame to the requested size, turns it top-down and packs it into RGBA
+// texels in the requested format. glReadPixels then copies it into a
+// pixel pack buffer with a fence. Later swaps map the buffers whose fence
+// signaled, without ever waiting on one, and pollers get their copy.
+//
+// Needs OpenGL 3.2 (or 3.0 with GL_ARB_sync) or OpenGL ES 3.0. Requests fail
+// once VLC's context turned out to lack them.
+class OpenGLReadback
+{
+public:
+    // Readbacks in flight or waiting for a poll
+    enum : size_t { kSlots = 4 };
+
+    OpenGLReadback(GLProcLoader loadProc, GLTexturePool& pool);
+    OpenGLReadback(const OpenGLReadback&) = delete;
+    OpenGLReadback& operator=(const OpenGLReadback&) = delete;
+
+    // Any thread
+    bool request(unsigned width, unsigned height, ReadbackFormat format);
+    bool poll(ReadbackFrame* out);
+
+    // VLC thread, VLC's context current. Reads back the frame rendered into
+    // texture when requested, orientation being the one VLC rendered it
+    // with, and hands over the readbacks completed since the last frame.
+    void frameRendered(GLuint texture, unsigned width, unsigned height,
+                       libvlc_video_orient_t orientation, const FrameInfo& info);
+    // Deletes the objects of VLC's context, completed readbacks are kept
+    void release();
+    // VLC's context went away along with the objects
+    void forget();
+
+private:
+    typedef void* SyncHandle;
+    typedef SyncHandle (*FenceSyncProc)(GLenum condition, GLbitfield flags);
+    typedef GLenum (*ClientWaitSyncProc)(SyncHandle sync, GLbitfield flags, uint64_t timeout);
+    typedef void (*DeleteSyncProc)(SyncHandle sync);
+    typedef void* (*MapBufferRangeProc)(GLenum target, GLintptr offset, GLsizeiptr length,
+                                        GLbitfield access);
+    typedef GLboolean (*UnmapBufferProc)(GLenum target);
+    typedef void (*GenVertexArraysProc)(GLsizei n, GLuint* arrays);
+    typedef void (*BindVertexArrayProc)(GLuint array);
+    typedef void (*DeleteVertexArraysProc)(GLsizei n, const GLuint* arrays);
+
+    struct Request
+    {
+        unsigned width;
+        unsigned height;
+        ReadbackFormat format;
+    };
+
+    struct Slot
+    {
+        // Free and Pending slots belong to the VLC thread, Ready and Held
+        // ones to the pollers
+        enum class State { Free, Pending, Ready, Held };
+        State state = State::Free;
+        // Order of the readbacks, oldest polled first
+        uint64_t sequence = 0;
+
+        GLuint pbo = 0;
+        size_t pbo_size = 0;
+        SyncHandle fence = nullptr;
+
+        std::vector<uint8_t> data;
+        ReadbackFrame frame;
+    };
+
+    bool detect();
+    bool setupProgram();
+    void collect();
+    bool readBack(Slot& slot, const Request& request, GLuint texture, unsigned width,
+                  unsigned height, libvlc_video_orient_t orientation, const FrameInfo& info);
+    void draw(GLuint texture, unsigned packed_width, const Request& request,
+              libvlc_video_orient_t orientation);
+    void reset();
+
+    GLProcLoader m_load_proc;
+    GLTexturePool& m_pool;
+
+    enum class Support { Unknown, Supported, Unsupported };
+    std::atomic<Support> m_support{Support::Unknown};
+
+    FenceSyncProc m_glFenceSync = nullptr;
+    ClientWaitSyncProc m_glClientWaitSync = nullptr;
+    DeleteSyncProc m_glDeleteSync = nullptr;
+    MapBufferRangeProc m_glMapBufferRange = nullptr;
+    UnmapBufferProc m_glUnmapBuffer = nullptr;
+    GenVertexArraysProc m_glGenVertexArrays = nullptr;
+    BindVertexArrayProc m_glBindVertexArray = nullptr;
+    DeleteVertexArraysProc m_glDeleteVertexArrays = nullptr;
+    // First line of the shaders, for the version of VLC's context
+    const char* m_shader_version = "";
+
+    // VLC thread
+    GLuint m_program = 0;
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+    GLint m_pos_attrib = -1;
+    GLint m_source_uniform = -1;
+    GLint m_size_uniform = -1;
+    GLint m_origin_uniform = -1;
+    GLint m_axes_uniform = -1;
+    GLint m_channels_uniform = -1;
+
+    // Requests and slot states, between the pollers and the VLC thread
+    std::mutex m_lock;
+    std::vector<Request> m_requests;
+    Slot m_slots[kSlots];
+    uint64_t m_sequence = 0;
+};
+
+#endif /* RENDERAPI_OPENGLREADBACK_H */
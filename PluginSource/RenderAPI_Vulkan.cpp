@@ -223,6 +223,7 @@ bool RenderAPI_Vulkan::setup(void **opaque, const libvlc_video_setup_device_cfg_
     auto *that = static_cast<RenderAPI_Vulkan*>(*opaque);
     that->width = 0;
     that->height = 0;
+    that->setVideoSize(0, 0);
 
     bool ret = true;
 
@@ -234,6 +235,8 @@ bool RenderAPI_Vulkan::setup(void **opaque, const libvlc_video_setup_device_cfg_
     that->makeCurrent(false);
 #endif
 
+    if (ret)
+        that->vlcOutputOpened();
     return ret;
 }
 
@@ -249,6 +252,7 @@ void RenderAPI_Vulkan::cleanup(void* opaque)
     that->watermark.cleanup();
 #endif
     that->makeCurrent(false);
+    that->vlcOutputClosed();
 }
 
 bool RenderAPI_Vulkan::resize(void* opaque, const libvlc_video_render_cfg_t *cfg,
@@ -262,6 +266,7 @@ bool RenderAPI_Vulkan::resize(void* opaque, const libvlc_video_render_cfg_t *cfg
         that->releaseHardwareBufferResources();
         that->width = cfg->width;
         that->height = cfg->height;
+        that->setVideoSize(cfg->width, cfg->height);
 
         // Make GL context current before creating GL resources
         if (!that->makeCurrent(true)) {
@@ -289,7 +294,7 @@ bool RenderAPI_Vulkan::resize(void* opaque, const libvlc_video_render_cfg_t *cfg
     output->transfer   = libvlc_video_transfer_func_SRGB;
     output->orientation = libvlc_video_orient_bottom_right;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, that->buffers[that->idx_render].fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->buffers.renderSlot().fbo);
     return true;
 }
 
@@ -297,7 +302,6 @@ void RenderAPI_Vulkan::swap(void* opaque)
 {
     DEBUG_VERBOSE("[Vulkan] swap callback");
     RenderAPI_Vulkan* that = reinterpret_cast<RenderAPI_Vulkan*>(opaque);
-    std::lock_guard<std::mutex> lock(that->text_lock);
 
 #if defined(SHOW_WATERMARK)
     bool isPaused = libvlc_unity_trial_is_paused();
@@ -310,13 +314,14 @@ void RenderAPI_Vulkan::swap(void* opaque)
         libvlc_media_player_stop_async(that->m_mp);
         return;
     }
-    that->watermark.draw(that->buffers[that->idx_render].fbo, that->width, that->height);
+    that->watermark.draw(that->buffers.renderSlot().fbo, that->width, that->height);
 #endif
 
-    that->updated = true;
     glFlush();
-    std::swap(that->idx_swap, that->idx_render);
-    glBindFramebuffer(GL_FRAMEBUFFER, that->buffers[that->idx_render].fbo);
+    that->m_stats.frameRendered();
+    if (that->buffers.publish())
+        that->m_stats.framesDropped(1);
+    glBindFramebuffer(GL_FRAMEBUFFER, that->buffers.renderSlot().fbo);
     DEBUG_VERBOSE("[Vulkan] swap callback complete");
 }
 
@@ -598,17 +603,14 @@ void* RenderAPI_Vulkan::getVideoFrame(unsigned width, unsigned height, bool* out
 
     DEBUG_VERBOSE("[Vulkan] === getVideoFrame called ===");
     DEBUG_VERBOSE("[Vulkan]   Current thread ID: %ld", (long)pthread_self());
-    DEBUG_VERBOSE("[Vulkan]   Updated flag: %s", updated ? "TRUE" : "FALSE");
+    DEBUG_VERBOSE("[Vulkan]   Updated flag: %s", buffers.hasFresh() ? "TRUE" : "FALSE");
     DEBUG_VERBOSE("[Vulkan]   Unity texture ptr: %p", m_unity_texture_ptr);
-    DEBUG_VERBOSE("[Vulkan]   idx_display: %zu, idx_swap: %zu, idx_render: %zu", idx_display, idx_swap, idx_render);
-
-    std::lock_guard<std::mutex> lock(text_lock);
-
-    if (out_updated)
-        *out_updated = updated;
+    DEBUG_VERBOSE("[Vulkan]   idx_display: %zu", buffers.displayIndex());
 
     // Check if buffers are initialized (resize was called)
-    if (buffers[idx_display].vk_image_external == VK_NULL_HANDLE) {
+    if (buffers.displaySlot().vk_image_external == VK_NULL_HANDLE) {
+        if (out_updated)
+            *out_updated = buffers.hasFresh();
         DEBUG("[Vulkan] Buffers not initialized yet, returning nullptr");
         return nullptr;
     }
@@ -620,20 +622,21 @@ void* RenderAPI_Vulkan::getVideoFrame(unsigned width, unsigned height, bool* out
               i, buffers[i].a_hardware_buffer, buffers[i].vk_image_external, buffers[i].gl_texture);
     }
 
+    bool updated = buffers.acquire();
+    if (out_updated)
+        *out_updated = updated;
+
     if (updated) {
+        m_stats.framePresented();
         DEBUG_VERBOSE("[Vulkan] Frame updated");
-        std::swap(idx_swap, idx_display);
-        DEBUG_VERBOSE("[Vulkan] After swap: idx_display=%zu, idx_swap=%zu", idx_display, idx_swap);
-        updated = false;
+        DEBUG_VERBOSE("[Vulkan] After acquire: idx_display=%zu", buffers.displayIndex());
 
         // Schedule copy for render thread
         DEBUG_VERBOSE("[Vulkan] Scheduling texture copy for render thread");
-        DEBUG_VERBOSE("[Vulkan]   Using buffer[%zu]", idx_display);
-        DEBUG_VERBOSE("[Vulkan]   Buffer VK external image: %p", buffers[idx_display].vk_image_external);
+        DEBUG_VERBOSE("[Vulkan]   Buffer VK external image: %p", buffers.displaySlot().vk_image_external);
 
         // Store which buffer to copy in the render event
-        m_pending_copy_buffer_idx = idx_display;
-        m_has_pending_copy = true;
+        m_pending_copy_buffer_idx.store((int)buffers.displayIndex(), std::memory_order_release);
 
         DEBUG_VERBOSE("[Vulkan] Copy scheduled, will be executed on render thread");
     }
@@ -919,21 +922,20 @@ void RenderAPI_Vulkan::onRenderEvent()
 {
     DEBUG_VERBOSE("[Vulkan] === onRenderEvent: Entry ===");
     DEBUG_VERBOSE("[Vulkan]   Current thread ID: %ld", (long)pthread_self());
-    DEBUG_VERBOSE("[Vulkan]   m_has_pending_copy: %s", m_has_pending_copy ? "TRUE" : "FALSE");
-
-    std::lock_guard<std::mutex> lock(text_lock);
+    int pending_idx = m_pending_copy_buffer_idx.exchange(-1, std::memory_order_acq_rel);
+    DEBUG_VERBOSE("[Vulkan]   pending copy: %s", pending_idx >= 0 ? "TRUE" : "FALSE");
 
-    if (!m_has_pending_copy) {
+    if (pending_idx < 0) {
         DEBUG_VERBOSE("[Vulkan] === onRenderEvent: No pending copy, returning ===");
         return; // Nothing to do
     }
 
     DEBUG_VERBOSE("[Vulkan] === onRenderEvent: Processing pending copy ===");
-    DEBUG_VERBOSE("[Vulkan]   Buffer index: %zu", m_pending_copy_buffer_idx);
+    DEBUG_VERBOSE("[Vulkan]   Buffer index: %d", pending_idx);
     DEBUG_VERBOSE("[Vulkan]   Unity texture ptr: %p", m_unity_texture_ptr);
     DEBUG_VERBOSE("[Vulkan]   VK graphics interface: %p", m_vk_graphics);
 
-    bool copySuccess = copyToUnityTexture(buffers[m_pending_copy_buffer_idx]);
+    bool copySuccess = copyToUnityTexture(buffers[pending_idx]);
 
     if (copySuccess) {
         DEBUG_VERBOSE("[Vulkan] Render event: Copy succeeded");
@@ -941,7 +943,6 @@ void RenderAPI_Vulkan::onRenderEvent()
         DEBUG("[Vulkan] Render event: Copy failed, will retry next frame");
     }
 
-    m_has_pending_copy = false;
     DEBUG_VERBOSE("[Vulkan] === onRenderEvent: Complete ===");
 }
 
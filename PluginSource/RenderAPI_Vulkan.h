@@ -26,7 +26,8 @@
 #include <vulkan/vulkan.h>
 
 #include "Unity/IUnityGraphicsVulkan.h"
-#include <mutex>
+#include "TripleBuffer.h"
+#include <atomic>
 
 // ============================================================
 // Vulkan Debug/Validation Configuration
@@ -83,6 +84,15 @@ public:
     void ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) override;
     void* getVideoFrame(unsigned width, unsigned height, bool* out_updated) override;
 
+    // VLC renders into buffers of its own orientation that Unity copies
+    // itself, none of the GL output features apply
+    bool setOrientation(bool, bool) override { return false; }
+    bool setTargetTexture(void*, unsigned, unsigned) override { return false; }
+    bool setMipmaps(bool) override { return false; }
+    bool requestReadback(unsigned, unsigned, int) override { return false; }
+    // No GL context on the render thread, the copy is done by onRenderEvent
+    void performRenderThreadWork() override {}
+
     // Vulkan-specific: Set Unity-created texture to update via AccessTexture
     bool setUnityTexture(void* unityTexturePtr);
 
@@ -118,20 +128,14 @@ private:
     // Track if Vulkan image layout has been initialized
     bool m_vulkan_image_layout_initialized = false;
 
-    // Pending copy state (for render thread)
-    size_t m_pending_copy_buffer_idx = 0;
-    bool m_has_pending_copy = false;
+    // Pending copy state (for render thread): buffer index, or -1 if none
+    std::atomic<int> m_pending_copy_buffer_idx{-1};
 
     // Triple buffering
-    RenderAPIHardwareBuffer buffers[3];
+    TripleBuffer<RenderAPIHardwareBuffer> buffers;
 
-    std::mutex text_lock;
     unsigned width = 0;
     unsigned height = 0;
-    size_t idx_render = 0;
-    size_t idx_swap = 1;
-    size_t idx_display = 2;
-    bool updated = false;
 
     // EGL/GLES extension function pointers
     PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC eglGetNativeClientBufferANDROID = nullptr;
@@ -1,10 +1,11 @@
 #include "PlatformBase.h"
 #include "RenderAPI.h"
 #include "Log.h"
+#include "PlayerRegistry.h"
 
-#include <map>
 #include <atomic>
 #include <chrono>
+#include <vector>
 
 #if defined(SHOW_WATERMARK)
 static std::atomic<int64_t> g_trialAccumulatedMs{0};
@@ -22,6 +23,15 @@ static const int64_t TRIAL_TIME_LIMIT_MS = 60 * 1000;
 #include "RenderAPI_Vulkan.h"
 #endif
 
+#if defined(UNITY_LINUX) || defined(UNITY_ANDROID)
+#include "RenderAPI_OpenGLBase.h"
+#endif
+
+#if defined(UNITY_LINUX)
+#include "LinuxBackendProbe.h"
+#include "LinuxDMABufPool.h"
+#endif
+
 extern "C" {
 #include <stdlib.h>
 #if !defined(_WIN32)
@@ -70,8 +80,54 @@ static void on_media_player_playing(const libvlc_event_t* event, void* data)
 }
 #endif
 
+// Keep each backend's MediaClock and cached player state in sync with the
+// player, so that frames can be stamped with the media time from the vout
+// thread and polled without going through the player's lock.
+static void on_player_event(const libvlc_event_t* event, void* data)
+{
+    RenderAPI* api = static_cast<RenderAPI*>(data);
+    MediaClock& clock = api->mediaClock();
+    switch (event->type)
+    {
+    case libvlc_MediaPlayerTimeChanged:
+        clock.setTime(event->u.media_player_time_changed.new_time, libvlc_clock());
+        break;
+    case libvlc_MediaPlayerOpening:
+        api->setPlayerState(libvlc_Opening);
+        break;
+    case libvlc_MediaPlayerPlaying:
+        clock.setPlaying(true);
+        api->setPlayerState(libvlc_Playing);
+        break;
+    case libvlc_MediaPlayerPaused:
+        clock.setPlaying(false);
+        api->setPlayerState(libvlc_Paused);
+        break;
+    case libvlc_MediaPlayerStopping:
+        api->setPlayerState(libvlc_Stopping);
+        break;
+    case libvlc_MediaPlayerStopped:
+        clock.reset();
+        api->setPlayerState(libvlc_Stopped);
+        break;
+    case libvlc_MediaPlayerEncounteredError:
+        api->setPlayerState(libvlc_Error);
+        break;
+    }
+}
+
+static const int player_events[] = {
+    libvlc_MediaPlayerTimeChanged,
+    libvlc_MediaPlayerOpening,
+    libvlc_MediaPlayerPlaying,
+    libvlc_MediaPlayerPaused,
+    libvlc_MediaPlayerStopping,
+    libvlc_MediaPlayerStopped,
+    libvlc_MediaPlayerEncounteredError,
+};
+
 static IUnityGraphics* s_Graphics = NULL;
-static std::map<libvlc_media_player_t*,RenderAPI*> contexts = {};
+static PlayerRegistry players;
 static IUnityInterfaces* s_UnityInterfaces = NULL;
 
 static int s_color_space;
@@ -145,19 +201,48 @@ libvlc_unity_set_color_space(int color_space)
     s_color_space = color_space;
 }
 
+// Sets the level of a log category (0 core, 1 GLX, 2 EGL, 3 DMA-BUF, or -1 for
+// all of them) from -1 (off) to 4 (verbose). Defaults to 2 (info).
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_log_level(int category, int level)
+{
+    if(level < static_cast<int>(LogLevel::Off) || level > static_cast<int>(LogLevel::Verbose))
+        return;
+    if(category < 0)
+        category = static_cast<int>(LogCategory::Count);
+    log_set_level(static_cast<LogCategory>(category), static_cast<LogLevel>(level));
+}
+
+// Sends the plugin's log messages to cb instead of stderr/logcat/the debugger.
+// cb is called from the plugin's logging thread; NULL restores the default.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_log_callback(log_sink_cb cb, void* opaque)
+{
+    log_set_sink(cb, opaque);
+}
+
+// Output precision of the player: 8, 10 (Linux only) or 16 bits per channel.
+// 16 bits is UNORM on D3D11 and half float on Linux. Applies from the next
+// output resize.
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
 libvlc_unity_set_bit_depth_format(libvlc_media_player_t* mp, int bit_depth)
 {
-#if !defined(SUPPORT_D3D11)
+#if !defined(SUPPORT_D3D11) && !defined(UNITY_LINUX)
     return;
 #endif
     if(mp == NULL)
         return;
 
-    if(bit_depth != 8 /* && bit_depth != 10 */ && bit_depth != 16)
+#if defined(UNITY_LINUX)
+    if(bit_depth != 8 && bit_depth != 10 && bit_depth != 16)
         return;
+#else
+    if(bit_depth != 8 && bit_depth != 16)
+        return;
+#endif
 
-    RenderAPI* s_CurrentAPI = contexts.find(mp)->second;
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
     if(!s_CurrentAPI)
     {
         return;
@@ -166,6 +251,162 @@ libvlc_unity_set_bit_depth_format(libvlc_media_player_t* mp, int bit_depth)
     s_CurrentAPI->setbitDepthFormat(bit_depth);
 }
 
+// Sets how many frame slots (2 to 8) sit between VLC and Unity for this player
+// and how they are presented: 0 for mailbox (latest frame wins), 1 for FIFO
+// (every frame is shown, VLC waits when Unity falls behind). Takes effect
+// the next time the video output is configured, so call it before playing.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_frame_queue(libvlc_media_player_t* mp, unsigned slots, int mode)
+{
+    if(mp == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+    {
+        DEBUG("Error, no Render API for this media player");
+        return false;
+    }
+
+    return s_CurrentAPI->setFrameQueue(slots, mode);
+}
+
+// Mirrors the video of this player in VLC's own render pass instead of when
+// displaying its texture. Takes effect the next time the video output is
+// configured, so call it before playing. OpenGL backends only.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_orientation(libvlc_media_player_t* mp, bool flip_x, bool flip_y)
+{
+    if(mp == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+        return false;
+
+    return s_CurrentAPI->setOrientation(flip_x, flip_y);
+}
+
+// Makes the textures of this player mip-complete, their chain generated by its
+// render event for every frame acquired, for textures sampled minified. Takes
+// effect the next time the video output is configured, so call it before
+// playing. Returns false when the backend cannot (Linux DMA-BUF buffers).
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_mipmaps(libvlc_media_player_t* mp, bool enabled)
+{
+    if(mp == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+        return false;
+
+    return s_CurrentAPI->setMipmaps(enabled);
+}
+
+// Registers a texture of Unity's (the native pointer of a RenderTexture, of
+// the given size) that the render event of this player fills with each new
+// frame, so that it needs no Blit on Unity's side. The frame is still copied
+// once, by glCopyTexSubImage2D in the render event. NULL unregisters it.
+// OpenGL backends only, see libvlc_unity_set_unity_texture_vulkan for Vulkan.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_target_texture(libvlc_media_player_t* mp, void* texture, unsigned width, unsigned height)
+{
+    if(mp == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+        return false;
+
+    return s_CurrentAPI->setTargetTexture(texture, width, height);
+}
+
+// Asks for the next frame VLC renders for this player to be copied to system
+// memory, scaled on the GPU to width x height (0x0 keeps the video size) and
+// converted to format: 0 for RGBA8, 1 for RGB8, 2 for GRAY8 (BT.709 luma).
+// Up to 4 requests can be queued. Never stalls VLC nor Unity, the copy is
+// returned by libvlc_unity_poll_readback a few frames later. OpenGL backends
+// only, with OpenGL 3.2 or OpenGL ES 3.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_request_readback(libvlc_media_player_t* mp, unsigned width, unsigned height, int format)
+{
+    if(mp == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+        return false;
+
+    return s_CurrentAPI->requestReadback(width, height, format);
+}
+
+// Takes the oldest completed readback of this player, false when none is
+// ready yet. frame->data holds the rows from the top of the picture, and
+// stays valid until the next call for the same player or until the player is
+// released.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_poll_readback(libvlc_media_player_t* mp, ReadbackFrame* frame)
+{
+    if(mp == NULL || frame == NULL)
+        return false;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if(!s_CurrentAPI)
+        return false;
+
+    return s_CurrentAPI->pollReadback(frame);
+}
+
+// Sets how many bytes of frame buffers released by players are kept for reuse
+// by the next resize: by any player for the Linux DMA-BUF buffers (256 MiB by
+// default), by the same player for the OpenGL render targets (128 MiB by
+// default). The least recently used are freed first past the limit, 0 frees
+// them all.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_buffer_pool_limit(uint64_t bytes)
+{
+#if defined(UNITY_LINUX)
+    LinuxDMABufPool::instance().setIdleLimit(bytes);
+#endif
+#if defined(UNITY_LINUX) || defined(UNITY_ANDROID)
+    GLTexturePool::setIdleLimit(bytes);
+#else
+    (void)bytes;
+#endif
+}
+
+// Forces how frames reach Unity on Linux for the players created from now on:
+// 0 GLX share group, 1 GLX DMA-BUF, 2 EGL DMA-BUF, 3 CPU upload, or -1 for
+// the backend measured at startup. Returns false when unsupported.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_set_linux_backend(int backend)
+{
+#if defined(UNITY_LINUX)
+    return LinuxBackendProbe::instance().setOverride(backend);
+#else
+    (void)backend;
+    return false;
+#endif
+}
+
+// Backend the next players get on Linux, -1 on other platforms
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_get_linux_backend()
+{
+#if defined(UNITY_LINUX)
+    return static_cast<int>(LinuxBackendProbe::instance().selected());
+#else
+    return -1;
+#endif
+}
+
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Print(char* toPrint)
 {
     DEBUG("%s", toPrint);
@@ -228,7 +469,16 @@ libvlc_unity_media_player_new(libvlc_instance_t* libvlc)
     DEBUG("Calling... setVlcContext s_CurrentAPI=%p mp=%p", s_CurrentAPI, mp);
     s_CurrentAPI->setVlcContext(mp);
 
-    contexts[mp] = s_CurrentAPI;
+    players.add(mp, s_CurrentAPI);
+
+    {
+        libvlc_event_manager_t* em = libvlc_media_player_event_manager(mp);
+        if (em)
+        {
+            for (int event : player_events)
+                libvlc_event_attach(em, event, on_player_event, s_CurrentAPI);
+        }
+    }
 
 #if defined(SHOW_WATERMARK)
     {
@@ -273,16 +523,28 @@ libvlc_unity_media_player_release(libvlc_media_player_t* mp)
     }
 #endif
 
-    RenderAPI* s_CurrentAPI = contexts.find(mp)->second;
+    // Unlinked first so that the render thread stops servicing it, deleted
+    // only once no reader is left and VLC's video output, which may outlive
+    // this call when VLC still holds the player, has been cleaned up.
+    RenderAPI* s_CurrentAPI = players.remove(mp);
 
     if(s_CurrentAPI == NULL)
         return;
 
-    s_CurrentAPI->unsetVlcContext(mp);
+    {
+        libvlc_event_manager_t* em = libvlc_media_player_event_manager(mp);
+        if (em)
+        {
+            for (int event : player_events)
+                libvlc_event_detach(em, event, on_player_event, s_CurrentAPI);
+        }
+    }
 
-    contexts.erase(mp);
+    s_CurrentAPI->unsetVlcContext(mp);
 
     libvlc_media_player_release(mp);
+
+    players.retire(s_CurrentAPI);
 }
 
 extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
@@ -305,7 +567,12 @@ libvlc_unity_get_texture(libvlc_media_player_t* mp, unsigned width, unsigned hei
     if(width == 0 && height == 0)
         return NULL;
 
-    RenderAPI* s_CurrentAPI = contexts.find(mp)->second;
+    // Released players are reclaimed lazily, this runs once per player and
+    // frame and is a single relaxed load when there is nothing to free.
+    players.collect();
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
 
     if (!s_CurrentAPI) {
         DEBUG("Error, no Render API");
@@ -317,6 +584,134 @@ libvlc_unity_get_texture(libvlc_media_player_t* mp, unsigned width, unsigned hei
     return s_CurrentAPI->getVideoFrame(width, height, updated);
 }
 
+// Copies the player's performance counters into *stats. The caller sets
+// stats->size to sizeof(PlayerStatsSnapshot) as it knows it; on return it holds
+// the number of bytes actually filled in.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_get_player_stats(libvlc_media_player_t* mp, PlayerStatsSnapshot* stats)
+{
+    if(mp == NULL || stats == NULL)
+        return false;
+
+    if(stats->size < offsetof(PlayerStatsSnapshot, frames_rendered))
+    {
+        DEBUG("libvlc_unity_get_player_stats: invalid struct size %u", stats->size);
+        return false;
+    }
+
+    PlayerStatsSnapshot snapshot;
+    {
+        PlayerRegistry::ReadGuard guard(players);
+        RenderAPI* s_CurrentAPI = guard.find(mp);
+        if(!s_CurrentAPI)
+            return false;
+        s_CurrentAPI->stats().snapshot(snapshot);
+    }
+
+    uint32_t size = stats->size < snapshot.size ? stats->size : snapshot.size;
+    memcpy(stats, &snapshot, size);
+    stats->size = size;
+    return true;
+}
+
+// Same as libvlc_unity_get_texture, also returning the frame number, VLC-side
+// swap time and media time of the frame the texture currently holds. info is
+// reset (frame_number 0) when the backend does not track them.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_get_texture_ex(libvlc_media_player_t* mp, unsigned width, unsigned height, bool * updated, FrameInfo* info)
+{
+    void* texture = libvlc_unity_get_texture(mp, width, height, updated);
+
+    if (info == NULL)
+        return texture;
+    *info = FrameInfo();
+    if (texture == NULL)
+        return texture;
+
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
+    if (s_CurrentAPI)
+        s_CurrentAPI->getFrameInfo(info);
+    return texture;
+}
+
+// Per-player entry of libvlc_unity_poll_frames. Layout is part of the plugin
+// ABI.
+struct PlayerFrameState
+{
+    // In: size the texture is displayed at, as passed to
+    // libvlc_unity_get_texture. 0x0 only reports the state, without acquiring
+    // a frame.
+    uint32_t request_width;
+    uint32_t request_height;
+    // Out: size VLC renders at, 0x0 until the video output is configured.
+    uint32_t width;
+    uint32_t height;
+    // Out: texture holding the latest frame, NULL if none.
+    void* texture;
+    // Out: number of that frame, 0 when the backend does not track it.
+    uint64_t frame_number;
+    // Out: last libvlc_state_t reported by the player.
+    int32_t state;
+    // Out: whether a new frame was acquired by this call.
+    uint8_t updated;
+    uint8_t reserved[3];
+};
+
+// Same as calling libvlc_unity_get_texture_ex for each player, along with
+// its video size and state, in a single call. Only reads what the plugin
+// caches from the player events and the video output callbacks, so unlike
+// libvlc_unity_get_texture it never takes the player's lock. Unknown or NULL
+// players report a NothingSpecial state and no texture.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_poll_frames(libvlc_media_player_t** media_players, unsigned count, PlayerFrameState* states)
+{
+    if(media_players == NULL || states == NULL)
+        return;
+
+    players.collect();
+
+#if defined(SHOW_WATERMARK)
+    const bool trialStopped = libvlc_unity_trial_is_stopped();
+#endif
+
+    PlayerRegistry::ReadGuard guard(players);
+    for(unsigned i = 0; i < count; i++)
+    {
+        PlayerFrameState& state = states[i];
+        state.width = state.height = 0;
+        state.texture = NULL;
+        state.frame_number = 0;
+        state.state = libvlc_NothingSpecial;
+        state.updated = false;
+
+        RenderAPI* s_CurrentAPI = media_players[i] ? guard.find(media_players[i]) : NULL;
+        if(!s_CurrentAPI)
+            continue;
+
+        s_CurrentAPI->videoSize(&state.width, &state.height);
+        state.state = s_CurrentAPI->playerState();
+
+#if defined(SHOW_WATERMARK)
+        if(state.state != libvlc_Playing && !trialStopped)
+            continue;
+#else
+        if(state.state != libvlc_Playing)
+            continue;
+#endif
+        if(state.request_width == 0 && state.request_height == 0)
+            continue;
+
+        bool updated = false;
+        state.texture = s_CurrentAPI->getVideoFrame(state.request_width, state.request_height, &updated);
+        state.updated = updated;
+
+        FrameInfo info;
+        if(state.texture && s_CurrentAPI->getFrameInfo(&info))
+            state.frame_number = info.frame_number;
+    }
+}
+
 extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
 libvlc_unity_set_unity_texture_vulkan(libvlc_media_player_t* mp, void* unityTexturePtr)
 {
@@ -326,13 +721,8 @@ libvlc_unity_set_unity_texture_vulkan(libvlc_media_player_t* mp, void* unityText
         return false;
     }
 
-    auto it = contexts.find(mp);
-    if(it == contexts.end()) {
-        DEBUG("libvlc_unity_set_unity_texture_vulkan: no context found for mp");
-        return false;
-    }
-
-    RenderAPI* s_CurrentAPI = it->second;
+    PlayerRegistry::ReadGuard guard(players);
+    RenderAPI* s_CurrentAPI = guard.find(mp);
     if (!s_CurrentAPI) {
         DEBUG("libvlc_unity_set_unity_texture_vulkan: s_CurrentAPI is NULL");
         return false;
@@ -367,6 +757,12 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCUnity_UnityPluginL
     InitializeVulkanValidation(unityInterfaces);
 #endif
 
+#if defined(UNITY_LINUX)
+    // Picks the backend of the players, from the cache or by measuring them
+    // once Unity's context can be used
+    LinuxBackendProbe::instance().load(s_Graphics->GetRenderer());
+#endif
+
     // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
     OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
 }
@@ -379,6 +775,7 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnit
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCUnity_UnityPluginUnload()
 {
   s_Graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+  log_shutdown();
 }
 
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
@@ -416,11 +813,10 @@ static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType ev
     }
 
     // Let the implementation process the device related events
-    std::map<libvlc_media_player_t*, RenderAPI*>::iterator it;
-
-    for(it = contexts.begin(); it != contexts.end(); it++)
+    PlayerRegistry::ReadGuard guard(players);
+    for(const auto& player : guard)
     {
-        RenderAPI* currentAPI = it->second;
+        RenderAPI* currentAPI = player.api;
         if(currentAPI) {
             DEBUG(" currentAPI->ProcessDeviceEvent(eventType, s_UnityInterfaces); \n");
             currentAPI->ProcessDeviceEvent(eventType, s_UnityInterfaces);
@@ -428,69 +824,109 @@ static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType ev
     }
 }
 
-static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
+// Render-thread work of a single player: finish setting up its backend once
+// Unity's context is known (Linux), import new buffers into Unity's context
+// (Linux DMA-BUF) and copy the latest frame into the Unity texture (Android
+// Vulkan).
+static void servicePlayer(RenderAPI* currentAPI)
 {
-#if !defined(_WIN32)
-    DEBUG("[VLC-Unity] OnRenderEvent called with eventID=%d, thread=%ld\n", eventID, (long)pthread_self());
-#else
-    DEBUG("[VLC-Unity] OnRenderEvent called with eventID=%d\n", eventID);
+    if(!currentAPI)
+        return;
+
+#if defined(UNITY_LINUX)
+    if(!currentAPI->isInitialized())
+        currentAPI->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, s_UnityInterfaces);
 #endif
-    DEBUG("[VLC-Unity]   s_DeviceType=%s\n", GetRendererName(s_DeviceType));
-    DEBUG("[VLC-Unity]   contexts.size()=%zu\n", contexts.size());
+    currentAPI->performRenderThreadWork();
 
+#if defined(UNITY_ANDROID) && defined(SUPPORT_VULKAN)
+    if(s_DeviceType == kUnityGfxRendererVulkan) {
+        // Cast to Vulkan API and call onRenderEvent
+        RenderAPI_Vulkan* vulkanAPI = static_cast<RenderAPI_Vulkan*>(currentAPI);
+        vulkanAPI->onRenderEvent();
+    }
+#endif
+}
+
+static void retrieveUnityContext()
+{
 #if defined(UNITY_ANDROID) || defined(UNITY_LINUX)
     if(EarlyRenderAPI)
-    {
-        DEBUG("[VLC-Unity]   Calling EarlyRenderAPI->retrieveOpenGLContext()\n");
         EarlyRenderAPI->retrieveOpenGLContext();
-    }
 #endif
-
 #if defined(UNITY_LINUX)
-    {
-        std::map<libvlc_media_player_t*, RenderAPI*>::iterator it;
-        for(it = contexts.begin(); it != contexts.end(); it++)
-        {
-            RenderAPI* currentAPI = it->second;
-            if(currentAPI && !currentAPI->isInitialized())
-                currentAPI->ProcessDeviceEvent(kUnityGfxDeviceEventInitialize, s_UnityInterfaces);
-        }
-    }
+    LinuxBackendProbe::instance().probeOnce(s_DeviceType);
+#endif
+}
 
-    // Perform render-thread work (e.g. DMA-BUF texture import) for all active contexts
-    {
-        std::map<libvlc_media_player_t*, RenderAPI*>::iterator it;
-        for(it = contexts.begin(); it != contexts.end(); it++)
-        {
-            RenderAPI* currentAPI = it->second;
-            if(currentAPI)
-                currentAPI->performRenderThreadWork();
-        }
-    }
+// Services every player. Kept for GL.IssuePluginEvent callers, eventID is
+// ignored; prefer the targeted events below, which cost O(1) per player.
+static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
+{
+#if !defined(_WIN32)
+    DEBUG_VERBOSE("[VLC-Unity] OnRenderEvent called with eventID=%d, thread=%ld\n", eventID, (long)pthread_self());
+#else
+    DEBUG_VERBOSE("[VLC-Unity] OnRenderEvent called with eventID=%d\n", eventID);
 #endif
+    (void)eventID;
+    DEBUG_VERBOSE("[VLC-Unity]   s_DeviceType=%s\n", GetRendererName(s_DeviceType));
 
-#if defined(UNITY_ANDROID)
-    // Call render event for all active contexts
-    std::map<libvlc_media_player_t*, RenderAPI*>::iterator it;
-    for(it = contexts.begin(); it != contexts.end(); it++)
-    {
-        RenderAPI* currentAPI = it->second;
-        DEBUG("[VLC-Unity]   Processing context: mp=%p, api=%p\n", it->first, currentAPI);
+    PlayerRegistry::ReadGuard guard(players);
+    DEBUG_VERBOSE("[VLC-Unity]   players=%zu\n", guard.size());
 
-#if defined(SUPPORT_VULKAN)
-        if(currentAPI && s_DeviceType == kUnityGfxRendererVulkan) {
-            DEBUG("[VLC-Unity]   Calling onRenderEvent for Vulkan API\n");
-            // Cast to Vulkan API and call onRenderEvent
-            RenderAPI_Vulkan* vulkanAPI = static_cast<RenderAPI_Vulkan*>(currentAPI);
-            vulkanAPI->onRenderEvent();
-        } else
-#endif
+    retrieveUnityContext();
+
+    for(const auto& player : guard)
+        servicePlayer(player.api);
+}
+
+// Operation codes of the render event returned by GetRenderEventAndDataFunc,
+// mirrored by RenderEventOp in TextureHelper.cs.
+enum RenderEventOp
+{
+    // data is a libvlc_media_player_t*: service that player only.
+    kRenderEventPlayer = 1,
+    // data is a batch from libvlc_unity_render_batch_new: service each of its
+    // players, then free it.
+    kRenderEventBatch = 2,
+};
+
+struct RenderEventBatch
+{
+    std::vector<libvlc_media_player_t*> players;
+};
+
+static void UNITY_INTERFACE_API OnRenderEventAndData(int eventID, void* data)
+{
+    retrieveUnityContext();
+
+    switch(eventID)
+    {
+    case kRenderEventPlayer:
+    {
+        // The player may have been released since the event was issued, in
+        // which case it is simply not found.
+        PlayerRegistry::ReadGuard guard(players);
+        servicePlayer(guard.find(static_cast<libvlc_media_player_t*>(data)));
+        break;
+    }
+    case kRenderEventBatch:
+    {
+        RenderEventBatch* batch = static_cast<RenderEventBatch*>(data);
+        if(!batch)
+            break;
         {
-            DEBUG("[VLC-Unity]   Skipping: currentAPI=%p, s_DeviceType=%s\n", currentAPI, GetRendererName(s_DeviceType));
+            PlayerRegistry::ReadGuard guard(players);
+            for(libvlc_media_player_t* mp : batch->players)
+                servicePlayer(guard.find(mp));
         }
+        delete batch;
+        break;
+    }
+    default:
+        DEBUG("[VLC-Unity] OnRenderEventAndData: unknown operation %d\n", eventID);
+        break;
     }
-    DEBUG("[VLC-Unity] OnRenderEvent complete\n");
-#endif
 }
 
 #if defined(SHOW_WATERMARK)
@@ -569,3 +1005,25 @@ extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRen
     DEBUG("[VLC-Unity] GetRenderEventFunc called, returning %p\n", (void*)OnRenderEvent);
     return OnRenderEvent;
 }
+
+// Render event carrying a player handle (or batch) and an operation code, for
+// GL.IssuePluginEventAndData, see RenderEventOp.
+extern "C" UnityRenderingEventAndData UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventAndDataFunc()
+{
+    return OnRenderEventAndData;
+}
+
+// Copies mps[0..count) into a batch to pass as the data of a
+// kRenderEventBatch render event, which frees it once serviced. The copy lets
+// the caller reuse its array right away, while the render thread may only
+// run the event a frame later.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API
+libvlc_unity_render_batch_new(libvlc_media_player_t** mps, unsigned count)
+{
+    if(mps == NULL || count == 0)
+        return NULL;
+
+    RenderEventBatch* batch = new RenderEventBatch;
+    batch->players.assign(mps, mps + count);
+    return batch;
+}
@@ -0,0 +1,139 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Wait-free single-producer/single-consumer triple buffer.
+//
+// The producer (VLC's vout thread, in swap) always owns one slot to render
+// into and the consumer (Unity's main thread, in getVideoFrame) owns the slot
+// being displayed. The third slot is shared: its index and a "fresh" bit,
+// telling whether it holds a frame the consumer has not acquired yet, are
+// packed into a single atomic word. Publishing is a single atomic exchange and
+// acquiring a compare-and-swap that only retries when a frame was published
+// in between, so neither thread can ever block the other.
+//
+// An owner switching to another exchange protocol (FrameQueueIndex) can
+// close the exchange and open it again later over the same three slots.
+class TripleBufferIndex
+{
+public:
+    static constexpr size_t kSlots = 3;
+
+    TripleBufferIndex() = default;
+    TripleBufferIndex(const TripleBufferIndex&) = delete;
+    TripleBufferIndex& operator=(const TripleBufferIndex&) = delete;
+
+    // Producer side: slot VLC is currently rendering into.
+    size_t renderIndex() const { return m_render; }
+
+    // Consumer side: slot last handed to Unity.
+    size_t displayIndex() const { return m_display.load(std::memory_order_relaxed); }
+
+    // Producer side: hand the render slot over to the consumer and take the
+    // shared one back. Returns true when the frame previously published was
+    // never acquired, ie. it has just been overwritten.
+    bool publish()
+    {
+        uint32_t prev = m_shared.exchange(static_cast<uint32_t>(m_render) | kFreshBit,
+                                          std::memory_order_acq_rel);
+        m_render = prev & kIndexMask;
+        return (prev & kFreshBit) != 0;
+    }
+
+    // Consumer side: take the latest published frame, if any. Returns false
+    // and keeps the current display slot when nothing new was published.
+    bool acquire()
+    {
+        // A closed exchange has no fresh bit, and must not be overwritten
+        uint32_t prev = m_shared.load(std::memory_order_relaxed);
+        do {
+            if ((prev & kFreshBit) == 0)
+                return false;
+        } while (!m_shared.compare_exchange_weak(prev, static_cast<uint32_t>(displayIndex()),
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed));
+        m_display.store(prev & kIndexMask, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Either side: whether a published frame is waiting to be acquired.
+    bool hasFresh() const
+    {
+        return (m_shared.load(std::memory_order_acquire) & kFreshBit) != 0;
+    }
+
+    // Producer side: drop the pending frame, if any (eg. after the slots have
+    // been reallocated and the published content is meaningless). Safe to call
+    // while the consumer is running, it will at worst acquire an empty frame.
+    void discard()
+    {
+        m_shared.fetch_and(~kFreshBit, std::memory_order_acq_rel);
+    }
+
+    // Producer side: end the exchange, any pending frame is dropped. acquire
+    // fails from then on and the consumer keeps displaying its slot, which is
+    // returned. Neither publish nor discard may be called until reopened.
+    size_t close()
+    {
+        uint32_t prev = m_shared.exchange(kClosedBit, std::memory_order_acq_rel);
+        // The three indices are always a permutation of the slots
+        return kSlots * (kSlots - 1) / 2 - m_render - (prev & kIndexMask);
+    }
+
+    // Producer side: start a closed exchange again, the consumer displaying
+    // `display` and the producer rendering into `render`. The consumer must
+    // not use displayIndex() while the exchange is closed.
+    void open(size_t render, size_t display)
+    {
+        m_render = render;
+        m_display.store(display, std::memory_order_relaxed);
+        m_shared.store(static_cast<uint32_t>(kSlots * (kSlots - 1) / 2 - render - display),
+                       std::memory_order_release);
+    }
+
+    // Either side: whether the exchange is open.
+    bool isOpen() const
+    {
+        return (m_shared.load(std::memory_order_acquire) & kClosedBit) == 0;
+    }
+
+private:
+    static constexpr uint32_t kIndexMask = 0x3;
+    static constexpr uint32_t kFreshBit = 0x4;
+    static constexpr uint32_t kClosedBit = 0x8;
+
+    // Keep the shared word and each side's private index on separate cache
+    // lines so that the two threads do not false-share.
+    char m_pad0[64];
+    std::atomic<uint32_t> m_shared{1};
+    char m_pad1[64 - sizeof(std::atomic<uint32_t>)];
+    size_t m_render = 0;
+    char m_pad2[64 - sizeof(size_t)];
+    // Written by open() too, while an acquire that can only fail may read it
+    std::atomic<size_t> m_display{2};
+    char m_pad3[64 - sizeof(std::atomic<size_t>)];
+};
+
+// Triple buffer storing the per-slot resources alongside the indices.
+template <typename Slot>
+class TripleBuffer : public TripleBufferIndex
+{
+public:
+    Slot& renderSlot() { return m_slots[renderIndex()]; }
+    Slot& displaySlot() { return m_slots[displayIndex()]; }
+    const Slot& displaySlot() const { return m_slots[displayIndex()]; }
+
+    Slot& operator[](size_t i) { return m_slots[i]; }
+    const Slot& operator[](size_t i) const { return m_slots[i]; }
+
+    Slot* begin() { return m_slots; }
+    Slot* end() { return m_slots + kSlots; }
+
+private:
+    Slot m_slots[kSlots];
+};
+
+#endif /* TRIPLE_BUFFER_H */
@@ -0,0 +1,161 @@
+/*
+ * Startup cost of the DRM render node and GBM device for many players.
+ *
+ * Measures what each new player pays before it can allocate its first frame
+ * buffer: opening a render node, creating a GBM device on it and allocating a
+ * buffer, as every Linux backend instance used to do, against going through
+ * the process-wide LinuxDRMDevice. All players are kept alive until the end
+ * of a run, like in a scene with that many videos.
+ *
+ * Needs a DRM render node (/dev/dri/renderD*), the benchmark is skipped
+ * without one.
+ */
+
+#include "LinuxDRMDevice.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum : int { kSkipped = 77 };
+
+const uint32_t kWidth = 1920;
+const uint32_t kHeight = 1080;
+const uint32_t kFlags = GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR;
+
+// Previous per-player initialization, kept here as the baseline
+struct OwnDevice
+{
+    int fd = -1;
+    struct gbm_device* gbm = nullptr;
+    struct gbm_bo* bo = nullptr;
+
+    bool open()
+    {
+        DIR* dir = opendir("/dev/dri");
+        if (!dir)
+            return false;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (strncmp(entry->d_name, "renderD", 7) == 0) {
+                char path[280];
+                snprintf(path, sizeof(path), "/dev/dri/%.255s", entry->d_name);
+                fd = ::open(path, O_RDWR | O_CLOEXEC);
+                if (fd >= 0)
+                    break;
+            }
+        }
+        closedir(dir);
+        if (fd < 0)
+            return false;
+        gbm = gbm_create_device(fd);
+        if (!gbm)
+            return false;
+        bo = gbm_bo_create(gbm, kWidth, kHeight, GBM_FORMAT_ABGR8888, kFlags);
+        return bo != nullptr;
+    }
+
+    void close()
+    {
+        if (bo) gbm_bo_destroy(bo);
+        if (gbm) gbm_device_destroy(gbm);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+struct SharedDevice
+{
+    LinuxDRMDevice* drm = nullptr;
+    struct gbm_bo* bo = nullptr;
+
+    bool open()
+    {
+        drm = LinuxDRMDevice::acquire();
+        if (!drm)
+            return false;
+        bo = drm->createBo(kWidth, kHeight, GBM_FORMAT_ABGR8888, kFlags);
+        return bo != nullptr;
+    }
+
+    void close()
+    {
+        if (bo) drm->destroyBo(bo);
+        if (drm) drm->release();
+    }
+};
+
+// Returns the average time to bring up one player, in microseconds, or a
+// negative value on failure.
+template <typename Player>
+double run(size_t players, double* first_us)
+{
+    std::vector<Player> instances(players);
+    double total_us = 0;
+    bool ok = true;
+    for (size_t i = 0; i < players && ok; i++) {
+        const auto start = Clock::now();
+        ok = instances[i].open();
+        const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        if (i == 0)
+            *first_us = us;
+        total_us += us;
+    }
+    for (auto& instance : instances)
+        instance.close();
+    return ok ? total_us / players : -1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 3;
+    if (repeat < 1)
+        repeat = 1;
+
+    {
+        LinuxDRMDevice* probe = LinuxDRMDevice::acquire();
+        if (!probe) {
+            std::printf("no DRM render node, skipping\n");
+            return kSkipped;
+        }
+        std::printf("DRM device startup benchmark on %s, %ux%u buffers, best of %d\n",
+                    probe->path(), kWidth, kHeight, repeat);
+        probe->release();
+    }
+
+    std::printf("%8s | %14s %14s | %14s %14s\n", "players",
+                "own first us", "own avg us", "shared first us", "shared avg us");
+    const size_t counts[] = { 1, 4, 16, 40 };
+    for (size_t players : counts) {
+        double own_first = 0, own_avg = 0, shared_first = 0, shared_avg = 0;
+        for (int r = 0; r < repeat; r++) {
+            double first = 0;
+            double avg = run<OwnDevice>(players, &first);
+            if (avg < 0) {
+                std::printf("per-player device initialization failed\n");
+                return 1;
+            }
+            if (r == 0 || avg < own_avg) { own_avg = avg; own_first = first; }
+
+            avg = run<SharedDevice>(players, &first);
+            if (avg < 0) {
+                std::printf("shared device initialization failed\n");
+                return 1;
+            }
+            if (r == 0 || avg < shared_avg) { shared_avg = avg; shared_first = first; }
+        }
+        std::printf("%8zu | %14.1f %14.1f | %14.1f %14.1f\n", players,
+                    own_first, own_avg, shared_first, shared_avg);
+    }
+    return 0;
+}
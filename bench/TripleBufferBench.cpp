@@ -0,0 +1,161 @@
+/*
+ * Contention microbenchmark for TripleBuffer and FrameQueue.
+ *
+ * Every simulated player gets its own producer thread, publishing frames as
+ * fast as it can like a VLC vout thread would, while a single consumer thread
+ * polls every player in turn like VLCMediaPlayer.Update does on Unity's main
+ * thread. The same scenario is run against FrameQueue in mailbox mode and
+ * against a copy of the mutex-protected index swap the backends used before,
+ * for comparison.
+ *
+ * Costs are wall-clock time per operation, so once there are more producers
+ * than hardware threads they include time spent descheduled.
+ */
+
+#include "FrameQueue.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Previous frame exchange, kept here as the baseline
+class MutexTripleBuffer
+{
+public:
+    bool publish()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        bool overwritten = m_updated;
+        m_updated = true;
+        std::swap(m_idx_swap, m_idx_render);
+        return overwritten;
+    }
+
+    bool acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_updated)
+            return false;
+        std::swap(m_idx_swap, m_idx_display);
+        m_updated = false;
+        return true;
+    }
+
+    size_t displayIndex() const { return m_idx_display; }
+
+private:
+    std::mutex m_lock;
+    size_t m_idx_render = 0;
+    size_t m_idx_swap = 1;
+    size_t m_idx_display = 2;
+    bool m_updated = false;
+};
+
+struct Result
+{
+    double publish_ns;
+    double acquire_ns;
+};
+
+template <typename Buffer>
+Result run(size_t players, std::chrono::milliseconds duration)
+{
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    for (size_t i = 0; i < players; i++)
+        buffers.emplace_back(new Buffer());
+
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> publishes(players, 0);
+    std::vector<double> publish_time(players, 0.0);
+
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < players; i++) {
+        producers.emplace_back([&, i]() {
+            Buffer& buffer = *buffers[i];
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            uint64_t count = 0;
+            auto begin = Clock::now();
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int n = 0; n < 64; n++)
+                    buffer.publish();
+                count += 64;
+            }
+            std::chrono::duration<double, std::nano> elapsed = Clock::now() - begin;
+            publishes[i] = count;
+            publish_time[i] = elapsed.count();
+        });
+    }
+
+    uint64_t acquires = 0;
+    size_t sink = 0;
+    start.store(true, std::memory_order_release);
+    auto begin = Clock::now();
+    auto deadline = begin + duration;
+    while (Clock::now() < deadline) {
+        for (size_t i = 0; i < players; i++) {
+            buffers[i]->acquire();
+            sink += buffers[i]->displayIndex();
+        }
+        acquires += players;
+    }
+    std::chrono::duration<double, std::nano> consumer_time = Clock::now() - begin;
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : producers)
+        t.join();
+
+    uint64_t total_publishes = 0;
+    double total_publish_time = 0.0;
+    for (size_t i = 0; i < players; i++) {
+        total_publishes += publishes[i];
+        total_publish_time += publish_time[i];
+    }
+
+    if (sink == (size_t)-1)
+        std::printf("unreachable\n");
+
+    Result r;
+    r.publish_ns = total_publishes ? total_publish_time / total_publishes : 0.0;
+    r.acquire_ns = acquires ? consumer_time.count() / acquires : 0.0;
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long ms = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 200;
+    if (ms <= 0)
+        ms = 200;
+    const std::chrono::milliseconds duration(ms);
+
+    std::printf("Frame exchange contention benchmark (%ld ms per run, %u hardware threads)\n",
+                ms, std::thread::hardware_concurrency());
+    std::printf("%8s | %12s %12s | %12s %12s | %12s %12s\n", "players",
+                "publish ns", "acquire ns", "queue pub ns", "queue acq ns",
+                "mutex pub ns", "mutex acq ns");
+
+    static const size_t player_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for (size_t players : player_counts) {
+        Result lockfree = run<TripleBuffer<int>>(players, duration);
+        Result queue = run<FrameQueue<int>>(players, duration);
+        Result locked = run<MutexTripleBuffer>(players, duration);
+        std::printf("%8zu | %12.1f %12.1f | %12.1f %12.1f | %12.1f %12.1f\n", players,
+                    lockfree.publish_ns, lockfree.acquire_ns,
+                    queue.publish_ns, queue.acquire_ns,
+                    locked.publish_ns, locked.acquire_ns);
+    }
+    return 0;
+}
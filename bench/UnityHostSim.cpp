@@ -0,0 +1,552 @@
+/*
+ * Headless Unity host simulator for the Linux plugin.
+ *
+ * Stands in for the Unity player: provides IUnityInterfaces/IUnityGraphics,
+ * owns a GL context on a dedicated render thread (EGL pbuffer or GLX pbuffer,
+ * so Mesa's llvmpipe is enough), and drives the plugin the way the C# side
+ * does:
+ *
+ *  - OnLoad.cs: libvlc_unity_set_color_space, then a legacy render event so
+ *    that the plugin picks up the render thread's context.
+ *  - VLCMediaPlayer.Update / TextureHelper.UpdateTexture, once per frame and
+ *    player: libvlc_video_get_size, a per-player render event, then
+ *    libvlc_unity_get_texture.
+ *
+ * Like Unity, the main thread may run at most one frame ahead of the render
+ * thread. Textures returned by the plugin are bound on the render thread, and
+ * optionally read back, as a stand-in for Unity drawing them.
+ *
+ * Usage: unity_host_sim [options] <mrl or path>
+ *   --egl | --glx     context type, selecting the EGL or GLX backend (EGL)
+ *   --players N       number of players playing the same input (1)
+ *   --size WxH        texture size asked for, 0x0 for the video size (0x0)
+ *   --fps N           main loop rate (60)
+ *   --duration S      seconds to run for (10)
+ *   --legacy-events   use GetRenderEventFunc (all players) instead of the
+ *                     per-player GetRenderEventAndDataFunc
+ *   --readback        read one pixel of every new frame on the render thread
+ *   --verbose         enable the plugin's verbose logs
+ *
+ * mock:// inputs need no media file, for instance
+ *   unity_host_sim "mock://video_track_count=1;length=10000000;video_width=1280;video_height=720"
+ */
+
+#include "PlayerStats.h"
+#include "Unity/IUnityGraphics.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glx.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <vlc/vlc.h>
+}
+
+// Plugin exports, as declared by the C# P/Invoke bindings
+extern "C" {
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload();
+UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc();
+UnityRenderingEventAndData UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventAndDataFunc();
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_set_color_space(int color_space);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_set_log_level(int category, int level);
+libvlc_media_player_t* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_media_player_new(libvlc_instance_t* libvlc);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_media_player_release(libvlc_media_player_t* mp);
+void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_get_texture(libvlc_media_player_t* mp, unsigned width, unsigned height, bool* updated);
+bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API libvlc_unity_get_player_stats(libvlc_media_player_t* mp, PlayerStatsSnapshot* stats);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// TextureHelper.RenderEventOp.Player
+enum : int { kRenderEventPlayer = 1 };
+
+struct Options
+{
+    bool glx = false;
+    unsigned players = 1;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned fps = 60;
+    double duration = 10.0;
+    bool legacy_events = false;
+    bool readback = false;
+    bool verbose = false;
+    const char* mrl = nullptr;
+};
+
+// IUnityGraphics stand-in: an OpenGL core device that never goes away
+// before the end of the run.
+struct GraphicsStandIn
+{
+    static IUnityGraphicsDeviceEventCallback callback;
+
+    static UnityGfxRenderer UNITY_INTERFACE_API GetRenderer()
+    {
+        return kUnityGfxRendererOpenGLCore;
+    }
+    static void UNITY_INTERFACE_API RegisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback cb)
+    {
+        callback = cb;
+    }
+    static void UNITY_INTERFACE_API UnregisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback cb)
+    {
+        if (callback == cb)
+            callback = nullptr;
+    }
+};
+IUnityGraphicsDeviceEventCallback GraphicsStandIn::callback = nullptr;
+
+IUnityGraphics s_graphics;
+
+IUnityInterface* UNITY_INTERFACE_API GetInterface(UnityInterfaceGUID guid)
+{
+    if (guid == GetUnityInterfaceGUID<IUnityGraphics>())
+        return &s_graphics;
+    return nullptr;
+}
+
+void UNITY_INTERFACE_API RegisterInterface(UnityInterfaceGUID, IUnityInterface*)
+{
+}
+
+IUnityInterfaces s_interfaces;
+
+// IUnityGraphics derives from IUnityInterface, so it is not an aggregate
+void setupInterfaces()
+{
+    s_graphics.GetRenderer = GraphicsStandIn::GetRenderer;
+    s_graphics.RegisterDeviceEventCallback = GraphicsStandIn::RegisterDeviceEventCallback;
+    s_graphics.UnregisterDeviceEventCallback = GraphicsStandIn::UnregisterDeviceEventCallback;
+    s_interfaces.GetInterface = GetInterface;
+    s_interfaces.RegisterInterface = RegisterInterface;
+}
+
+// Unity's render thread: owns the GL context and runs plugin events in the
+// order they were issued.
+class RenderThread
+{
+public:
+    explicit RenderThread(bool glx) : m_glx(glx) {}
+
+    bool start()
+    {
+        m_thread = std::thread([this] { run(); });
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this] { return m_started; });
+        return m_context_ok;
+    }
+
+    void stop()
+    {
+        post(nullptr);
+        m_thread.join();
+    }
+
+    // GL.IssuePluginEvent / GL.IssuePluginEventAndData
+    void post(std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_tasks.push_back(std::move(task));
+        m_cond.notify_all();
+    }
+
+    // End of a main-thread frame: wait until the render thread finished the
+    // previous one, as Unity lets the main thread run one frame ahead.
+    void endFrame()
+    {
+        uint64_t frame = ++m_frames_issued;
+        post([this, frame] {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_frames_done = frame;
+            m_cond.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this, frame] { return m_frames_done + 1 >= frame; });
+    }
+
+    // Stand-in for drawing with the texture. Runs on the render thread.
+    void consumeTexture(GLuint texture, bool readback)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (readback) {
+            if (!m_fbo)
+                glGenFramebuffers(1, &m_fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+            uint8_t pixel[4];
+            glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+private:
+    void run()
+    {
+        bool ok = m_glx ? createGLX() : createEGL();
+        if (ok)
+            fprintf(stderr, "render thread: %s context, GL_RENDERER %s\n",
+                    m_glx ? "GLX" : "EGL",
+                    reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_started = true;
+            m_context_ok = ok;
+            m_cond.notify_all();
+        }
+
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_cond.wait(lock, [this] { return !m_tasks.empty(); });
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            if (!task)
+                break;
+            if (ok)
+                task();
+        }
+
+        if (m_fbo)
+            glDeleteFramebuffers(1, &m_fbo);
+        destroyContext();
+    }
+
+    bool createEGL()
+    {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay)
+            m_egl_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (m_egl_display == EGL_NO_DISPLAY)
+            m_egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (m_egl_display == EGL_NO_DISPLAY || !eglInitialize(m_egl_display, nullptr, nullptr)) {
+            fprintf(stderr, "render thread: no EGL display (0x%x)\n", eglGetError());
+            return false;
+        }
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint count = 0;
+        if (!eglChooseConfig(m_egl_display, config_attribs, &config, 1, &count) || count == 0) {
+            fprintf(stderr, "render thread: no EGL config (0x%x)\n", eglGetError());
+            return false;
+        }
+        const EGLint pbuffer_attribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+        m_egl_surface = eglCreatePbufferSurface(m_egl_display, config, pbuffer_attribs);
+        m_egl_context = eglCreateContext(m_egl_display, config, EGL_NO_CONTEXT, nullptr);
+        if (m_egl_surface == EGL_NO_SURFACE || m_egl_context == EGL_NO_CONTEXT ||
+            !eglMakeCurrent(m_egl_display, m_egl_surface, m_egl_surface, m_egl_context)) {
+            fprintf(stderr, "render thread: EGL context creation failed (0x%x)\n", eglGetError());
+            return false;
+        }
+        return true;
+    }
+
+    bool createGLX()
+    {
+        m_x_display = XOpenDisplay(nullptr);
+        if (!m_x_display) {
+            fprintf(stderr, "render thread: cannot open X display, is DISPLAY set (Xvfb)?\n");
+            return false;
+        }
+        const int config_attribs[] = {
+            GLX_DRAWABLE_TYPE, GLX_PBUFFER_BIT,
+            GLX_RENDER_TYPE, GLX_RGBA_BIT,
+            GLX_RED_SIZE, 8, GLX_GREEN_SIZE, 8, GLX_BLUE_SIZE, 8, GLX_ALPHA_SIZE, 8,
+            None
+        };
+        int count = 0;
+        GLXFBConfig* configs = glXChooseFBConfig(m_x_display, DefaultScreen(m_x_display), config_attribs, &count);
+        if (!configs || count == 0) {
+            fprintf(stderr, "render thread: no GLX pbuffer config\n");
+            return false;
+        }
+        const int pbuffer_attribs[] = { GLX_PBUFFER_WIDTH, 16, GLX_PBUFFER_HEIGHT, 16, None };
+        m_glx_pbuffer = glXCreatePbuffer(m_x_display, configs[0], pbuffer_attribs);
+        m_glx_context = glXCreateNewContext(m_x_display, configs[0], GLX_RGBA_TYPE, nullptr, True);
+        XFree(configs);
+        if (!m_glx_pbuffer || !m_glx_context ||
+            !glXMakeContextCurrent(m_x_display, m_glx_pbuffer, m_glx_pbuffer, m_glx_context)) {
+            fprintf(stderr, "render thread: GLX context creation failed\n");
+            return false;
+        }
+        return true;
+    }
+
+    void destroyContext()
+    {
+        if (m_egl_display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (m_egl_context != EGL_NO_CONTEXT)
+                eglDestroyContext(m_egl_display, m_egl_context);
+            if (m_egl_surface != EGL_NO_SURFACE)
+                eglDestroySurface(m_egl_display, m_egl_surface);
+            eglTerminate(m_egl_display);
+        }
+        if (m_x_display) {
+            glXMakeContextCurrent(m_x_display, None, None, nullptr);
+            if (m_glx_context)
+                glXDestroyContext(m_x_display, m_glx_context);
+            if (m_glx_pbuffer)
+                glXDestroyPbuffer(m_x_display, m_glx_pbuffer);
+            XCloseDisplay(m_x_display);
+        }
+    }
+
+    const bool m_glx;
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_started = false;
+    bool m_context_ok = false;
+    uint64_t m_frames_issued = 0;
+    uint64_t m_frames_done = 0;
+    GLuint m_fbo = 0;
+
+    EGLDisplay m_egl_display = EGL_NO_DISPLAY;
+    EGLSurface m_egl_surface = EGL_NO_SURFACE;
+    EGLContext m_egl_context = EGL_NO_CONTEXT;
+    Display* m_x_display = nullptr;
+    GLXPbuffer m_glx_pbuffer = 0;
+    GLXContext m_glx_context = nullptr;
+};
+
+struct Player
+{
+    libvlc_media_player_t* mp = nullptr;
+    uint64_t updates = 0;
+    uint64_t texture_calls = 0;
+    double texture_us = 0;
+    double texture_max_us = 0;
+};
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--egl"))
+            options.glx = false;
+        else if (!strcmp(arg, "--glx"))
+            options.glx = true;
+        else if (!strcmp(arg, "--players") && has_value)
+            options.players = static_cast<unsigned>(atoi(argv[++i]));
+        else if (!strcmp(arg, "--size") && has_value) {
+            if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2)
+                return false;
+        }
+        else if (!strcmp(arg, "--fps") && has_value)
+            options.fps = static_cast<unsigned>(atoi(argv[++i]));
+        else if (!strcmp(arg, "--duration") && has_value)
+            options.duration = atof(argv[++i]);
+        else if (!strcmp(arg, "--legacy-events"))
+            options.legacy_events = true;
+        else if (!strcmp(arg, "--readback"))
+            options.readback = true;
+        else if (!strcmp(arg, "--verbose"))
+            options.verbose = true;
+        else if (arg[0] != '-' && !options.mrl)
+            options.mrl = arg;
+        else
+            return false;
+    }
+    return options.mrl && options.players > 0 && options.fps > 0;
+}
+
+libvlc_media_t* createMedia(const char* mrl)
+{
+    if (strstr(mrl, "://"))
+        return libvlc_media_new_location(mrl);
+    return libvlc_media_new_path(mrl);
+}
+
+void printStats(unsigned index, const Player& player, double seconds)
+{
+    PlayerStatsSnapshot stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.size = sizeof(stats);
+    if (!libvlc_unity_get_player_stats(player.mp, &stats)) {
+        fprintf(stdout, "player %u: no stats\n", index);
+        return;
+    }
+    const double latency_avg = stats.frames_presented
+        ? static_cast<double>(stats.latency_sum_us) / stats.frames_presented : 0.0;
+    fprintf(stdout,
+            "player %u: %.1f fps presented, rendered %llu presented %llu dropped %llu "
+            "resizes %llu imports %llu, latency avg %.0fus max %lluus, "
+            "get_texture avg %.1fus max %.0fus\n",
+            index, player.updates / seconds,
+            (unsigned long long)stats.frames_rendered,
+            (unsigned long long)stats.frames_presented,
+            (unsigned long long)stats.frames_dropped,
+            (unsigned long long)stats.resizes,
+            (unsigned long long)stats.dmabuf_imports,
+            latency_avg, (unsigned long long)stats.latency_max_us,
+            player.texture_calls ? player.texture_us / player.texture_calls : 0.0,
+            player.texture_max_us);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--egl|--glx] [--players N] [--size WxH] [--fps N] [--duration S]\n"
+                "       [--legacy-events] [--readback] [--verbose] <mrl or path>\n", argv[0]);
+        return 2;
+    }
+
+    // The plugin picks its Linux backend from the session type
+    if (options.glx) {
+        unsetenv("WAYLAND_DISPLAY");
+        setenv("XDG_SESSION_TYPE", "x11", 1);
+    } else {
+        setenv("XDG_SESSION_TYPE", "wayland", 1);
+    }
+
+    RenderThread render(options.glx);
+    if (!render.start()) {
+        render.stop();
+        return 1;
+    }
+
+    setupInterfaces();
+    UnityPluginLoad(&s_interfaces);
+    if (options.verbose)
+        libvlc_unity_set_log_level(-1, 4);
+
+    // OnLoad.cs
+    libvlc_unity_set_color_space(1);
+    UnityRenderingEvent legacy_event = GetRenderEventFunc();
+    UnityRenderingEventAndData player_event = GetRenderEventAndDataFunc();
+    render.post([legacy_event] { legacy_event(1); });
+    render.endFrame();
+
+    const char* vlc_args[] = { "--no-audio", "--quiet" };
+    libvlc_instance_t* libvlc = libvlc_new(sizeof(vlc_args) / sizeof(vlc_args[0]), vlc_args);
+    if (!libvlc) {
+        fprintf(stderr, "libvlc_new failed\n");
+        render.stop();
+        return 1;
+    }
+
+    std::vector<Player> players(options.players);
+    for (auto& player : players) {
+        player.mp = libvlc_unity_media_player_new(libvlc);
+        if (!player.mp) {
+            fprintf(stderr, "libvlc_unity_media_player_new failed\n");
+            return 1;
+        }
+        libvlc_media_t* media = createMedia(options.mrl);
+        if (!media) {
+            fprintf(stderr, "cannot create media for %s\n", options.mrl);
+            return 1;
+        }
+        libvlc_media_player_set_media(player.mp, media);
+        libvlc_media_release(media);
+        libvlc_media_player_play(player.mp);
+    }
+
+    const auto frame_period = std::chrono::microseconds(1000000 / options.fps);
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::microseconds(static_cast<int64_t>(options.duration * 1e6));
+    auto next_frame = start;
+    uint64_t frames = 0;
+
+    while (Clock::now() < end) {
+        if (options.legacy_events)
+            render.post([legacy_event] { legacy_event(1); });
+
+        for (auto& player : players) {
+            // VLCMediaPlayer.Update
+            unsigned width = options.width;
+            unsigned height = options.height;
+            if (width == 0 || height == 0) {
+                if (libvlc_video_get_size(player.mp, 0, &width, &height) != 0 || width == 0 || height == 0)
+                    continue;
+            }
+
+            // TextureHelper.UpdateTexture
+            if (!options.legacy_events) {
+                libvlc_media_player_t* mp = player.mp;
+                render.post([player_event, mp] { player_event(kRenderEventPlayer, mp); });
+            }
+            bool updated = false;
+            const auto before = Clock::now();
+            void* texture = libvlc_unity_get_texture(player.mp, width, height, &updated);
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+            player.texture_calls++;
+            player.texture_us += us;
+            if (us > player.texture_max_us)
+                player.texture_max_us = us;
+
+            if (updated && texture) {
+                player.updates++;
+                GLuint name = static_cast<GLuint>(reinterpret_cast<uintptr_t>(texture));
+                const bool readback = options.readback;
+                RenderThread* thread = &render;
+                render.post([thread, name, readback] { thread->consumeTexture(name, readback); });
+            }
+        }
+
+        render.endFrame();
+        frames++;
+        next_frame += frame_period;
+        std::this_thread::sleep_until(next_frame);
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    fprintf(stdout, "%llu host frames in %.2fs (%.1f fps), %u player(s), %s backend\n",
+            (unsigned long long)frames, seconds, frames / seconds, options.players,
+            options.glx ? "GLX" : "EGL");
+    for (unsigned i = 0; i < players.size(); i++)
+        printStats(i, players[i], seconds);
+
+    for (auto& player : players) {
+        libvlc_media_player_stop_async(player.mp);
+        libvlc_unity_media_player_release(player.mp);
+    }
+    libvlc_release(libvlc);
+
+    // Let pending events run before the device goes away
+    render.endFrame();
+    render.endFrame();
+    if (GraphicsStandIn::callback) {
+        IUnityGraphicsDeviceEventCallback callback = GraphicsStandIn::callback;
+        render.post([callback] { callback(kUnityGfxDeviceEventShutdown); });
+    }
+    UnityPluginUnload();
+    render.stop();
+    return 0;
+}